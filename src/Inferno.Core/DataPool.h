@@ -2,78 +2,184 @@
 
 #include <vector>
 #include <functional>
+#include "Types.h"
 
 namespace Inferno {
-    // Contiguous data pool that reuses elements when a condition is met.
-    // todo: skip expired items when iterating
-    template<class TData, class TKey = int>
+    // Refers to an element of a DataPool. Becomes stale when the element is removed, even if its slot is reused.
+    struct PoolHandle {
+        uint32 Index = UINT32_MAX;
+        uint32 Generation = 0;
+
+        bool operator==(const PoolHandle&) const = default;
+        explicit operator bool() const { return Index != UINT32_MAX; }
+    };
+
+    // Pool of elements that expire when a condition is no longer met.
+    // Live elements are stored contiguously, so iterating only visits elements that were alive at the last Prune().
+    // Handles index a slot table that tracks where each element is stored. Free slots are kept in a list so adding is O(1).
+    // Removing moves the last element into the gap, which invalidates references but not handles.
+    template<class TData>
     class DataPool {
-        std::vector<TData> _data;
+        static constexpr uint32 NoSlot = UINT32_MAX;
+
+        struct Slot {
+            uint32 Generation = 0; // Stamp of the element using the slot
+            uint32 Index = NoSlot; // Element index while in use, otherwise the next free slot
+        };
+
+        std::vector<TData> _data; // Live elements
+        std::vector<uint32> _owners; // Slot of each element
+        std::vector<Slot> _slots;
+        uint32 _freeSlot = NoSlot; // Head of the free list
+        uint32 _generation = 0; // Stamps each new element, so handles to removed elements never match again
         std::function<bool(const TData&)> _aliveFn;
-        size_t _liveItems = 0;
+        size_t _capacity;
 
     public:
         DataPool(std::function<bool(const TData&)> aliveFn, size_t capacity)
-            : _aliveFn(aliveFn) {
+            : _aliveFn(aliveFn), _capacity(capacity) {
             _data.reserve(capacity);
+            _owners.reserve(capacity);
+            _slots.reserve(capacity);
         }
 
-        TData& Get(TKey key) {
-            assert(InRange(key));
-            return _data[(int64)key];
+        // Adds an element to the pool
+        PoolHandle Add(const TData& data) {
+            auto handle = AllocSlot();
+            _data.push_back(data);
+            return handle;
         }
 
-        // Adds an element to the container
-        TKey Add(const TData& data) {
-            for (size_t i = 0; i < _data.size(); i++) {
-                if (!_aliveFn(_data[i])) {
-                    _data[i] = data;
-                    return (TKey)i;
-                }
-            }
+        // Adds a default constructed element. The reference is valid until an element is removed.
+        [[nodiscard]] TData& Alloc(PoolHandle* handle = nullptr) {
+            auto h = AllocSlot();
+            if (handle) *handle = h;
+            return _data.emplace_back();
+        }
 
-            _liveItems++;
-            _data.push_back(data);
-            return TKey(_data.size() - 1);
+        // Returns null if the element was removed
+        TData* TryGet(PoolHandle handle) {
+            if (!Contains(handle)) return nullptr;
+            return &_data[_slots[handle.Index].Index];
         }
 
-        // Allocates an element
-        [[nodiscard]] TData& Alloc() {
-            for (auto& v : _data) {
-                if (_aliveFn(v))
-                    return v;
-            }
+        const TData* TryGet(PoolHandle handle) const {
+            if (!Contains(handle)) return nullptr;
+            return &_data[_slots[handle.Index].Index];
+        }
 
-            return _data.emplace_back();
+        // Handle of the element at an index while iterating
+        PoolHandle GetHandle(size_t index) const {
+            auto slot = _owners[index];
+            return { slot, _slots[slot].Generation };
         }
 
-        void Clear() {
-            _data.clear();
-            _liveItems = 0;
+        bool Contains(PoolHandle handle) const {
+            if (handle.Index >= _slots.size()) return false;
+            auto& slot = _slots[handle.Index];
+            return slot.Generation == handle.Generation && slot.Index < _data.size() && _owners[slot.Index] == handle.Index;
         }
 
-        // Updates the live item count
+        // Returns false if the element was already removed
+        bool Remove(PoolHandle handle) {
+            if (!Contains(handle)) return false;
+            RemoveAt(_slots[handle.Index].Index);
+            return true;
+        }
+
+        // Removes elements that are no longer alive
         void Prune() {
-            for (size_t i = 0; i < _data.size(); i++) {
-                if (_aliveFn(_data[i]))
-                    _liveItems = i;
+            for (size_t i = _data.size(); i-- > 0;) {
+                if (!_aliveFn(_data[i]))
+                    RemoveAt((uint32)i);
             }
         }
 
-        // Removes gaps in data
-        void Compact() {}
+        // Prunes and releases memory and trailing free slots beyond the initial capacity.
+        // Handles to live elements remain valid.
+        void Compact() {
+            Prune();
+
+            // Slots above the highest one in use can be dropped, as their handles are already stale
+            uint32 used = 0;
+            for (auto slot : _owners)
+                used = std::max(used, slot + 1);
 
-        bool InRange(TKey index) const { return index >= (TKey)0 && index < (TKey)_data.size(); }
+            _slots.resize(used);
+
+            _freeSlot = NoSlot;
+            for (uint32 i = used; i-- > 0;) {
+                auto& slot = _slots[i];
+                if (slot.Index < _data.size() && _owners[slot.Index] == i) continue;
+                slot.Index = _freeSlot;
+                _freeSlot = i;
+            }
 
-        // return a span of mostly-live data
-        span<const TData> GetLiveData() const {
-            return span<const TData>(_data.begin(), _liveItems);
+            _data.shrink_to_fit();
+            _owners.shrink_to_fit();
+            _slots.shrink_to_fit();
+            _data.reserve(_capacity);
+            _owners.reserve(_capacity);
+            _slots.reserve(_capacity);
         }
 
-        [[nodiscard]] auto at(size_t index) { return _data.at(index); }
+        // Removes every element. Existing handles become stale.
+        void Clear() {
+            _data.clear();
+            _owners.clear();
+
+            _freeSlot = NoSlot;
+            for (uint32 i = (uint32)_slots.size(); i-- > 0;) {
+                _slots[i].Index = _freeSlot;
+                _freeSlot = i;
+            }
+        }
+
+        size_t Size() const { return _data.size(); }
+        size_t SlotCount() const { return _slots.size(); }
+
+        // Elements that were alive at the last prune
+        span<const TData> GetLiveData() const { return _data; }
+
         [[nodiscard]] auto begin() { return _data.begin(); }
         [[nodiscard]] auto end() { return _data.end(); }
-        [[nodiscard]] const auto begin() const { return _data.begin(); }
-        [[nodiscard]] const auto end() const { return _data.end(); }
+        [[nodiscard]] auto begin() const { return _data.begin(); }
+        [[nodiscard]] auto end() const { return _data.end(); }
+
+    private:
+        PoolHandle AllocSlot() {
+            uint32 index;
+            if (_freeSlot != NoSlot) {
+                index = _freeSlot;
+                _freeSlot = _slots[index].Index;
+            }
+            else {
+                index = (uint32)_slots.size();
+                _slots.emplace_back();
+            }
+
+            auto& slot = _slots[index];
+            slot.Generation = ++_generation;
+            slot.Index = (uint32)_data.size();
+            _owners.push_back(index);
+            return { index, slot.Generation };
+        }
+
+        void RemoveAt(uint32 index) {
+            auto slot = _owners[index];
+            auto last = (uint32)_data.size() - 1;
+
+            if (index != last) {
+                _data[index] = std::move(_data[last]);
+                _owners[index] = _owners[last];
+                _slots[_owners[index]].Index = index;
+            }
+
+            _data.pop_back();
+            _owners.pop_back();
+
+            _slots[slot].Index = _freeSlot;
+            _freeSlot = slot;
+        }
     };
-}
\ No newline at end of file
+}
@@ -3,6 +3,220 @@
 #include "Streams.h"
 
 namespace Inferno {
+    namespace {
+        // Parametric position of each segment vertex. X is left to right, Y is bottom to top, Z is front to back.
+        constexpr Array<Array<uint8, 3>, MAX_VERTICES> VertexCorners = { {
+            { 1, 1, 0 }, { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 },
+            { 1, 1, 1 }, { 1, 0, 1 }, { 0, 0, 1 }, { 0, 1, 1 }
+        } };
+
+        // Returns the fraction of the distance between two opposite sides
+        float SegmentAxis(const Segment& seg, SideID minSide, SideID maxSide, const Vector3& position) {
+            auto& a = seg.GetSide(minSide);
+            auto& b = seg.GetSide(maxSide);
+            // Side normals point into the segment
+            auto da = std::max(DistanceFromPlane(position, a.Center, a.AverageNormal), 0.0f);
+            auto db = std::max(DistanceFromPlane(position, b.Center, b.AverageNormal), 0.0f);
+            return da + db > 0 ? da / (da + db) : 0.5f;
+        }
+    }
+
+    Color Level::SampleVolumeLight(SegID id, const Vector3& position) const {
+        auto seg = TryGetSegment(id);
+        if (!seg) return { 1, 1, 1 };
+
+        auto probes = LightProbes.GetSegment(id);
+        if (probes.empty()) return seg->VolumeLight;
+
+        const Array<float, 3> uvw = {
+            SegmentAxis(*seg, SideID::Left, SideID::Right, position),
+            SegmentAxis(*seg, SideID::Bottom, SideID::Top, position),
+            SegmentAxis(*seg, SideID::Front, SideID::Back, position)
+        };
+
+        // Probes are centered in their cells, so positions near the sides clamp to the outer probes
+        auto n = LightProbes.Resolution;
+        Array<int, 3> i0{}, i1{};
+        Array<float, 3> t{};
+
+        for (int axis = 0; axis < 3; axis++) {
+            auto c = std::clamp(uvw[axis] * n - 0.5f, 0.0f, float(n - 1));
+            i0[axis] = (int)c;
+            i1[axis] = std::min(i0[axis] + 1, n - 1);
+            t[axis] = c - (float)i0[axis];
+        }
+
+        Color color;
+        for (int corner = 0; corner < 8; corner++) {
+            float weight = 1;
+            int index[3]{};
+
+            for (int axis = 0; axis < 3; axis++) {
+                bool upper = corner & (1 << axis);
+                index[axis] = upper ? i1[axis] : i0[axis];
+                weight *= upper ? t[axis] : 1 - t[axis];
+            }
+
+            if (weight > 0)
+                color += probes[(index[0] * n + index[1]) * n + index[2]] * weight;
+        }
+
+        color.w = 1;
+        return color;
+    }
+
+    Vector3 Level::GetProbePosition(const Segment& seg, int resolution, int index) const {
+        auto x = index / (resolution * resolution);
+        auto y = (index / resolution) % resolution;
+        auto z = index % resolution;
+        const Array<float, 3> uvw = {
+            (x + 0.5f) / resolution,
+            (y + 0.5f) / resolution,
+            (z + 0.5f) / resolution
+        };
+
+        Vector3 position;
+        for (int i = 0; i < MAX_VERTICES; i++) {
+            float weight = 1;
+            for (int axis = 0; axis < 3; axis++)
+                weight *= VertexCorners[i][axis] ? uvw[axis] : 1 - uvw[axis];
+
+            position += Vertices[seg.Indices[i]] * weight;
+        }
+
+        return position;
+    }
+
+    void Level::LinkObject(ObjID id) {
+        auto obj = TryGetObject(id);
+        if (!obj) return;
+        if (obj->LinkedSegment != SegID::None) UnlinkObject(id);
+
+        auto seg = TryGetSegment(obj->Segment);
+        if (!seg || !Object::IsAlive(*obj)) return;
+
+        // Insert at the head of the segment list
+        obj->PrevInSegment = ObjID::None;
+        obj->NextInSegment = seg->Objects;
+        obj->LinkedSegment = obj->Segment;
+
+        if (seg->Objects != ObjID::None)
+            Objects[(int)seg->Objects].PrevInSegment = id;
+
+        seg->Objects = id;
+    }
+
+    void Level::UnlinkObject(ObjID id) {
+        auto obj = TryGetObject(id);
+        if (!obj || obj->LinkedSegment == SegID::None) return;
+
+        if (obj->PrevInSegment != ObjID::None)
+            Objects[(int)obj->PrevInSegment].NextInSegment = obj->NextInSegment;
+        else if (auto seg = TryGetSegment(obj->LinkedSegment))
+            seg->Objects = obj->NextInSegment;
+
+        if (obj->NextInSegment != ObjID::None)
+            Objects[(int)obj->NextInSegment].PrevInSegment = obj->PrevInSegment;
+
+        obj->NextInSegment = obj->PrevInSegment = ObjID::None;
+        obj->LinkedSegment = SegID::None;
+    }
+
+    void Level::RelinkObject(ObjID id, SegID segment) {
+        auto obj = TryGetObject(id);
+        if (!obj) return;
+
+        obj->Segment = segment;
+        if (obj->LinkedSegment == segment) return;
+        LinkObject(id);
+    }
+
+    void Level::RebuildObjectLists() {
+        for (auto& seg : Segments)
+            seg.Objects = ObjID::None;
+
+        for (auto& obj : Objects) {
+            obj.NextInSegment = obj.PrevInSegment = ObjID::None;
+            obj.LinkedSegment = SegID::None;
+        }
+
+        FreeObjects.clear();
+
+        // Link in reverse so the lists are in ID order and the lowest free slot is reused first
+        for (int i = (int)Objects.size() - 1; i >= 0; i--) {
+            if (Object::IsAlive(Objects[i]))
+                LinkObject(ObjID(i));
+            else
+                FreeObjects.push_back(ObjID(i));
+        }
+    }
+
+    ObjID Level::AddObject(const Object& obj) {
+        auto id = ObjID(Objects.size());
+        auto& o = Objects.emplace_back(obj);
+
+        // Links of the source object don't apply to the copy
+        o.LinkedSegment = SegID::None;
+        o.NextInSegment = o.PrevInSegment = ObjID::None;
+        LinkObject(id);
+        return id;
+    }
+
+    void Level::FreeObject(ObjID id) {
+        UnlinkObject(id);
+        FreeObjects.push_back(id);
+    }
+
+    ObjID Level::TakeFreeObject() {
+        while (!FreeObjects.empty()) {
+            auto id = FreeObjects.back();
+            FreeObjects.pop_back();
+
+            // Slots can be reused or removed after being freed
+            if (auto obj = TryGetObject(id); obj && !Object::IsAlive(*obj))
+                return id;
+        }
+
+        return ObjID::None;
+    }
+
+    bool Level::CheckObjectLists() const {
+        auto isValid = [this](ObjID id) { return id >= ObjID(0) && (int)id < Objects.size(); };
+
+        for (int i = 0; i < Segments.size(); i++) {
+            auto head = Segments[i].Objects;
+            if (head == ObjID::None) continue;
+
+            if (!isValid(head) ||
+                Objects[(int)head].PrevInSegment != ObjID::None ||
+                Objects[(int)head].LinkedSegment != SegID(i))
+                return false;
+        }
+
+        for (int i = 0; i < Objects.size(); i++) {
+            auto& obj = Objects[i];
+            bool linked = Object::IsAlive(obj) && SegmentExists(obj.Segment);
+            if (obj.LinkedSegment != (linked ? obj.Segment : SegID::None)) return false;
+            if (obj.LinkedSegment == SegID::None) continue;
+
+            auto id = ObjID(i);
+            if (obj.PrevInSegment == ObjID::None) {
+                if (GetSegment(obj.LinkedSegment).Objects != id) return false;
+            }
+            else if (!isValid(obj.PrevInSegment) || Objects[(int)obj.PrevInSegment].NextInSegment != id) {
+                return false;
+            }
+
+            if (obj.NextInSegment != ObjID::None &&
+                (!isValid(obj.NextInSegment) ||
+                 Objects[(int)obj.NextInSegment].PrevInSegment != id ||
+                 Objects[(int)obj.NextInSegment].LinkedSegment != obj.LinkedSegment))
+                return false;
+        }
+
+        return true;
+    }
+
     bool Level::HasSecretExit() const {
         for (auto& trigger : Triggers) {
             if (IsDescent1() && trigger.HasFlag(TriggerFlagD1::SecretExit))
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "Types.h"
 #include "Utility.h"
 #include "Object.h"
@@ -58,6 +59,50 @@ namespace Inferno {
         };
     };
 
+    // Identifies a level object. Copies and assignments get a new ID,
+    // so data built for one level is never mistaken for data built for a copy of it.
+    class LevelInstanceID {
+        uint64 _value = Next();
+
+        static uint64 Next() {
+            static std::atomic<uint64> next = 0;
+            return ++next;
+        }
+
+    public:
+        LevelInstanceID() = default;
+        LevelInstanceID(const LevelInstanceID&) : _value(Next()) {}
+        LevelInstanceID& operator=(const LevelInstanceID&) { _value = Next(); return *this; }
+
+        uint64 Value() const { return _value; }
+    };
+
+    // Volumetric light samples placed on a regular grid inside each segment
+    struct LightProbeGrid {
+        int Resolution = 0; // Probes along each axis of a segment. 0 when not baked.
+        List<Color> Probes; // Resolution^3 probes per segment, ordered by segment then x, y, z
+
+        int ProbesPerSegment() const { return Resolution * Resolution * Resolution; }
+
+        // Returns the probes for a segment. Empty if the segment hasn't been baked.
+        span<const Color> GetSegment(SegID id) const {
+            auto count = (size_t)ProbesPerSegment();
+            auto offset = (size_t)id * count;
+            if (count == 0 || id < SegID(0) || offset + count > Probes.size()) return {};
+            return { &Probes[offset], count };
+        }
+
+        // Removes the probes of a deleted segment so later segments keep their own probes
+        void RemoveSegment(SegID id) {
+            auto count = (size_t)ProbesPerSegment();
+            auto offset = (size_t)id * count;
+            if (count == 0 || id < SegID(0) || offset >= Probes.size()) return;
+
+            auto end = std::min(offset + count, Probes.size());
+            Probes.erase(Probes.begin() + offset, Probes.begin() + end);
+        }
+    };
+
     struct GameDataHeader {
         int32 Offset = -1; // Byte offset into the file
         int32 Count = 0; // The number of elements
@@ -131,6 +176,9 @@ namespace Inferno {
 
         List<LightDeltaIndex> LightDeltaIndices; // Index into LightDeltas
         List<LightDelta> LightDeltas; // For breakable or flickering lights
+        LightProbeGrid LightProbes; // Saved to the level metadata
+        List<ObjID> FreeObjects; // Dead objects whose slots can be reused. Can contain stale entries.
+        LevelInstanceID Instance;
 
         // 22 to 25: Descent 1
         // 26 to 29: Descent 2
@@ -145,6 +193,7 @@ namespace Inferno {
         LevelLimits Limits = { 1 };
 
         DataPool<ActiveDoor> ActiveDoors{ ActiveDoor::IsAlive, 20 };
+        WallEventQueue WallEvents;
 
 
 #pragma region EditorProperties
@@ -164,6 +213,56 @@ namespace Inferno {
 
         bool HasSecretExit() const;
 
+        // Links an object into the list of the segment it occupies. Dead objects are not linked.
+        void LinkObject(ObjID id);
+        void UnlinkObject(ObjID id);
+
+        // Moves an object to a new segment and updates the segment lists
+        void RelinkObject(ObjID id, SegID segment);
+
+        // Appends a copy of an object and links it into its segment
+        ObjID AddObject(const Object& obj);
+
+        // Unlinks an object that died and makes its slot available for reuse
+        void FreeObject(ObjID id);
+
+        // Returns the slot of a dead object to reuse, or None
+        ObjID TakeFreeObject();
+
+        // Links all objects from scratch. Needed after objects are removed or reordered.
+        void RebuildObjectLists();
+
+        // Returns false if the lists don't match the objects, meaning an object was changed without updating them
+        bool CheckObjectLists() const;
+
+        // Calls fn(ObjID, Object&) for each object linked to a segment. Objects can be unlinked by fn.
+        void ForEachObjectInSegment(SegID id, auto&& fn) {
+            auto seg = TryGetSegment(id);
+            if (!seg) return;
+
+            for (auto oid = seg->Objects; oid != ObjID::None;) {
+                auto& obj = Objects[(int)oid];
+                auto next = obj.NextInSegment;
+                fn(oid, obj);
+                oid = next;
+            }
+        }
+
+        // Returns the ID of an object stored in this level
+        ObjID GetObjectID(const Object& obj) const {
+            if (Objects.empty() || &obj < Objects.data() || &obj >= Objects.data() + Objects.size())
+                return ObjID::None;
+
+            return ObjID(&obj - Objects.data());
+        }
+
+        // Returns the light at a position inside a segment by interpolating the light probes.
+        // Falls back to the segment volume light when probes aren't available.
+        Color SampleVolumeLight(SegID id, const Vector3& position) const;
+
+        // Returns the position of a light probe. Probes are spaced evenly between opposite sides of the segment.
+        Vector3 GetProbePosition(const Segment& seg, int resolution, int index) const;
+
         Vector3* TryGetVertex(PointID id) {
             if (!Seq::inRange(Vertices, id)) return nullptr;
             return &Vertices[id];
@@ -346,6 +346,10 @@ namespace Inferno {
         float Lifespan = FLT_MAX; // how long before despawning
         ObjID Parent = ObjID::None; // Parent for projectiles, maybe attached objects
 
+        // Intrusive list of objects in the same segment. Maintained by the level.
+        ObjID NextInSegment = ObjID::None, PrevInSegment = ObjID::None;
+        SegID LinkedSegment = SegID::None; // Segment list this object is linked into
+
         MovementData Movement;
         RenderData Render;
         ControlData Control;
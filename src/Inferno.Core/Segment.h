@@ -128,7 +128,7 @@ namespace Inferno {
         ubyte Value{}; // related to fuel center numbers, unused
         ubyte S2Flags{}; // ambient sound flag
 
-        ObjID Objects = ObjID::None; // pointer to objects in this segment.
+        ObjID Objects = ObjID::None; // First object in this segment. See Level::LinkObject().
         // If bit n (1 << n) is set, then side #n in segment has had light subtracted from original (editor-computed) value.
         uint8 LightSubtracted;
         //uint8 SlideTextures;
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <concepts>
 #include <future>
+#include <functional>
 #include "Types.h"
 
 namespace Inferno {
@@ -94,6 +95,15 @@ namespace Inferno {
         return a >= b ? a * a + a + b : a + b * b;
     }
 
+    // Mixes a value into a running 64-bit hash
+    constexpr void HashCombine(uint64& seed, uint64 value) {
+        seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    inline void HashCombine(uint64& seed, float value) {
+        HashCombine(seed, (uint64)std::hash<float>{}(value));
+    }
+
     // Executes a function on a new thread asynchronously
     void StartAsync(auto&& fun) {
         auto future = std::make_shared<std::future<void>>();
@@ -2,8 +2,11 @@
 
 #include "Types.h"
 #include "Utility.h"
+#include "DataPool.h"
 
 namespace Inferno {
+    struct WallClip;
+
     enum class WallFlag : uint8 {
         None,
         Blasted = BIT(0), // Converts a blastable wall to an illusionary wall
@@ -92,11 +95,66 @@ namespace Inferno {
     struct ActiveDoor {
         WallID Front = WallID::None;
         WallID Back = WallID::None;
-        float Time = -1;
+        float Time = -1; // Animation time as of the last event
         int Parts = 0;
+
+        // Resolved when the door is queued so events don't need to look them up
+        Tag Connection; // Side the front wall connects to
+        const WallClip* Clip = nullptr;
+        double Start = 0; // Event time the current animation started
+        uint32 Event = 0; // Sequence of the pending event. Older events for the door are ignored.
+
         static bool IsAlive(const ActiveDoor& d) { return d.Time >= 0; }
     };
 
+    enum class WallEventType : uint8 {
+        DoorFrame, // Advance an opening or closing door to its next frame
+        DoorClose, // An automatic door finished waiting and starts closing
+    };
+
+    struct WallEvent {
+        double Time = 0;
+        uint32 Sequence = 0;
+        WallEventType Type{};
+        PoolHandle Door;
+
+        bool operator>(const WallEvent& rhs) const {
+            return Time != rhs.Time ? Time > rhs.Time : Sequence > rhs.Sequence;
+        }
+    };
+
+    // Timed wall changes ordered by when they are due, so an update only touches the walls that change
+    class WallEventQueue {
+        std::priority_queue<WallEvent, List<WallEvent>, std::greater<>> _events;
+        double _time = 0;
+        uint32 _sequence = 0;
+
+    public:
+        // Queues an event after a delay and returns its sequence
+        uint32 Schedule(float delay, WallEventType type, PoolHandle door) {
+            _events.push({ .Time = _time + delay, .Sequence = ++_sequence, .Type = type, .Door = door });
+            return _sequence;
+        }
+
+        void Advance(float dt) { _time += dt; }
+
+        // Removes the next event that is due. Events due at the same time are returned in the order they were queued.
+        bool PopDue(WallEvent& e) {
+            if (_events.empty() || _events.top().Time > _time) return false;
+            e = _events.top();
+            _events.pop();
+            return true;
+        }
+
+        void Clear() {
+            _events = {};
+            _time = 0;
+        }
+
+        double Time() const { return _time; }
+        size_t Size() const { return _events.size(); }
+    };
+
     constexpr int16 MAX_TRIGGER_TARGETS = 10;
 
     enum class TriggerType : uint8 {
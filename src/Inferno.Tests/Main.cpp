@@ -0,0 +1,44 @@
+#include "pch.h"
+#include "Tests.h"
+
+namespace Inferno::Tests {
+    namespace {
+        int Failures = 0;
+    }
+
+    List<TestCase>& GetTests() {
+        static List<TestCase> tests; // Constructed on first use, as tests register during static initialization
+        return tests;
+    }
+
+    void ReportFailure(const char* expression, const char* file, int line) {
+        Failures++;
+        fmt::print(stderr, "{}({}): check failed: {}\n", file, line, expression);
+    }
+}
+
+// Runs every test and returns nonzero if any failed
+int main() {
+    using namespace Inferno::Tests;
+    int failedTests = 0;
+
+    for (auto& test : GetTests()) {
+        auto failures = Failures;
+
+        try {
+            test.Run();
+        }
+        catch (const TestFailure&) {}
+        catch (const std::exception& e) {
+            ReportFailure(e.what(), test.Name, 0);
+        }
+
+        if (Failures != failures) {
+            fmt::print(stderr, "FAILED: {}\n", test.Name);
+            failedTests++;
+        }
+    }
+
+    fmt::print("{} of {} tests passed\n", GetTests().size() - failedTests, GetTests().size());
+    return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "Tests.h"
+#include "DataPool.h"
+
+namespace Inferno::Tests {
+    namespace {
+        struct Element {
+            int Value = 0;
+            bool Alive = true;
+
+            static bool IsAlive(const Element& e) { return e.Alive; }
+        };
+
+        using ElementPool = DataPool<Element>;
+    }
+
+    TEST("DataPool adds and removes elements by handle") {
+        ElementPool pool(Element::IsAlive, 4);
+        auto a = pool.Add({ 1 });
+        auto b = pool.Add({ 2 });
+        auto c = pool.Add({ 3 });
+        REQUIRE(pool.Size() == 3);
+
+        // Removing moves the last element into the gap, which must not break its handle
+        CHECK(pool.Remove(a));
+        CHECK(pool.Size() == 2);
+        CHECK(!pool.Contains(a));
+        CHECK(pool.TryGet(a) == nullptr);
+        REQUIRE(pool.TryGet(b) && pool.TryGet(c));
+        CHECK(pool.TryGet(b)->Value == 2);
+        CHECK(pool.TryGet(c)->Value == 3);
+
+        CHECK(!pool.Remove(a)); // Already removed
+        CHECK(pool.Size() == 2);
+    }
+
+    TEST("DataPool handles become stale when their element is pruned") {
+        ElementPool pool(Element::IsAlive, 4);
+        auto a = pool.Add({ 1 });
+        auto b = pool.Add({ 2 });
+        auto c = pool.Add({ 3 });
+
+        pool.TryGet(b)->Alive = false;
+        pool.Prune();
+
+        CHECK(pool.Size() == 2);
+        CHECK(pool.TryGet(b) == nullptr);
+        REQUIRE(pool.TryGet(a) && pool.TryGet(c));
+        CHECK(pool.TryGet(a)->Value == 1);
+        CHECK(pool.TryGet(c)->Value == 3);
+
+        // Iterating only visits elements that were alive at the prune
+        int sum = 0;
+        for (auto& e : pool) sum += e.Value;
+        CHECK(sum == 4);
+    }
+
+    TEST("DataPool reuses slots with a new generation") {
+        ElementPool pool(Element::IsAlive, 4);
+        auto a = pool.Add({ 1 });
+        REQUIRE(pool.Remove(a));
+
+        auto b = pool.Add({ 2 });
+        CHECK(b.Index == a.Index); // The free slot was reused
+        CHECK(b.Generation != a.Generation);
+        CHECK(pool.SlotCount() == 1);
+        CHECK(pool.TryGet(a) == nullptr); // The old handle doesn't see the new element
+        REQUIRE(pool.TryGet(b));
+        CHECK(pool.TryGet(b)->Value == 2);
+    }
+
+    TEST("DataPool compact drops trailing free slots and keeps live handles") {
+        ElementPool pool(Element::IsAlive, 2);
+        List<PoolHandle> handles;
+        for (int i = 0; i < 6; i++)
+            handles.push_back(pool.Add({ i }));
+
+        // Kill the elements in the highest slots so they can be released
+        for (int i = 2; i < 6; i++)
+            pool.TryGet(handles[i])->Alive = false;
+
+        pool.Compact();
+        CHECK(pool.Size() == 2);
+        CHECK(pool.SlotCount() == 2);
+        REQUIRE(pool.TryGet(handles[0]) && pool.TryGet(handles[1]));
+        CHECK(pool.TryGet(handles[0])->Value == 0);
+        CHECK(pool.TryGet(handles[1])->Value == 1);
+
+        for (int i = 2; i < 6; i++)
+            CHECK(!pool.Contains(handles[i]));
+
+        // A slot index that was released and created again must not match the old handle
+        auto d = pool.Add({ 10 });
+        CHECK(d.Index == handles[2].Index);
+        CHECK(!pool.Contains(handles[2]));
+        REQUIRE(pool.TryGet(d));
+        CHECK(pool.TryGet(d)->Value == 10);
+    }
+
+    TEST("DataPool compact keeps free slots below a live one") {
+        ElementPool pool(Element::IsAlive, 2);
+        auto a = pool.Add({ 1 });
+        auto b = pool.Add({ 2 });
+        auto c = pool.Add({ 3 });
+        pool.TryGet(a)->Alive = false;
+        pool.TryGet(b)->Alive = false;
+
+        pool.Compact();
+        CHECK(pool.SlotCount() == 3); // Slot 2 is still in use
+        REQUIRE(pool.TryGet(c));
+        CHECK(pool.TryGet(c)->Value == 3);
+
+        // Both free slots are handed out again before growing
+        auto d = pool.Add({ 4 });
+        auto e = pool.Add({ 5 });
+        CHECK(d.Index < 2);
+        CHECK(e.Index < 2);
+        CHECK(d.Index != e.Index);
+        CHECK(pool.SlotCount() == 3);
+    }
+
+    TEST("DataPool clear makes every handle stale") {
+        ElementPool pool(Element::IsAlive, 4);
+        auto a = pool.Add({ 1 });
+        auto b = pool.Add({ 2 });
+
+        pool.Clear();
+        CHECK(pool.Size() == 0);
+        CHECK(!pool.Contains(a));
+        CHECK(!pool.Contains(b));
+        CHECK(pool.begin() == pool.end());
+
+        // Slots are kept for reuse
+        auto c = pool.Add({ 3 });
+        CHECK(pool.SlotCount() == 2);
+        CHECK(!pool.Contains(a));
+        CHECK(!pool.Contains(b));
+        REQUIRE(pool.TryGet(c));
+        CHECK(pool.TryGet(c)->Value == 3);
+    }
+}
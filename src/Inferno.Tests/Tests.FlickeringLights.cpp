@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "Tests.h"
+#include "Game.Lights.h"
+#include "Graphics/LevelSideMesh.h"
+
+namespace Inferno::Tests {
+    namespace {
+        constexpr Tag LightTag = { SegID(0), SideID::Left };
+        constexpr Tag LitTag = { SegID(0), SideID::Top };
+        constexpr float Delay = 0.25f;
+        constexpr double TickTime = 0.125; // Two ticks per step of the mask
+
+        // One closed segment with a light that dims its own side and the side next to it
+        Level MakeLightLevel(uint32 mask) {
+            Level level;
+            auto& seg = level.Segments.emplace_back();
+            seg.LightSubtracted = 0;
+
+            level.LightDeltaIndices.push_back({ .Tag = LightTag, .Count = 2, .Index = 0 });
+
+            SideLighting delta;
+            delta.fill(Color(0.5f, 0.5f, 0.5f, 0));
+            level.LightDeltas.push_back({ LightTag, delta });
+            level.LightDeltas.push_back({ LitTag, delta });
+
+            level.FlickeringLights.push_back({ .Tag = LightTag, .Mask = mask, .Delay = Delay });
+            return level;
+        }
+
+        // Only the light's side is rendered. Its vertices start at 8 and it is half transparent.
+        List<LevelSideMesh> MakeSideMeshes() {
+            List<LevelSideMesh> sideMeshes(6);
+            sideMeshes[(int)LightTag.Side].Vertex = 8;
+            sideMeshes[(int)LightTag.Side].Alpha = 0.5f;
+            return sideMeshes;
+        }
+
+        float GetLight(Level& level, Tag tag) {
+            return level.GetSide(tag).Light[0].x;
+        }
+    }
+
+    TEST("Flickering lights wake only when their mask changes state") {
+        // Strobe8 is on for every fourth step starting at step 1
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        auto sideMeshes = MakeSideMeshes();
+        FlickeringLightSchedule schedule;
+        List<Tag> changedSides;
+        List<VertexLightUpdate> updates;
+
+        // Step 0 is off, which dims the light when it is first scheduled
+        schedule.Update(level, 0, changedSides);
+        CHECK(schedule.GetStats().Wakes == 0);
+        CHECK(schedule.GetStats().Scheduled == 1);
+        CHECK(changedSides.size() == 2);
+        CHECK(GetLight(level, LightTag) == 0.5f);
+        CHECK(GetLight(level, LitTag) == 0.5f);
+
+        // Changes at steps 1, 2, 5 and 6
+        for (int tick = 1; tick <= 16; tick++) {
+            changedSides.clear();
+            schedule.Update(level, tick * TickTime, changedSides);
+            GetVertexLightUpdates(level, sideMeshes, changedSides, updates);
+
+            bool wakes = tick == 2 || tick == 4 || tick == 10 || tick == 12;
+            CHECK(schedule.GetStats().Wakes == (wakes ? 1 : 0));
+            CHECK(schedule.GetStats().Scheduled == 1);
+            CHECK(changedSides.size() == (wakes ? 2 : 0));
+
+            // The unrendered side has no vertices to update
+            CHECK(updates.size() == (wakes ? 4 : 0));
+
+            bool on = (tick >= 2 && tick < 4) || (tick >= 10 && tick < 12);
+            CHECK(GetLight(level, LightTag) == (on ? 1.0f : 0.5f));
+        }
+    }
+
+    TEST("Vertex light updates use the side light and keep the mesh alpha") {
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        auto sideMeshes = MakeSideMeshes();
+        level.GetSide(LightTag).Light = { Color(0.1f, 0.2f, 0.3f), Color(0.4f, 0.5f, 0.6f), Color(0.7f, 0.8f, 0.9f), Color(1, 1, 1) };
+
+        List<VertexLightUpdate> updates;
+        List<Tag> sides = { LightTag, LitTag, Tag{ SegID(5), SideID::Left } }; // Segment 5 doesn't exist
+        GetVertexLightUpdates(level, sideMeshes, sides, updates);
+
+        REQUIRE(updates.size() == 4);
+        for (int i = 0; i < 4; i++) {
+            auto expected = level.GetSide(LightTag).Light[i];
+            expected.A(0.5f);
+            CHECK(updates[i].Vertex == uint32(8 + i));
+            CHECK(updates[i].Light == expected);
+        }
+
+        // Updates from a previous call are cleared
+        GetVertexLightUpdates(level, sideMeshes, {}, updates);
+        CHECK(updates.empty());
+    }
+
+    TEST("Constant and disabled flickering lights never wake") {
+        for (uint32 mask : { FlickeringLight::Defaults::On, 0u }) {
+            auto level = MakeLightLevel(mask);
+            FlickeringLightSchedule schedule;
+            List<Tag> changedSides;
+
+            for (int tick = 0; tick <= 64; tick++) {
+                schedule.Update(level, tick * TickTime, changedSides);
+                CHECK(schedule.GetStats().Wakes == 0);
+                CHECK(schedule.GetStats().Scheduled == 0);
+            }
+
+            // A mask that is always off only dims the light once
+            CHECK(changedSides.size() == (mask ? 0 : 2));
+        }
+
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        level.FlickeringLights[0].Timer = FLT_MAX;
+        FlickeringLightSchedule schedule;
+        List<Tag> changedSides;
+
+        for (int tick = 0; tick <= 16; tick++) {
+            schedule.Update(level, tick * TickTime, changedSides);
+            CHECK(schedule.GetStats().Wakes == 0);
+            CHECK(schedule.GetStats().Scheduled == 0);
+        }
+
+        CHECK(changedSides.empty());
+        CHECK(GetLight(level, LightTag) == 1.0f);
+    }
+
+    TEST("Flickering lights catch up on skipped steps and reschedule when time goes backwards") {
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        FlickeringLightSchedule schedule;
+        List<Tag> changedSides;
+
+        schedule.Update(level, 0, changedSides);
+        CHECK(GetLight(level, LightTag) == 0.5f);
+
+        // Steps 1 to 4 are skipped. The light wakes once and takes the state of step 5.
+        changedSides.clear();
+        schedule.Update(level, 5.5 * Delay, changedSides);
+        CHECK(schedule.GetStats().Wakes == 1);
+        CHECK(changedSides.size() == 2);
+        CHECK(GetLight(level, LightTag) == 1.0f);
+
+        changedSides.clear();
+        schedule.Update(level, 5.5 * Delay, changedSides);
+        CHECK(schedule.GetStats().Wakes == 0);
+        CHECK(changedSides.empty());
+
+        // Going back to step 1 reschedules without waking. The light is already on.
+        schedule.Update(level, 1 * Delay, changedSides);
+        CHECK(schedule.GetStats().Wakes == 0);
+        CHECK(schedule.GetStats().Scheduled == 1);
+        CHECK(changedSides.empty());
+
+        schedule.Update(level, 2 * Delay, changedSides);
+        CHECK(schedule.GetStats().Wakes == 1);
+        CHECK(changedSides.size() == 2);
+        CHECK(GetLight(level, LightTag) == 0.5f);
+    }
+
+    TEST("Edited flickering lights are rescheduled") {
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        FlickeringLightSchedule schedule;
+        List<Tag> changedSides;
+
+        schedule.Update(level, 0, changedSides);
+        CHECK(GetLight(level, LightTag) == 0.5f);
+
+        changedSides.clear();
+        level.FlickeringLights[0].Mask = FlickeringLight::Defaults::On;
+        schedule.Update(level, TickTime, changedSides);
+        CHECK(schedule.GetStats().Wakes == 0);
+        CHECK(schedule.GetStats().Scheduled == 0);
+        CHECK(changedSides.size() == 2);
+        CHECK(GetLight(level, LightTag) == 1.0f);
+    }
+
+    TEST("Flickering lights on open sides stay scheduled without changing") {
+        auto level = MakeLightLevel(FlickeringLight::Defaults::Strobe8);
+        level.Segments[0].GetConnection(LightTag.Side) = SegID(1);
+        FlickeringLightSchedule schedule;
+        List<Tag> changedSides;
+
+        for (int tick = 0; tick <= 16; tick++) {
+            schedule.Update(level, tick * TickTime, changedSides);
+            CHECK(schedule.GetStats().Scheduled == 1);
+        }
+
+        CHECK(changedSides.empty());
+        CHECK(GetLight(level, LightTag) == 1.0f);
+    }
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "Tests.h"
+#include "Graphics/LevelGeometry.h"
+#include "Resources.h"
+
+// Level geometry looks up texture sliding and effect clips through Resources. Nothing slides or animates here.
+namespace Inferno::Resources {
+    namespace {
+        LevelTexture TestLevelTexture{};
+    }
+
+    const LevelTexture& GetLevelTextureInfo(LevelTexID) { return TestLevelTexture; }
+    EClipID GetEffectClip(LevelTexID) { return EClipID::None; }
+}
+
+namespace Inferno::Tests {
+    namespace {
+        constexpr Tag DoorTag = { SegID(0), SideID::Back };
+
+        // Two cubes joined by a door. Sides alternate between two textures and the far side has an overlay.
+        Level MakeMeshLevel() {
+            Level level;
+            for (float z : { 0.0f, 20.0f, 40.0f }) {
+                level.Vertices.push_back({ 10, 10, z });
+                level.Vertices.push_back({ 10, -10, z });
+                level.Vertices.push_back({ -10, -10, z });
+                level.Vertices.push_back({ -10, 10, z });
+            }
+
+            for (int id = 0; id < 2; id++) {
+                auto& seg = level.Segments.emplace_back();
+                for (int i = 0; i < 8; i++)
+                    seg.Indices[i] = PointID(id * 4 + i);
+
+                for (auto& sideId : SideIDs)
+                    seg.GetSide(sideId).TMap = LevelTexID(1 + (int)sideId % 2);
+            }
+
+            level.Segments[0].GetConnection(SideID::Back) = SegID(1);
+            level.Segments[1].GetConnection(SideID::Front) = SegID(0);
+
+            auto& door = level.Walls.emplace_back();
+            door.Tag = DoorTag;
+            door.Type = WallType::Door;
+            level.GetSide(DoorTag).Wall = WallID(0);
+
+            auto& overlay = level.Segments[1].GetSide(SideID::Back);
+            overlay.TMap2 = LevelTexID(3);
+            overlay.OverlayRotation = OverlayRotation::Rotate90;
+
+            for (auto& seg : level.Segments)
+                seg.UpdateGeometricProps(level);
+
+            return level;
+        }
+
+        List<SegID> GetChangedSegments(const Level& level, List<uint64>& signatures) {
+            List<SegID> changed;
+            for (int id = 0; id < level.Segments.size(); id++) {
+                auto signature = GetGeometrySignature(level, level.Segments[id]);
+                if (signature != signatures[id]) {
+                    signatures[id] = signature;
+                    changed.push_back(SegID(id));
+                }
+            }
+
+            return changed;
+        }
+
+        List<uint64> GetSignatures(const Level& level) {
+            List<uint64> signatures;
+            for (auto& seg : level.Segments)
+                signatures.push_back(GetGeometrySignature(level, seg));
+
+            return signatures;
+        }
+
+        bool VerticesMatch(span<const LevelVertex> a, span<const LevelVertex> b) {
+            return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+        }
+
+        bool IndicesMatch(span<const LevelChunk> a, span<const LevelChunk> b) {
+            if (a.size() != b.size()) return false;
+
+            for (size_t i = 0; i < a.size(); i++) {
+                if (a[i].Indices != b[i].Indices)
+                    return false;
+            }
+
+            return true;
+        }
+    }
+
+    TEST("Patching a moved vertex matches rebuilding the level geometry") {
+        auto level = MakeMeshLevel();
+        auto signatures = GetSignatures(level);
+        ChunkCache chunks, fullChunks;
+        LevelGeometry geo, full;
+        CreateLevelGeometry(level, chunks, geo);
+        REQUIRE(geo.Chunks.size() == 2);
+        REQUIRE(geo.Walls.size() == 1);
+
+        // Lifting a corner of the door bends the sides around it, which changes how they are split into triangles
+        auto& seg = level.Segments[0];
+        auto splitType = seg.GetSide(SideID::Top).Type;
+        level.Vertices[4] += Vector3(0, 5, 0);
+        for (auto& s : level.Segments)
+            s.UpdateGeometricProps(level);
+
+        CHECK(seg.GetSide(SideID::Top).Type != splitType);
+
+        auto changed = GetChangedSegments(level, signatures);
+        CHECK(changed.size() == 2);
+        REQUIRE(UpdateLevelGeometry(level, geo, changed));
+
+        CreateLevelGeometry(level, fullChunks, full);
+        CHECK(VerticesMatch(geo.Vertices, full.Vertices));
+        CHECK(IndicesMatch(geo.Chunks, full.Chunks));
+        CHECK(IndicesMatch(geo.Walls, full.Walls));
+        CHECK(geo.Walls[0].Center == full.Walls[0].Center); // Walls are sorted by their segment center
+
+        for (size_t i = 0; i < geo.Sides.size(); i++) {
+            CHECK(geo.Sides[i].Vertex == full.Sides[i].Vertex);
+            CHECK(geo.Sides[i].Index == full.Sides[i].Index);
+            CHECK(geo.Sides[i].Chunk == full.Sides[i].Chunk);
+        }
+
+        // Relighting a side is patched the same way
+        level.GetSide({ SegID(1), SideID::Back }).Light[2] = Color(0.25f, 0.5f, 0.75f);
+        changed = GetChangedSegments(level, signatures);
+        REQUIRE(changed.size() == 1);
+        CHECK(changed[0] == SegID(1));
+        REQUIRE(UpdateLevelGeometry(level, geo, changed));
+
+        CreateLevelGeometry(level, fullChunks, full);
+        CHECK(VerticesMatch(geo.Vertices, full.Vertices));
+    }
+
+    TEST("Level geometry is rebuilt when a side changes chunk or stops being drawn") {
+        auto level = MakeMeshLevel();
+        auto signatures = GetSignatures(level);
+        ChunkCache chunks;
+        LevelGeometry geo;
+        CreateLevelGeometry(level, chunks, geo);
+        auto vertices = geo.Vertices;
+
+        // A new texture moves the side to another chunk
+        level.GetSide({ SegID(0), SideID::Left }).TMap = LevelTexID(2);
+        auto changed = GetChangedSegments(level, signatures);
+        CHECK(changed.size() == 1);
+        CHECK(!UpdateLevelGeometry(level, geo, changed));
+        CHECK(VerticesMatch(geo.Vertices, vertices)); // Nothing was patched
+
+        // Removing the door opens the side
+        level.GetSide({ SegID(0), SideID::Left }).TMap = LevelTexID(1);
+        level.GetSide(DoorTag).Wall = WallID::None;
+        changed = GetChangedSegments(level, signatures);
+        CHECK(changed.size() == 1);
+        CHECK(!UpdateLevelGeometry(level, geo, changed));
+    }
+
+    TEST("Level mesh benchmark patches match a full rebuild") {
+        auto level = MakeMeshLevel();
+        auto result = RunLevelMeshBenchmark(level, 50);
+        CHECK(result.Segments == 2);
+        CHECK(result.Rebuilds == 0);
+        CHECK(result.SegmentsUpdated > 0);
+        CHECK(result.Matches);
+    }
+}
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "Tests.h"
+#include "Graphics/ParticleSystem.h"
+#include "Resources.h"
+
+// The particle system looks up clips and texture sizes through Resources. These stand in for the game data.
+namespace Inferno::Resources {
+    namespace {
+        List<VClip> TestClips;
+        PigEntry TestTexture{ .Width = 64, .Height = 32 };
+    }
+
+    const VClip& GetVideoClip(VClipID id) { return TestClips[(int)id]; }
+    const PigEntry& GetTextureInfo(TexID) { return TestTexture; }
+}
+
+namespace Inferno::Tests {
+    using namespace Render;
+
+    namespace {
+        Particle MakeParticle(float life, VClipID clip = VClipID(0)) {
+            Particle p;
+            p.Clip = clip;
+            p.Life = life;
+            p.Radius = 2;
+            return p;
+        }
+
+        List<float> GetSortedLives(const ParticleSystem& particles) {
+            List<float> lives;
+            for (size_t i = 0; i < particles.Size(); i++)
+                lives.push_back(particles.GetLife(i));
+
+            ranges::sort(lives);
+            return lives;
+        }
+
+        // Three frames that last a second each, and a clip with a single frame
+        void SetTestClips() {
+            VClip clip{ .PlayTime = 3, .NumFrames = 3, .FrameTime = 1 };
+            clip.Frames[0] = TexID(10);
+            clip.Frames[1] = TexID(11);
+            clip.Frames[2] = TexID(12);
+
+            VClip single{ .PlayTime = 1, .NumFrames = 1, .FrameTime = 1 };
+            single.Frames[0] = TexID(20);
+
+            VClip empty{}; // No frames, never drawn
+            Resources::TestClips = { clip, single, empty };
+        }
+
+        // The frame DrawVClip picked before particles were batched
+        TexID GetDrawVClipFrame(const VClip& vclip, float elapsed) {
+            auto frame = vclip.NumFrames - (int)std::floor(elapsed / vclip.FrameTime) % vclip.NumFrames - 1;
+            return vclip.Frames[frame];
+        }
+    }
+
+    TEST("ParticleSystem update removes expired particles and keeps survivors") {
+        ParticleSystem particles;
+        for (float life : { 0.5f, 2.0f, 0.5f, 3.0f, 4.0f, 0.5f, 5.0f })
+            particles.Add(MakeParticle(life));
+
+        particles.Update(1);
+
+        // Expired particles are swapped with the last one, so only compare the set of lifetimes
+        REQUIRE(particles.Size() == 4);
+        CHECK(GetSortedLives(particles) == List<float>({ 1, 2, 3, 4 }));
+        CHECK(particles.GetStats().Particles == 4);
+    }
+
+    TEST("ParticleSystem update ages counts that aren't a multiple of four") {
+        // Lifetimes are aged four at a time with a scalar loop for the rest
+        for (int count = 1; count <= 9; count++) {
+            ParticleSystem particles;
+            List<float> expected;
+
+            for (int i = 0; i < count; i++) {
+                particles.Add(MakeParticle(1.0f + i));
+                expected.push_back(0.5f + i);
+            }
+
+            particles.Update(0.5f);
+            REQUIRE((int)particles.Size() == count);
+            CHECK(GetSortedLives(particles) == expected);
+        }
+
+        // A particle that expires in the tail is removed too
+        ParticleSystem particles;
+        for (float life : { 2.0f, 2.0f, 2.0f, 2.0f, 0.25f })
+            particles.Add(MakeParticle(life));
+
+        particles.Update(0.5f);
+        CHECK(particles.Size() == 4);
+        CHECK(GetSortedLives(particles) == List<float>(4, 1.5f));
+    }
+
+    TEST("ParticleSystem builds one batch per texture with four vertices per particle") {
+        SetTestClips();
+        ParticleSystem particles;
+        particles.Add(MakeParticle(3.0f)); // Frame 12
+        particles.Add(MakeParticle(1.0f, VClipID(1))); // Frame 20
+        particles.Add(MakeParticle(1.5f)); // Frame 11
+        particles.Add(MakeParticle(2.5f)); // Frame 12
+        particles.Add(MakeParticle(0.5f, VClipID(1))); // Frame 20
+        particles.Add(MakeParticle(1.0f, VClipID(2))); // Skipped, the clip has no frames
+
+        particles.BuildBatches({ 0, 0, -10 }, Vector3::UnitY);
+
+        auto batches = particles.GetBatches();
+        REQUIRE(batches.size() == 3);
+        CHECK(batches[0].Texture == TexID(11));
+        CHECK(batches[0].Start == 0);
+        CHECK(batches[0].Count == 4);
+        CHECK(batches[1].Texture == TexID(12));
+        CHECK(batches[1].Start == 4);
+        CHECK(batches[1].Count == 8);
+        CHECK(batches[2].Texture == TexID(20));
+        CHECK(batches[2].Start == 12);
+        CHECK(batches[2].Count == 8);
+
+        CHECK(particles.GetVertices().size() == 20);
+        CHECK(particles.GetStats().Batches == 3);
+    }
+
+    TEST("ParticleSystem quads match the texture aspect ratio") {
+        SetTestClips();
+        ParticleSystem particles;
+        auto p = MakeParticle(1.0f, VClipID(1));
+        p.Color = Color(1, 0.5f, 0.25f);
+        particles.Add(p);
+
+        particles.BuildBatches({ 0, 0, -10 }, Vector3::UnitY);
+        auto v = particles.GetVertices();
+        REQUIRE(v.size() == 4);
+
+        // The test texture is twice as wide as it is tall
+        CHECK(std::abs(Vector3::Distance(v[0].Position, v[1].Position) - 4) < 0.001f);
+        CHECK(std::abs(Vector3::Distance(v[1].Position, v[2].Position) - 2) < 0.001f);
+
+        CHECK(v[0].UV == Vector2(0, 0));
+        CHECK(v[1].UV == Vector2(1, 0));
+        CHECK(v[2].UV == Vector2(1, 1));
+        CHECK(v[3].UV == Vector2(0, 1));
+
+        for (auto& vertex : v)
+            CHECK(vertex.Color == p.Color);
+    }
+
+    TEST("Particle frames match the frames DrawVClip picked") {
+        SetTestClips();
+        auto& clip = Resources::TestClips[0];
+
+        // Clips play from their last frame as the particle ages
+        CHECK(GetParticleFrame(clip, 3.0f) == TexID(12));
+        CHECK(GetParticleFrame(clip, 2.5f) == TexID(12));
+        CHECK(GetParticleFrame(clip, 1.5f) == TexID(11));
+        CHECK(GetParticleFrame(clip, 0.5f) == TexID(10));
+
+        for (float life = 3.0f; life > 0; life -= 0.125f)
+            CHECK(GetParticleFrame(clip, life) == GetDrawVClipFrame(clip, clip.PlayTime - life));
+    }
+}
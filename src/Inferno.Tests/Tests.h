@@ -0,0 +1,41 @@
+#pragma once
+
+// Minimal test runner. Each TEST registers itself and main runs every registered test.
+namespace Inferno::Tests {
+    struct TestCase {
+        const char* Name;
+        void (*Run)();
+    };
+
+    List<TestCase>& GetTests();
+
+    struct RegisterTest {
+        RegisterTest(const char* name, void (*run)()) { GetTests().push_back({ name, run }); }
+    };
+
+    // Thrown by REQUIRE to stop the current test
+    struct TestFailure {};
+
+    void ReportFailure(const char* expression, const char* file, int line);
+}
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST(name) \
+    static void TEST_CONCAT(Test_, __LINE__)(); \
+    static Inferno::Tests::RegisterTest TEST_CONCAT(Register_, __LINE__)(name, TEST_CONCAT(Test_, __LINE__)); \
+    static void TEST_CONCAT(Test_, __LINE__)()
+
+// Records a failure and continues the test
+#define CHECK(expr) \
+    do { if (!(expr)) Inferno::Tests::ReportFailure(#expr, __FILE__, __LINE__); } while (0)
+
+// Records a failure and stops the test, for checks that later ones depend on
+#define REQUIRE(expr) \
+    do { \
+        if (!(expr)) { \
+            Inferno::Tests::ReportFailure(#expr, __FILE__, __LINE__); \
+            throw Inferno::Tests::TestFailure{}; \
+        } \
+    } while (0)
@@ -0,0 +1,4 @@
+#pragma once
+
+// Same environment as the game, so its sources compile unchanged in the tests
+#include "../Inferno/pch.h"
@@ -8,6 +8,7 @@
 #include "imgui_local.h"
 #include "BitmapCache.h"
 #include "Physics.h"
+#include "Game.Simulation.h"
 #include "Graphics/Render.Particles.h"
 
 using namespace DirectX;
@@ -83,76 +84,11 @@ void Application::Initialize(int width, int height) {
 
 using Keys = Keyboard::Keys;
 
-float g_FireDelay = 0;
-
-void FireTestWeapon(Level& level, const Object& obj, int gun, int id) {
-    auto point = Vector3::Transform(Resources::GameData.PlayerShip.GunPoints[gun], obj.GetTransform());
-    auto& weapon = Resources::GameData.Weapons[id];
-
-    Object bullet{};
-    bullet.Movement.Type = MovementType::Physics;
-    bullet.Movement.Physics.Velocity = obj.Rotation.Forward() * weapon.Speed[0] * 1;
-    bullet.Movement.Physics.Flags = weapon.Bounce > 0 ? PhysicsFlag::Bounce : PhysicsFlag::None;
-    bullet.Movement.Physics.Drag = weapon.Drag;
-    bullet.Movement.Physics.Mass = weapon.Mass;
-    bullet.Position = bullet.LastPosition = point;
-    bullet.Rotation = bullet.LastRotation = obj.Rotation;
-
-    bullet.Render.Type = RenderType::WeaponVClip;
-    bullet.Render.VClip.ID = weapon.WeaponVClip;
-    bullet.Render.VClip.Rotation = Random() * DirectX::XM_2PI;
-    bullet.Lifespan = weapon.Lifetime;
-
-    bullet.Type = ObjectType::Weapon;
-    bullet.ID = (int8)id;
-    bullet.Parent = ObjID(0);
-
-    //auto pitch = -Random() * 0.2f;
-    Sound::Sound3D sound(point, obj.Segment);
-    sound.Resource = Resources::GetSoundResource(weapon.FlashSound);
-    sound.Source = ObjID(0);
-    sound.Volume = 0.35f;
-    Sound::Play(sound);
-
-    Render::LoadTextureDynamic(weapon.WeaponVClip);
-
-    Render::Particle p{};
-    p.Clip = weapon.FlashVClip;
-    p.Position = point;
-    p.Radius = weapon.FlashSize;
-    Render::AddParticle(p);
-
-    for (auto& o : level.Objects) {
-        if (o.Lifespan <= 0) {
-            o = bullet;
-            return; // found a dead object to reuse!
-        }
-    }
-
-    level.Objects.push_back(bullet); // insert a new object
-}
-
-
 void Application::Update() {
     PIXBeginEvent(PIX_COLOR_DEFAULT, L"Update");
 
     Inferno::Input::Update();
 
-    if (Settings::Editor.EnablePhysics) {
-        g_FireDelay -= Render::FrameTime;
-
-        if (Input::IsKeyDown(Keys::Enter)) {
-            if (g_FireDelay <= 0) {
-                g_FireDelay = 0;
-                auto id = Game::Level.IsDescent2() ? 13 : 13;
-                auto& weapon = Resources::GameData.Weapons[id];
-                g_FireDelay += weapon.FireDelay;
-                FireTestWeapon(Game::Level, Game::Level.Objects[0], 0, id);
-                FireTestWeapon(Game::Level, Game::Level.Objects[0], 1, id);
-            }
-        }
-    }
-
     if (Input::IsKeyPressed(Keys::F1))
         Editor::ShowDebugOverlay = !Editor::ShowDebugOverlay;
 
@@ -170,25 +106,12 @@ void Application::Update() {
         Render::ReloadTextures();
     }
 
-    constexpr double dt = 1.0f / 64;
-    static double accumulator = 0;
-    static double t = 0;
-
-    accumulator += Render::FrameTime;
-
     Render::Debug::BeginFrame(); // enable Debug calls during physics
 
     float alpha = 1; // blending between previous and current position
 
-    if (Settings::Editor.EnablePhysics) {
-        while (accumulator >= dt) {
-            UpdatePhysics(Game::Level, t, dt); // catch up if physics falls behind
-            accumulator -= dt;
-            t += dt;
-        }
-
-        alpha = float(accumulator / dt);
-    }
+    if (Settings::Editor.EnablePhysics)
+        alpha = Game::Simulation.Update(Game::Level, Render::FrameTime);
 
     // todo: only update particles if game is not paused
     Render::UpdateParticles(Render::FrameTime);
@@ -137,6 +137,7 @@ namespace Inferno::Editor {
             }
 
             if (seg.Matcen != MatcenID::None) seg.Matcen = MatcenID((int)seg.Matcen + matcenOffset);
+            seg.Objects = ObjID::None; // Pasted objects are linked as they are added
             level.Segments.push_back(std::move(seg));
         }
 
@@ -147,7 +148,7 @@ namespace Inferno::Editor {
             }
 
             o.Segment += segIdOffset;
-            level.Objects.push_back(std::move(o));
+            level.AddObject(o);
         }
 
         for (auto& wall : copy.Walls) {
@@ -314,8 +315,7 @@ namespace Inferno::Editor {
 
         Object obj = *ObjectClipboard;
         obj.Position = seg->Center;
-        level.Objects.push_back(obj);
-        Editor::Selection.SetSelection(ObjID(level.Objects.size() - 1));
+        Editor::Selection.SetSelection(level.AddObject(obj));
     }
 
     Option<SideClipboardData> CopySide(Level& level, Tag tag) {
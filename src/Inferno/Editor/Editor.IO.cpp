@@ -1,4 +1,5 @@
 #include "pch.h"
+#include <execution>
 #include "logging.h"
 #include "Editor.IO.h"
 #include "Editor.Segment.h"
@@ -11,6 +12,7 @@
 #include "Editor.h"
 #include "Graphics/Render.h"
 #include "Editor.Diagnostics.h"
+#include "ScopedTimer.h"
 
 namespace Inferno::Editor {
     constexpr auto METADATA_EXTENSION = "ied"; // inferno engine data
@@ -147,10 +149,10 @@ namespace Inferno::Editor {
     }
 
     // Serializes level settings to bytes
-    std::vector<ubyte> SerializeLevelMetadata(const Level& level) {
+    std::vector<ubyte> SerializeLevelMetadata(const Level& level, const LightSettings& lightSettings) {
         std::stringstream stream;
         stream.unsetf(std::ios::skipws);
-        SaveLevelMetadata(level, stream);
+        SaveLevelMetadata(level, stream, lightSettings);
         std::vector<ubyte> data(stream.tellp());
         stream.read((char*)data.data(), data.size());
         return data;
@@ -185,7 +187,7 @@ namespace Inferno::Editor {
             writer.WriteEntry(level.FileName, levelData);
             fmt::print("{}:{} ", level.FileName, levelData.size());
 
-            auto levelMetadata = SerializeLevelMetadata(level);
+            auto levelMetadata = SerializeLevelMetadata(level, Settings::Editor.Lighting);
             writer.WriteEntry(metadataName, levelMetadata); // IED file
             fmt::print("{}:{}\n", metadataName, levelMetadata.size());
 
@@ -203,6 +205,135 @@ namespace Inferno::Editor {
         filesystem::rename(tempPath, path); // Rename temp to destination
     }
 
+    int LightMission(const filesystem::path& path) {
+        struct LevelJob {
+            Inferno::Level Level;
+            LightSettings Lighting;
+            LightLevelResult Result;
+            string Error;
+        };
+
+        Game::Mission = HogFile::Read(path);
+        auto& mission = *Game::Mission;
+        List<LevelJob> jobs;
+        int readFailures = 0, lightFailures = 0;
+
+        for (auto& entry : mission.GetLevels()) {
+            try {
+                LevelJob job;
+                job.Level = Resources::ReadLevel(entry.Name);
+
+                // Each level is lit using the settings saved in its metadata
+                auto metadataName = String::NameWithoutExtension(entry.Name) + "." + METADATA_EXTENSION;
+                auto metadata = mission.TryReadEntry(metadataName);
+                if (!metadata.empty()) {
+                    string buffer((char*)metadata.data(), metadata.size());
+                    LoadLevelMetadata(job.Level, buffer, job.Lighting);
+                }
+
+                jobs.push_back(std::move(job));
+            }
+            catch (const std::exception& e) {
+                fmt::print("Unable to read {}: {}\n", entry.Name, e.what());
+                readFailures++;
+            }
+        }
+
+        // Texture data is global, so levels are grouped by the resources they need.
+        // Levels with custom textures get their own group.
+        std::map<string, List<LevelJob*>> groups;
+        for (auto& job : jobs) {
+            auto& level = job.Level;
+            auto customTextures = String::NameWithoutExtension(level.FileName) + (level.IsDescent1() ? ".dtx" : ".pog");
+            auto key = fmt::format("{}:{}:{}", level.Version, level.Palette, mission.Exists(customTextures) ? level.FileName : "");
+            groups[key].push_back(&job);
+        }
+
+        int64 elapsed = 0;
+
+        {
+            ScopedTimer timer(&elapsed);
+
+            for (auto& [key, group] : groups) {
+                Resources::LoadLevel(group.front()->Level);
+
+                std::for_each(std::execution::par, group.begin(), group.end(), [](LevelJob* job) {
+                    try {
+                        job->Result = LightLevelHeadless(job->Level, job->Lighting);
+                    }
+                    catch (const std::exception& e) {
+                        job->Error = e.what();
+                    }
+                });
+            }
+        }
+
+        fmt::print("{:<14}{:>10}{:>10}{:>14}{:>16}{:>18}\n", "Level", "Segments", "Time (s)", "Rays", "Dynamic lights", "Light deltas");
+
+        for (auto& job : jobs) {
+            auto& level = job.Level;
+
+            if (!job.Error.empty()) {
+                fmt::print("{:<14} failed: {}\n", level.FileName, job.Error);
+                lightFailures++;
+                continue;
+            }
+
+            auto total = job.Result.Report.Total();
+            fmt::print("{:<14}{:>10}{:>10.2f}{:>14}{:>16}{:>18}\n",
+                       level.FileName, level.Segments.size(), job.Result.Report.TotalTime / 1000000.0f, total.RaysCast,
+                       fmt::format("{} / {}", level.LightDeltaIndices.size(), MaxDynamicLights),
+                       fmt::format("{} / {}", level.LightDeltas.size(), MaxLightDeltas));
+
+            for (auto& warning : job.Result.Warnings)
+                fmt::print("  Warning: {}\n", Convert::ToString(warning));
+        }
+
+        fmt::print("Lit {} levels in {:.2f} s\n", jobs.size() - lightFailures, elapsed / 1000000.0f);
+        if (readFailures > 0) fmt::print("Skipped {} levels that could not be read\n", readFailures);
+
+        // Write the lit levels back to the HOG, keeping the entry order
+        Dictionary<string, List<ubyte>> replacements;
+        List<string> newEntries;
+
+        for (auto& job : jobs) {
+            if (!job.Error.empty()) continue;
+            auto metadataName = String::NameWithoutExtension(job.Level.FileName) + "." + METADATA_EXTENSION;
+            replacements[job.Level.FileName] = SerializeLevel(job.Level);
+            replacements[metadataName] = SerializeLevelMetadata(job.Level, job.Lighting);
+
+            if (!mission.Exists(metadataName))
+                newEntries.push_back(metadataName);
+        }
+
+        filesystem::path tempPath = path;
+        tempPath.replace_extension(".tmp");
+
+        {
+            HogWriter writer(tempPath);
+
+            for (auto& entry : mission.Entries) {
+                if (auto replacement = replacements.find(entry.Name); replacement != replacements.end()) {
+                    writer.WriteEntry(entry.Name, replacement->second);
+                }
+                else {
+                    auto data = mission.ReadEntry(entry);
+                    writer.WriteEntry(entry.Name, data);
+                }
+            }
+
+            for (auto& name : newEntries)
+                writer.WriteEntry(name, replacements[name]);
+        }
+
+        Game::UnloadMission();
+        BackupFile(path);
+        filesystem::remove(path);
+        filesystem::rename(tempPath, path);
+        fmt::print("Saved {}\n", path.string());
+        return readFailures + lightFailures;
+    }
+
     void LoadFile(filesystem::path path) {
         try {
             auto version = FileVersionFromHeader(path);
@@ -13,6 +13,10 @@ namespace Inferno::Editor {
     void ResetAutosaveTimer();
     void WritePlaytestLevel(filesystem::path missionFolder, Level& level, HogFile* mission);
 
+    // Lights every level in a mission using the settings in each level's metadata and saves the HOG.
+    // Does not use any UI. Returns the number of levels that failed.
+    int LightMission(const filesystem::path& path);
+
     namespace Commands {
         extern Command ConvertToD2, ConvertToVertigo;
         extern Command NewLevel, Open, Save, SaveAs;
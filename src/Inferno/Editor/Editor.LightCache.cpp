@@ -0,0 +1,274 @@
+#include "pch.h"
+#include <bit>
+#include "Editor.LightCache.h"
+#include "Game.Segment.h"
+#include "Resources.h"
+
+namespace Inferno::Editor {
+    namespace {
+        const filesystem::path CacheFolder = "cache/lighting";
+        constexpr uint32 CacheMagic = 0x43544c49; // ILTC
+        constexpr uint32 CacheVersion = 3;
+
+        struct CacheHeader {
+            uint32 Magic = CacheMagic;
+            uint32 Version = CacheVersion;
+            uint64 Hash = 0;
+            uint32 Segments = 0;
+            uint32 DeltaIndices = 0;
+            uint32 Deltas = 0;
+            uint32 ProbeResolution = 0;
+            uint32 Probes = 0;
+            uint32 Warnings = 0;
+            int32 BouncesRun = 0;
+            int32 SkippedBounces = 0;
+            int32 ProbesBaked = 0;
+        };
+
+        // Hashes are stored on disk, so floats are hashed by their bits instead of std::hash
+        class InputHash {
+            uint64 _hash = 0xcbf29ce484222325;
+
+        public:
+            void Add(uint64 value) {
+                _hash ^= value + 0x9e3779b97f4a7c15ull + (_hash << 6) + (_hash >> 2);
+            }
+
+            void Add(float value) { Add((uint64)std::bit_cast<uint32>(value)); }
+            void Add(bool value) { Add((uint64)value); }
+            void Add(int value) { Add((uint64)value); }
+
+            void Add(const Vector3& v) {
+                Add(v.x);
+                Add(v.y);
+                Add(v.z);
+            }
+
+            void Add(const Color& c) {
+                Add(c.x);
+                Add(c.y);
+                Add(c.z);
+                Add(c.w);
+            }
+
+            template<class T>
+            void Add(const Option<T>& value) {
+                Add(value.has_value());
+                if (value) Add(*value);
+            }
+
+            uint64 Value() const { return _hash; }
+        };
+
+        void HashSettings(InputHash& hash, const LightSettings& s) {
+            hash.Add(s.Ambient);
+            hash.Add(s.Multiplier);
+            hash.Add(s.DistanceThreshold);
+            hash.Add(s.Falloff);
+            hash.Add(s.Radius);
+            hash.Add(s.MaxValue);
+            hash.Add(s.EnableOcclusion);
+            hash.Add(s.AccurateVolumes);
+            hash.Add(s.Bounces);
+            hash.Add(s.Reflectance);
+            hash.Add(s.EnableColor);
+            hash.Add(s.SkipFirstPass);
+            hash.Add(s.LightPlaneTolerance);
+            hash.Add(s.BounceCutoff);
+            hash.Add(s.BounceEpsilon);
+            hash.Add(s.ProbeResolution);
+            hash.Add(s.ProbeTimeLimit);
+        }
+
+        template<class T>
+        void WriteSpan(std::ostream& stream, span<const T> data) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            stream.write((const char*)data.data(), data.size_bytes());
+        }
+
+        template<class T>
+        bool ReadList(std::istream& stream, List<T>& data, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            data.resize(count);
+            stream.read((char*)data.data(), count * sizeof(T));
+            return stream.gcount() == (std::streamsize)(count * sizeof(T));
+        }
+
+        // Stored as a length followed by UTF-8
+        void WriteString(std::ostream& stream, const wstring& str) {
+            auto utf8 = Convert::ToString(str);
+            auto length = (uint32)utf8.size();
+            stream.write((const char*)&length, sizeof length);
+            stream.write(utf8.data(), length);
+        }
+
+        bool ReadString(std::istream& stream, wstring& str) {
+            uint32 length = 0;
+            stream.read((char*)&length, sizeof length);
+            if (stream.gcount() != sizeof length) return false;
+
+            string utf8(length, '\0');
+            stream.read(utf8.data(), length);
+            if (stream.gcount() != (std::streamsize)length) return false;
+
+            str = Convert::ToWideString(utf8);
+            return true;
+        }
+    }
+
+    uint64 HashLightingInputs(const Level& level, const LightSettings& settings) {
+        InputHash hash;
+        hash.Add((int)level.Version);
+        hash.Add((uint64)level.Segments.size());
+        HashSettings(hash, settings);
+
+        for (auto& seg : level.Segments) {
+            for (auto& index : seg.Indices)
+                hash.Add(level.Vertices[index]);
+
+            hash.Add(seg.LockVolumeLight);
+
+            for (auto& sideId : SideIDs) {
+                auto& side = seg.GetSide(sideId);
+                hash.Add((int)seg.GetConnection(sideId));
+                hash.Add((int)side.TMap);
+                hash.Add((int)side.TMap2);
+                hash.Add((int)side.Type);
+
+                // Resolved values capture texture data that can change between missions
+                hash.Add(GetLightColor(side));
+                hash.Add(Resources::GetTextureInfo(side.TMap).AverageColor);
+                hash.Add(LightPassesThroughSide(level, seg, sideId));
+
+                if (auto wall = level.TryGetWall(side.Wall)) {
+                    hash.Add((int)wall->Type);
+                    hash.Add(wall->BlocksLight);
+                }
+
+                hash.Add(side.LightOverride);
+                hash.Add(side.LightRadiusOverride);
+                hash.Add(side.LightPlaneOverride);
+                hash.Add(side.DynamicMultiplierOverride);
+                hash.Add(side.EnableOcclusion);
+
+                for (auto& lock : side.LockLight)
+                    hash.Add(lock);
+            }
+        }
+
+        for (auto& light : level.FlickeringLights) {
+            hash.Add((int)light.Tag.Segment);
+            hash.Add((int)light.Tag.Side);
+        }
+
+        return hash.Value();
+    }
+
+    filesystem::path LightCache::GetPath(uint64 hash) {
+        return CacheFolder / fmt::format("{:016x}.bin", hash);
+    }
+
+    Option<LightCache::Entry> LightCache::Load(uint64 hash) {
+        auto path = GetPath(hash);
+
+        try {
+            if (!filesystem::exists(path)) return {};
+
+            std::ifstream stream(path, std::ios::binary);
+            CacheHeader header;
+            stream.read((char*)&header, sizeof header);
+
+            if (stream.gcount() != sizeof header ||
+                header.Magic != CacheMagic ||
+                header.Version != CacheVersion ||
+                header.Hash != hash) {
+                SPDLOG_WARN("Ignoring invalid lighting cache file {}", path.string());
+                return {};
+            }
+
+            Entry entry;
+            auto& lighting = entry.Lighting;
+            if (!ReadList(stream, lighting.Sides, header.Segments) ||
+                !ReadList(stream, lighting.VolumeLight, header.Segments) ||
+                !ReadList(stream, lighting.LightDeltaIndices, header.DeltaIndices) ||
+                !ReadList(stream, lighting.LightDeltas, header.Deltas) ||
+                !ReadList(stream, lighting.Probes.Probes, header.Probes)) {
+                SPDLOG_WARN("Lighting cache file {} is truncated", path.string());
+                return {};
+            }
+
+            entry.Warnings.resize(header.Warnings);
+            for (auto& warning : entry.Warnings) {
+                if (!ReadString(stream, warning)) {
+                    SPDLOG_WARN("Lighting cache file {} is truncated", path.string());
+                    return {};
+                }
+            }
+
+            lighting.Probes.Resolution = (int)header.ProbeResolution;
+            entry.BouncesRun = header.BouncesRun;
+            entry.SkippedBounces = header.SkippedBounces;
+            entry.Probes = header.ProbesBaked;
+            return entry;
+        }
+        catch (const std::exception& e) {
+            SPDLOG_WARN("Unable to read lighting cache {}: {}", path.string(), e.what());
+            return {};
+        }
+    }
+
+    void LightCache::Save(uint64 hash, const Entry& entry) {
+        auto path = GetPath(hash);
+        auto& lighting = entry.Lighting;
+
+        try {
+            filesystem::create_directories(CacheFolder);
+
+            // Write to a temporary file first so parallel jobs never read a partial result
+            auto temp = path;
+            temp += fmt::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+            {
+                std::ofstream stream(temp, std::ios::binary);
+                CacheHeader header{
+                    .Hash = hash,
+                    .Segments = (uint32)lighting.Sides.size(),
+                    .DeltaIndices = (uint32)lighting.LightDeltaIndices.size(),
+                    .Deltas = (uint32)lighting.LightDeltas.size(),
+                    .ProbeResolution = (uint32)lighting.Probes.Resolution,
+                    .Probes = (uint32)lighting.Probes.Probes.size(),
+                    .Warnings = (uint32)entry.Warnings.size(),
+                    .BouncesRun = entry.BouncesRun,
+                    .SkippedBounces = entry.SkippedBounces,
+                    .ProbesBaked = entry.Probes
+                };
+
+                stream.write((const char*)&header, sizeof header);
+                WriteSpan<Array<SideLighting, 6>>(stream, lighting.Sides);
+                WriteSpan<Color>(stream, lighting.VolumeLight);
+                WriteSpan<LightDeltaIndex>(stream, lighting.LightDeltaIndices);
+                WriteSpan<LightDelta>(stream, lighting.LightDeltas);
+                WriteSpan<Color>(stream, lighting.Probes.Probes);
+
+                for (auto& warning : entry.Warnings)
+                    WriteString(stream, warning);
+
+                if (!stream) throw Exception("Write failed");
+            }
+
+            filesystem::rename(temp, path);
+        }
+        catch (const std::exception& e) {
+            SPDLOG_WARN("Unable to write lighting cache {}: {}", path.string(), e.what());
+        }
+    }
+
+    void LightCache::Clear() {
+        std::error_code ec;
+        auto removed = filesystem::remove_all(CacheFolder, ec);
+        if (ec)
+            SPDLOG_WARN("Unable to clear lighting cache: {}", ec.message());
+        else
+            SPDLOG_INFO("Removed {} lighting cache files", removed);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Editor.Lighting.h"
+
+namespace Inferno::Editor {
+    // Returns a stable hash of the level state and settings that affect lighting results.
+    // Includes vertices, connectivity, walls, side textures, light overrides and locks.
+    uint64 HashLightingInputs(const Level&, const LightSettings&);
+
+    // Lighting results stored on disk and keyed by the hash of their inputs
+    namespace LightCache {
+        // Lighting with the warnings and summary of the run that produced it, so a cache hit reports the same problems
+        struct Entry {
+            LevelLighting Lighting;
+            List<wstring> Warnings;
+            int BouncesRun = 0;
+            int SkippedBounces = 0;
+            int Probes = 0;
+        };
+
+        filesystem::path GetPath(uint64 hash);
+
+        // Returns the cached lighting for the hash, if any
+        Option<Entry> Load(uint64 hash);
+
+        void Save(uint64 hash, const Entry&);
+
+        // Deletes all cached results
+        void Clear();
+    }
+}
@@ -1,4 +1,6 @@
 #include "pch.h"
+#include <execution>
+#include <numeric>
 #include "Types.h"
 #include "Level.h"
 #include "Utility.h"
@@ -8,6 +10,10 @@
 #include "ScopedTimer.h"
 #include "WindowsDialogs.h"
 #include "Editor.Segment.h"
+#include "Game.Segment.h"
+#include "Game.Visibility.h"
+#include "WorkerThread.h"
+#include "Editor.LightCache.h"
 
 namespace Inferno::Editor {
     constexpr float PlaneTolerance = -0.01f;
@@ -79,22 +85,81 @@ namespace Inferno::Editor {
         }
     };
 
+    // Light for a set of sides stored as parallel dense arrays. Sides are indexed by segment * 6 + side.
+    // Lookups go through a SparseSideIndex shared by the lighting run, so each buffer only stores lit sides.
+    struct SideLightBuffer {
+        List<int32> Sides; // Dense side indices
+        List<SideLighting> Light; // Light for each entry in Sides
+
+        size_t size() const { return Sides.size(); }
+        bool empty() const { return Sides.empty(); }
+
+        Tag GetTag(size_t i) const {
+            return { SegID(Sides[i] / 6), SideID(Sides[i] % 6) };
+        }
+
+        size_t MemoryUsage() const {
+            return Sides.capacity() * sizeof(int32) + Light.capacity() * sizeof(SideLighting);
+        }
+    };
+
+    constexpr int32 GetSideIndex(Tag tag) { return (int32)tag.Segment * 6 + (int32)tag.Side; }
+
+    // Sparse set membership for side light buffers. Sized to the level and bound to one buffer at a time.
+    class SparseSideIndex {
+        List<int32> _slots; // Slot in the bound buffer, -1 when the side isn't present
+        SideLightBuffer* _buffer = nullptr;
+
+    public:
+        void Resize(size_t sides) { _slots.assign(sides, -1); }
+
+        void Bind(SideLightBuffer& buffer) {
+            Unbind();
+            for (int32 i = 0; i < buffer.Sides.size(); i++)
+                _slots[buffer.Sides[i]] = i;
+
+            _buffer = &buffer;
+        }
+
+        // Resets only the slots used by the bound buffer
+        void Unbind() {
+            if (!_buffer) return;
+            for (auto side : _buffer->Sides)
+                _slots[side] = -1;
+
+            _buffer = nullptr;
+        }
+
+        // Returns the light for a side in the bound buffer, inserting it if missing
+        SideLighting& operator[](Tag tag) {
+            assert(_buffer);
+            auto side = GetSideIndex(tag);
+            auto& slot = _slots[side];
+
+            if (slot < 0) {
+                slot = (int32)_buffer->Sides.size();
+                _buffer->Sides.push_back(side);
+                _buffer->Light.push_back({});
+            }
+
+            return _buffer->Light[slot];
+        }
+
+        size_t MemoryUsage() const { return _slots.capacity() * sizeof(int32); }
+    };
+
     // light info during ray casting
     struct LightRayCast {
-        Dictionary<Tag, SideLighting> Accumulated; // Accumulated light for all passes
-        Dictionary<Tag, SideLighting> Pass; // Light for this pass, cleared after each iteration
+        SideLightBuffer Accumulated; // Accumulated light for all passes
+        SideLightBuffer Pass; // Light for this pass, cleared after each iteration
         // Maximum value of light in the pass.
         // This prevents faces adjacent to a light source exceeding the source brightness.
         Color PassMaxValue;
         const LightSource* Source = nullptr;
 
-        void AddLight(Tag tag, const Color& light, int16 point) {
-            Pass[tag][point] += light;
-        }
-
         void UpdateMaxValueFromPass(float reflectance) {
             Color max;
-            for (auto& [_, colors] : Pass)
+            for (auto& colors : Pass.Light)
                 for (auto& color : colors)
                     if (max.ToVector3().Length() < color.ToVector3().Length())
                         max = color;
@@ -103,19 +168,40 @@ namespace Inferno::Editor {
         }
 
         // Accumulates lighting from the pass
-        void AccumulatePass(bool keep = true) {
-            for (auto& [dest, target] : Pass) {
+        void AccumulatePass(SparseSideIndex& index, bool keep = true) {
+            for (auto& target : Pass.Light)
                 for (auto& light : target)
                     ClampColor(light, { 0, 0, 0, 0 }, PassMaxValue);
 
-                auto& light = Accumulated[dest]; // will create in place if missing
+            index.Bind(Accumulated);
+
+            for (size_t i = 0; i < Pass.size(); i++) {
+                auto& light = index[Pass.GetTag(i)]; // will create in place if missing
 
                 if (keep) {
-                    for (int i = 0; i < 4; i++)
-                        light[i] += target[i]; // change to assignment instead of sum to view the final pass contribution
+                    auto& target = Pass.Light[i];
+                    for (int j = 0; j < 4; j++)
+                        light[j] += target[j]; // change to assignment instead of sum to view the final pass contribution
                 }
             }
+
+            index.Unbind();
         }
+
+        // Returns the sum of the light in the pass
+        float PassEnergy() const {
+            float energy = 0;
+            for (auto& colors : Pass.Light)
+                for (auto& color : colors)
+                    energy += color.x + color.y + color.z;
+
+            return energy;
+        }
+
+        float DirectEnergy = 0; // Energy of the direct light pass
+        bool Converged = false; // Bounces no longer add meaningful light
+
+        size_t MemoryUsage() const { return Accumulated.MemoryUsage() + Pass.MemoryUsage(); }
     };
 
     // checks that there's enough light to bother saving. Prevents wasteful raycasts.
@@ -123,48 +209,120 @@ namespace Inferno::Editor {
         return color.x + color.y + color.z >= 0.001f;
     }
 
-    Dictionary<Tag, LightRayCast> RayCasts;
+    // Thrown from inside a light job when it is cancelled
+    struct LightCancelled {};
+
+    // State for a single lighting run. Keeps the algorithm free of globals so it can run on a worker thread.
+    struct LightContext {
+        Dictionary<Tag, LightRayCast> RayCasts;
+        SparseSideIndex SideIndex; // Shared by all ray casts, as only one buffer is written at a time
+
+        // Key is a combination of src seg, src vertex and dest vertex. Value indicates if dest is visible.
+        Dictionary<int64, bool> HitTests;
+
+        LightStats Counters; // Running totals, sampled before and after each source
+        LightingReport Report;
+        List<wstring> Warnings; // Shown to the user after the job finishes
+        SegmentVisibility Visibility; // Limits light reach to segments that can be seen from the source
+
+        const std::atomic<bool>* Cancel = nullptr;
+        LightProgressCallback OnProgress;
+        std::function<void(LevelLighting&&)> OnPreview; // Called after the direct light pass
+
+        void CheckCancel() const {
+            if (Cancel && *Cancel) throw LightCancelled();
+        }
+
+        void Progress(int pass, int passes, int source, int sources) const {
+            CheckCancel();
+            if (OnProgress) OnProgress({ pass, passes, source, sources });
+        }
+
+        // Records the counters and time spent casting a source. Function must return the ray cast.
+        const LightStats& Measure(Tag source, int pass, auto&& fn) {
+            auto before = Counters;
+            int64 time = 0;
+            int faces = 0;
+            float energy = 0;
+
+            {
+                ScopedTimer timer(&time);
+                auto& cast = fn();
+                faces = (int)cast.Pass.size();
+                energy = cast.PassEnergy();
+            }
+
+            LightStats stats = {
+                .Source = source,
+                .Pass = pass,
+                .RaysCast = Counters.RaysCast - before.RaysCast,
+                .RayHits = Counters.RayHits - before.RayHits,
+                .CacheHits = Counters.CacheHits - before.CacheHits,
+                .SegmentsVisited = Counters.SegmentsVisited - before.SegmentsVisited,
+                .FacesTouched = faces,
+                .Energy = energy,
+                .Time = time
+            };
+
+            return Report.Entries.emplace_back(stats);
+        }
+    };
 
-    // Key is a combination of src seg, src vertex and dest vertex. Value indicates if dest is visible.
-    Dictionary<int64, bool> HitTests;
+    // Labels connected regions of coplanar sides using union-find. Two sides are linked when one
+    // is on a connected segment and their normals are within the threshold angle.
+    class CoplanarRegions {
+        List<int> _parent;
 
-    // Returns sides that are coplanar to the source within an angle
-    List<Tag> FindCoplanarSides(const Level& level, Tag src, float thresholdAngle = 10.0f, bool sameTexture = false) {
-        Set<Tag> coplanar;
-        Set<Tag> scanned;
-        Stack<Tag> toScan;
-        toScan.push(src);
+        int Find(int x) {
+            while (_parent[x] != x) {
+                _parent[x] = _parent[_parent[x]]; // path halving
+                x = _parent[x];
+            }
+            return x;
+        }
+
+        void Union(int a, int b) {
+            a = Find(a);
+            b = Find(b);
+            if (a != b) _parent[std::max(a, b)] = std::min(a, b);
+        }
+
+        static int GetIndex(Tag tag) { return (int)tag.Segment * 6 + (int)tag.Side; }
 
-        while (!toScan.empty()) {
-            auto& tag = toScan.top();
-            toScan.pop();
-            coplanar.insert(tag); // if we're scanning it, it must be planar
-            scanned.insert(tag);
-            auto& seg = level.GetSegment(tag.Segment);
-            auto& side = seg.GetSide(tag.Side);
+    public:
+        CoplanarRegions(const Level& level, float thresholdAngle = 10.0f, bool sameTexture = false) {
+            _parent.resize(level.Segments.size() * 6);
+            for (int i = 0; i < _parent.size(); i++)
+                _parent[i] = i;
 
-            for (auto& cid : seg.Connections) {
-                if (cid == SegID::None || cid == SegID::Exit) continue;
-                auto& conn = level.GetSegment(cid);
+            for (int segIndex = 0; segIndex < level.Segments.size(); segIndex++) {
+                auto& seg = level.Segments[segIndex];
 
-                for (auto& csid : SideIDs) {
-                    Tag target{ cid, csid };
-                    if (scanned.contains(target)) continue; // skip already scanned sides
+                for (auto& sid : SideIDs) {
+                    auto& side = seg.GetSide(sid);
 
-                    auto& cside = conn.GetSide(csid);
-                    float angle = acos(side.AverageNormal.Dot(cside.AverageNormal)) * RadToDeg;
-                    if (angle < thresholdAngle) {
-                        if (sameTexture && !(side.TMap == cside.TMap && side.TMap2 == cside.TMap2))
-                            continue;
+                    for (auto& cid : seg.Connections) {
+                        if (cid == SegID::None || cid == SegID::Exit) continue;
+                        auto& conn = level.GetSegment(cid);
 
-                        toScan.push(target);
+                        for (auto& csid : SideIDs) {
+                            auto& cside = conn.GetSide(csid);
+                            float angle = acos(side.AverageNormal.Dot(cside.AverageNormal)) * RadToDeg;
+                            if (angle >= thresholdAngle || std::isnan(angle)) continue;
+
+                            if (sameTexture && !(side.TMap == cside.TMap && side.TMap2 == cside.TMap2))
+                                continue;
+
+                            Union(GetIndex({ SegID(segIndex), sid }), GetIndex({ cid, csid }));
+                        }
                     }
                 }
             }
         }
 
-        return Seq::ofSet(coplanar);
-    }
+        // Sides with the same region are coplanar and connected
+        int GetRegion(Tag tag) { return Find(GetIndex(tag)); }
+    };
 
     constexpr float Attenuate1(float dist, float a = 0, float b = 1) {
         return 1.0f / (1.0f + a * dist + b * dist * dist);
@@ -187,48 +345,6 @@ namespace Inferno::Editor {
         return constant * std::powf(lightDot, 2) / dist;
     }
 
-    // Returns true if light can pass through this side. Depends on the connections, texture and wall type if present.
-    bool LightPassesThroughSide(const Level& level, const Segment& seg, SideID sideId) {
-        auto& side = seg.GetSide(sideId);
-        auto connection = seg.GetConnection(sideId);
-        if (connection == SegID::None || connection == SegID::Exit) return false; // solid wall
-
-        if (side.Wall == WallID::None) return true; // not a wall and this side is open
-
-        auto& wall = level.GetWall(side.Wall);
-        if (wall.BlocksLight) return !(*wall.BlocksLight); // User defined
-
-        switch (wall.Type) {
-            case WallType::Cloaked:
-            case WallType::FlyThroughTrigger:
-                return true;
-
-            case WallType::Door:
-                if (side.HasOverlay()) {
-                    auto& tmap2 = Resources::GetTextureInfo(side.TMap2);
-                    return tmap2.SuperTransparent;
-                }
-                return false;
-
-            case WallType::WallTrigger: // triggers are always on a solid wall
-                return false;
-
-            default:
-            {
-                // Check if the textures are transparent
-                auto& tmap1 = Resources::GetTextureInfo(side.TMap);
-                bool transparent = tmap1.Transparent;
-
-                if (side.HasOverlay()) {
-                    auto& tmap2 = Resources::GetTextureInfo(side.TMap2);
-                    transparent |= tmap2.SuperTransparent;
-                }
-
-                return transparent;
-            }
-        }
-    }
-
     bool SideIsVisible(const Level& level, const Segment& seg, SideID sideId) {
         auto connection = seg.GetConnection(sideId);
         if (connection == SegID::None || connection == SegID::Exit) return true; // solid wall
@@ -275,8 +391,8 @@ namespace Inferno::Editor {
     }
 
     // Returns segments that are within range and visible from the source surface.
-    // Culls segments that are behind the plane of src.
-    Set<SegID> GetSegmentsInRange(Level& level, Tag src, float distanceThreshold) {
+    // Culls segments that are behind the plane of src or not potentially visible from its segment.
+    Set<SegID> GetSegmentsInRange(Level& level, const SegmentVisibility& visibility, Tag src, float distanceThreshold) {
         auto srcFace = Face::FromSide(level, src);
 
         Set<SegID> segmentsToLight;
@@ -295,6 +411,7 @@ namespace Inferno::Editor {
                 if (!LightPassesThroughSide(level, seg, sideId)) continue;
                 auto connection = seg.GetConnection(sideId);
                 if (segmentsToLight.contains(connection)) continue; // Don't add visited connections
+                if (!visibility.IsVisible(src.Segment, connection)) continue; // No line from the source segment reaches it
 
                 if (src.Segment == segId) {
                     // always search valid connections from source (fix for zero volume segments)
@@ -329,8 +446,9 @@ namespace Inferno::Editor {
         return segmentsToLight;
     }
 
-    // Returns true if the ray intersects any faces of the segment
-    bool HitTestRay(Level& level, const Set<SegID>& segments, const Ray& ray, float minDist) {
+    // Returns true if the ray intersects any faces of the segment.
+    // Only touches the counters, so it can be called from multiple threads with separate counters.
+    bool HitTestRay(LightStats& counters, const Level& level, const Set<SegID>& segments, const Ray& ray, float minDist) {
         for (auto& segId : segments) {
             const auto& seg = level.GetSegment(segId);
 
@@ -344,23 +462,23 @@ namespace Inferno::Editor {
                 auto indices = seg.GetVertexIndices(sideId);
                 float dist{};
 
-                Metrics::RaysCast++;
+                counters.RaysCast++;
                 if (ray.Intersects(level.Vertices[indices[ri[0]]],
                                    level.Vertices[indices[ri[1]]],
                                    level.Vertices[indices[ri[2]]],
                                    dist)
                     && dist < minDist) {
-                    Metrics::RayHits++;
+                    counters.RayHits++;
                     return true;
                 }
 
-                Metrics::RaysCast++;
+                counters.RaysCast++;
                 if (ray.Intersects(level.Vertices[indices[ri[3]]],
                                    level.Vertices[indices[ri[4]]],
                                    level.Vertices[indices[ri[5]]],
                                    dist)
                     && dist < minDist) {
-                    Metrics::RayHits++;
+                    counters.RayHits++;
                     return true;
                 }
             }
@@ -370,7 +488,8 @@ namespace Inferno::Editor {
     }
 
     // Returns true if geometry blocks the path between src point and light. Caches results.
-    bool HitTest(Level& level,
+    bool HitTest(LightContext& ctx,
+                 Level& level,
                  const Set<SegID>& segments,
                  PointID destPoint,
                  PointID lightPoint,
@@ -392,7 +511,7 @@ namespace Inferno::Editor {
         //uint16 packedDest = (uint16)dest.Segment | ((uint16)dest.Side << (16 - 3)); // pack side into the 3 high bits
         //uint64 id = (uint64)packedDest << 48 | (uint64)packedSrc << 32 | (uint64)destPoint << 16 | lightPoint;
 
-        if (!HitTests.contains(id)) {
+        if (!ctx.HitTests.contains(id)) {
             auto dir = samplePos - lightPos;
             float minDist = dir.Length() - 0.01f; // minimum distance the light must travel. hitting something before this means a wall was in the way.
             dir.Normalize();
@@ -400,18 +519,19 @@ namespace Inferno::Editor {
             bool result = false;
             // Direction length can be zero if segment has zero volume, assume it misses
             Ray ray(lightPos, dir);
-            result = dir.Length() != 0 ? HitTestRay(level, segments, ray, minDist) : false;
+            result = dir.Length() != 0 ? HitTestRay(ctx.Counters, level, segments, ray, minDist) : false;
 
-            HitTests[id] = result;
+            ctx.HitTests[id] = result;
             return result;
         }
         else {
-            Metrics::CacheHits++;
-            return HitTests[id];
+            ctx.Counters.CacheHits++;
+            return ctx.HitTests[id];
         }
     }
 
-    void LightSegments(Level& level,
+    void LightSegments(LightContext& ctx,
+                       Level& level,
                        const SideLighting& lightColors,
                        const LightSettings& settings,
                        Set<SegID> segmentsToLight,
@@ -458,7 +578,7 @@ namespace Inferno::Editor {
                         if (attenuation <= 0) return Color();
 
                         if (cast.Source->EnableOcclusion &&
-                            HitTest(level, segmentsToLight, destVertIds[vertIndex], lightVertIds[lightIndex], lightSamples[lightIndex], destSamples[vertIndex], src, dest))
+                            HitTest(ctx, level, segmentsToLight, destVertIds[vertIndex], lightVertIds[lightIndex], lightSamples[lightIndex], destSamples[vertIndex], src, dest))
                             return Color();
 
                         auto multiplier = bouncePass ? settings.Reflectance : settings.Multiplier;
@@ -482,7 +602,7 @@ namespace Inferno::Editor {
                             if (!checkPlanes(vertIndex, vertIndex)) continue;
                             auto intensity = calcIntensity(vertIndex);
                             if (CheckMinLight(intensity))
-                                cast.Pass[dest][vertIndex] += intensity;
+                                ctx.SideIndex[dest][vertIndex] += intensity;
                         }
                     }
                     else {
@@ -514,7 +634,7 @@ namespace Inferno::Editor {
                             }
 
                             if (CheckMinLight(intensity))
-                                cast.Pass[dest][i] += intensity;
+                                ctx.SideIndex[dest][i] += intensity;
                         }
                     }
                 }
@@ -522,20 +642,24 @@ namespace Inferno::Editor {
         }
     }
 
-    LightRayCast& CastBounces(Level& level, const LightSettings& settings, LightRayCast& cast) {
+    LightRayCast& CastBounces(LightContext& ctx, Level& level, const LightSettings& settings, LightRayCast& cast) {
         cast.UpdateMaxValueFromPass(settings.Reflectance);
 
         // Use the previous pass targets as the light sources
-        Dictionary<Tag, SideLighting> prevPass = std::move(cast.Pass);
+        SideLightBuffer prevPass = std::move(cast.Pass);
         cast.Pass = {};
+        ctx.SideIndex.Bind(cast.Pass);
 
-        for (const auto& [src, lightColors] : prevPass) {
+        for (size_t i = 0; i < prevPass.size(); i++) {
+            auto src = prevPass.GetTag(i);
+            auto& lightColors = prevPass.Light[i];
             auto [srcSeg, srcSide] = level.GetSegmentAndSide(src);
 
             // don't emit from open connections (from accurate volumes setting)
             if (srcSeg.SideHasConnection(src.Side) && !srcSeg.SideIsWall(src.Side)) continue;
 
-            Set<SegID> segmentsToLight = GetSegmentsInRange(level, src, settings.DistanceThreshold);
+            Set<SegID> segmentsToLight = GetSegmentsInRange(level, ctx.Visibility, src, settings.DistanceThreshold);
+            ctx.Counters.SegmentsVisited += (int)segmentsToLight.size();
             Color tmapColor = Resources::GetTextureInfo(srcSide.TMap).AverageColor;
             tmapColor.AdjustSaturation(2); // boost saturation to look nicer
             ScaleColor2(tmapColor, 1); // 100% brightness
@@ -543,66 +667,73 @@ namespace Inferno::Editor {
             for (auto& c : adjColors)
                 c *= tmapColor; // premultiply the texture color into the light color
 
-            LightSegments(level, adjColors, settings, segmentsToLight, src, true, cast);
+            LightSegments(ctx, level, adjColors, settings, segmentsToLight, src, true, cast);
         }
 
+        ctx.SideIndex.Unbind();
         return cast;
     }
 
-    LightRayCast& CastDirectLight(Level& level, const LightSource& light, const LightSettings& settings) {
-        Set<SegID> segmentsToLight = GetSegmentsInRange(level, light.Tag, settings.DistanceThreshold);
+    LightRayCast& CastDirectLight(LightContext& ctx, Level& level, const LightSource& light, const LightSettings& settings) {
+        Set<SegID> segmentsToLight = GetSegmentsInRange(level, ctx.Visibility, light.Tag, settings.DistanceThreshold);
+        ctx.Counters.SegmentsVisited += (int)segmentsToLight.size();
 
-        auto& cast = RayCasts[light.Tag];
+        auto& cast = ctx.RayCasts[light.Tag];
         cast.Source = &light;
         cast.PassMaxValue = light.MaxBrightness() * settings.Multiplier;
         // Clamp to the max light value setting
         ClampColor(cast.PassMaxValue, Color(0, 0, 0), Color(settings.MaxValue, settings.MaxValue, settings.MaxValue));
 
-        LightSegments(level, light.Colors, settings, segmentsToLight, light.Tag, false, cast);
+        ctx.SideIndex.Bind(cast.Pass);
+        LightSegments(ctx, level, light.Colors, settings, segmentsToLight, light.Tag, false, cast);
+        ctx.SideIndex.Unbind();
         return cast;
     }
 
     // Reduces the intensity of touching co-planar light sources to make the
     // brightness consistent across the entire surface
     void ReduceCoplanarBrightness(const Level& level, span<LightSource> lights) {
-        Set<Tag> scanned;
+        CoplanarRegions regions(level, 10.0f, true);
 
-        for (auto& light : lights) {
-            if (scanned.contains(light.Tag)) continue; // skip already scanned lights
-
-            // scan each source to see if it is co-planar and connected
-            List<Tag> coplanars = FindCoplanarSides(level, light.Tag, 10.0f, true);
-            List<LightSource*> coplanarLights;
-
-            for (auto& other : coplanars) {
-                for (auto& otherlt : lights) {
-                    if (otherlt.Tag == other) {
-                        coplanarLights.push_back(&otherlt); // the light was coplanar to this light
-                        scanned.insert(otherlt.Tag); // don't scan this source again
-                    }
-                }
-            }
+        // Vertex to light multimap. Vertices are only shared within a coplanar region.
+        struct Emitter {
+            int Region;
+            uint16 Vertex;
+            LightSource* Source;
+            int Index;
+        };
 
-            // reduce the brightness of the coplanar lights
-            for (int v = 0; v < level.Vertices.size(); v++) {
-                int count = 0;
+        List<Emitter> emitters;
+        emitters.reserve(lights.size() * 4);
 
-                // Check the number of times this vertex is used to emit light
-                for (auto& source : coplanarLights) {
-                    for (int j = 0; j < 4; j++)
-                        if (source->Indices[j] == v) count++;
-                }
+        for (auto& light : lights) {
+            auto region = regions.GetRegion(light.Tag);
 
-                if (count <= 1) continue;
+            for (int j = 0; j < 4; j++) {
+                if (light.Indices[j] >= level.Vertices.size()) continue;
+                emitters.push_back({ region, light.Indices[j], &light, j });
+            }
+        }
 
-                // if multiple sources have the same index, reduce the brightness
-                for (auto& source : coplanarLights) {
-                    for (int j = 0; j < 4; j++) {
-                        if (source->Indices[j] == v)
-                            source->Colors[j] *= (1.0f / (float)count);
-                    }
-                }
+        Seq::sortBy(emitters, [](const Emitter& a, const Emitter& b) {
+            return a.Region != b.Region ? a.Region < b.Region : a.Vertex < b.Vertex;
+        });
+
+        // If multiple sources in a region emit from the same vertex, reduce the brightness
+        for (size_t i = 0; i < emitters.size();) {
+            auto end = i + 1;
+            while (end < emitters.size() &&
+                   emitters[end].Region == emitters[i].Region &&
+                   emitters[end].Vertex == emitters[i].Vertex)
+                end++;
+
+            auto count = (int)(end - i);
+            if (count > 1) {
+                for (auto k = i; k < end; k++)
+                    emitters[k].Source->Colors[emitters[k].Index] *= (1.0f / (float)count);
             }
+
+            i = end;
         }
     }
 
@@ -641,13 +772,20 @@ namespace Inferno::Editor {
     }
 
     // The initial lighting pass directly from light sources
-    void EmitDirectLight(Level& level, const LightSettings& settings, span<LightSource> lights) {
+    void EmitDirectLight(LightContext& ctx, Level& level, const LightSettings& settings, span<LightSource> lights, int passes) {
         if (settings.CheckCoplanar)
             ReduceCoplanarBrightness(level, lights);
 
-        for (auto& source : lights) {
-            auto& cast = CastDirectLight(level, source, settings);
-            cast.AccumulatePass();
+        for (int i = 0; i < lights.size(); i++) {
+            ctx.Progress(0, passes, i, (int)lights.size());
+            auto& source = lights[i];
+            auto& stats = ctx.Measure(source.Tag, 0, [&]() -> LightRayCast& {
+                auto& cast = CastDirectLight(ctx, level, source, settings);
+                cast.AccumulatePass(ctx.SideIndex);
+                return cast;
+            });
+
+            ctx.RayCasts[source.Tag].DirectEnergy = stats.Energy;
         }
     }
 
@@ -673,6 +811,146 @@ namespace Inferno::Editor {
         }
     }
 
+    // Direct light source prepared for sampling probes. Copies the face data so it can be shared between threads.
+    struct ProbeLight {
+        const LightSource* Source;
+        Set<SegID> Segments; // Segments in range of the light
+        Array<Vector3, 4> Positions; // Used for attenuation
+        Array<Vector3, 4> Samples; // Occlusion ray origins
+        Vector3 Center, Normal;
+    };
+
+    // Samples light at a grid of points inside each segment. Objects are shaded by interpolating the probes.
+    // Direct light is ray cast from each source. Indirect light is gathered from the lit sides of the segment.
+    void BakeLightProbes(LightContext& ctx, Level& level, const LightSettings& settings, span<LightSource> sources) {
+        auto& grid = level.LightProbes;
+        grid.Resolution = std::clamp(settings.ProbeResolution, 0, 4);
+        grid.Probes.clear();
+        if (grid.Resolution == 0) return;
+
+        ScopedTimer timer(&ctx.Report.ProbeTime);
+        auto perSegment = grid.ProbesPerSegment();
+        grid.Probes.resize(level.Segments.size() * perSegment);
+
+        List<ProbeLight> lights;
+        lights.reserve(sources.size());
+        List<List<int>> segmentLights(level.Segments.size()); // Lights that can reach each segment
+
+        for (auto& source : sources) {
+            auto face = Face::FromSide(level, source.Tag);
+            auto& light = lights.emplace_back(ProbeLight{
+                .Source = &source,
+                .Segments = GetSegmentsInRange(level, ctx.Visibility, source.Tag, settings.DistanceThreshold),
+                .Positions = face.InsetTangent(0.5f, 1.01f),
+                .Samples = InsetTowardsPointPercentage(face.Center() + face.AverageNormal() * 5, face, 0.25f),
+                .Center = face.Center(),
+                .Normal = face.AverageNormal()
+            });
+
+            for (auto& seg : light.Segments)
+                segmentLights[(int)seg].push_back((int)lights.size() - 1);
+        }
+
+        using Clock = std::chrono::steady_clock;
+        auto deadline = Clock::now() + std::chrono::milliseconds((int64)(settings.ProbeTimeLimit * 1000));
+        bool limitTime = settings.ProbeTimeLimit > 0;
+        std::atomic<bool> outOfTime = false;
+        std::atomic<int> skipped = 0;
+        std::mutex counterLock;
+        const Color max = { settings.MaxValue, settings.MaxValue, settings.MaxValue, 1 };
+
+        List<int> segIds(level.Segments.size());
+        std::iota(segIds.begin(), segIds.end(), 0);
+
+        std::for_each(std::execution::par, segIds.begin(), segIds.end(), [&](int segIndex) {
+            auto& seg = level.Segments[segIndex];
+            auto probes = span(grid.Probes).subspan(segIndex * perSegment, perSegment);
+
+            if (limitTime && Clock::now() > deadline)
+                outOfTime = true;
+
+            // Exceptions can't leave a parallel algorithm, so fall back to the volume light instead of throwing
+            if (seg.LockVolumeLight || outOfTime || (ctx.Cancel && *ctx.Cancel)) {
+                std::ranges::fill(probes, seg.VolumeLight);
+                if (!seg.LockVolumeLight) skipped++;
+                return;
+            }
+
+            LightStats counters;
+
+            for (int i = 0; i < perSegment; i++) {
+                auto position = level.GetProbePosition(seg, grid.Resolution, i);
+                Color direct;
+
+                for (auto lightIndex : segmentLights[segIndex]) {
+                    auto& light = lights[lightIndex];
+                    if (DistanceFromPlane(position, light.Center, light.Normal) < PlaneTolerance) continue; // behind the light
+
+                    for (int vert = 0; vert < 4; vert++) {
+                        auto& color = light.Source->Colors[vert];
+                        if (!CheckMinLight(color)) continue;
+
+                        auto attenuation = Attenuate2(Vector3::Distance(position, light.Positions[vert]), light.Source->Radius, settings.Falloff);
+                        if (attenuation <= 0) continue;
+
+                        if (light.Source->EnableOcclusion) {
+                            auto dir = position - light.Samples[vert];
+                            float minDist = dir.Length() - 0.01f;
+                            dir.Normalize();
+                            if (dir.Length() != 0 && HitTestRay(counters, level, light.Segments, Ray(light.Samples[vert], dir), minDist))
+                                continue;
+                        }
+
+                        direct += color * attenuation * settings.Multiplier;
+                    }
+                }
+
+                // Weight the sides by distance so probes near a bright wall pick up more of its light
+                Color indirect;
+                float totalWeight = 0;
+
+                for (auto& sideId : SideIDs) {
+                    if (!settings.AccurateVolumes && seg.SideHasConnection(sideId) && !seg.SideIsWall(sideId)) continue;
+                    auto& side = seg.GetSide(sideId);
+                    auto weight = 1 / std::max(Vector3::DistanceSquared(position, side.Center), 1.0f);
+
+                    for (auto& v : side.Light)
+                        indirect += v * weight;
+
+                    totalWeight += weight * 4;
+                }
+
+                if (totalWeight > 0)
+                    indirect *= settings.Reflectance / totalWeight;
+
+                auto color = settings.Ambient + direct + indirect;
+                if (settings.EnableColor) {
+                    ScaleColor(color, settings.MaxValue);
+                }
+                else {
+                    color.AdjustSaturation(0);
+                    ClampColor(color, { 0, 0, 0, 1 }, max);
+                }
+
+                color.A(1);
+                probes[i] = color;
+            }
+
+            std::scoped_lock lock(counterLock);
+            ctx.Counters.RaysCast += counters.RaysCast;
+            ctx.Counters.RayHits += counters.RayHits;
+        });
+
+        ctx.CheckCancel();
+        ctx.Report.Probes = (int)grid.Probes.size();
+        ctx.Report.ProbesSkipped = skipped;
+
+        if (skipped > 0) {
+            ctx.Warnings.push_back(fmt::format(L"Light probes ran out of time. {} segments use their volume light instead.", skipped.load()));
+            SPDLOG_WARN("Light probe time limit reached, skipped {} segments", skipped.load());
+        }
+    }
+
     // Scales the brightness of values over 1 while retaining color
     constexpr void ClampColorBrightness(Level& level, float maxValue) {
         for (auto& seg : level.Segments) {
@@ -704,8 +982,8 @@ namespace Inferno::Editor {
     }
 
     // Sets the initial brightness for all geometry in the level
-    void SetAmbientLight(Color ambient) {
-        for (auto& seg : Game::Level.Segments) {
+    void SetAmbientLight(Level& level, Color ambient) {
+        for (auto& seg : level.Segments) {
             for (auto& side : seg.Sides) {
                 for (int i = 0; i < 4; i++) {
                     if (side.LockLight[i]) continue;
@@ -722,17 +1000,17 @@ namespace Inferno::Editor {
     }
 
     // Generates the dynamic light table for destroyable and flickering lights
-    void SetDynamicLights(Level& level, const Dictionary<Tag, LightRayCast>& rayCasts) {
-        for (auto& [src, light] : rayCasts) {
+    void SetDynamicLights(LightContext& ctx, Level& level) {
+        for (auto& [src, light] : ctx.RayCasts) {
             if (!light.Source->IsDynamic) continue;
 
             if (level.LightDeltaIndices.size() >= MaxDynamicLights) {
-                ShowWarningMessage(L"Maximum dynamic lights reached. Some lights will not work as expected.");
+                ctx.Warnings.push_back(L"Maximum dynamic lights reached. Some lights will not work as expected.");
                 return;
             }
 
             if (level.LightDeltas.size() + MaxDeltasPerLight > MaxLightDeltas) {
-                ShowWarningMessage(L"Maximum light deltas reached. Some lights will not work as expected.");
+                ctx.Warnings.push_back(L"Maximum light deltas reached. Some lights will not work as expected.");
                 return;
             }
 
@@ -740,7 +1018,11 @@ namespace Inferno::Editor {
 
             // Sort light by brightness
             struct Accumulated { Tag Tag; SideLighting Lighting; };
-            auto accumulated = Seq::map(light.Accumulated, [](auto x) { return Accumulated{ x.first, x.second }; });
+            List<Accumulated> accumulated;
+            accumulated.reserve(light.Accumulated.size());
+            for (size_t i = 0; i < light.Accumulated.size(); i++)
+                accumulated.push_back({ light.Accumulated.GetTag(i), light.Accumulated.Light[i] });
+
             Seq::sortBy(accumulated, [](auto& a, auto& b) { return AverageBrightness(a.Lighting) > AverageBrightness(b.Lighting); });
 
             uint8 deltaCount = 0;
@@ -774,8 +1056,12 @@ namespace Inferno::Editor {
     // Copies accumulated light to the level faces
     void SetSideLighting(Level& level, const Dictionary<Tag, LightRayCast>& rayCasts, Color max, bool color) {
         for (auto& [src, light] : rayCasts) {
-            for (auto& [dest, l] : light.Accumulated) {
-                auto& side = level.GetSide(dest);
+            auto& accumulated = light.Accumulated;
+
+            for (size_t i = 0; i < accumulated.size(); i++) {
+                auto& side = level.Segments[accumulated.Sides[i] / 6].Sides[accumulated.Sides[i] % 6];
+                auto& l = accumulated.Light[i];
+
                 for (int vert = 0; vert < 4; vert++) {
                     if (side.LockLight[vert]) continue;
                     side.Light[vert] += l[vert];
@@ -789,54 +1075,551 @@ namespace Inferno::Editor {
     // Removes all color from results
     void DesaturateAccumulated(Dictionary<Tag, LightRayCast>& rayCasts) {
         for (auto& [_, cast] : rayCasts)
-            for (auto& [__, side] : cast.Accumulated)
+            for (auto& side : cast.Accumulated.Light)
                 for (auto& l : side)
                     l.AdjustSaturation(0);
     }
 
-    // Lights the level geometry and volumes. Not thread safe (needs refactoring to not use globals).
-    void Commands::LightLevel(Level& level, const LightSettings& settings) {
-        try {
-            ScopedCursor cursor(IDC_WAIT);
+    LightStats LightingReport::Total() const {
+        LightStats total;
+        for (auto& entry : Entries)
+            total += entry;
+
+        return total;
+    }
+
+    List<LightStats> LightingReport::BySource() const {
+        Dictionary<Tag, LightStats> sources;
+        for (auto& entry : Entries) {
+            auto& source = sources[entry.Source];
+            source.Source = entry.Source;
+            source += entry;
+        }
+
+        auto result = Seq::map(sources, [](const auto& x) { return x.second; });
+        Seq::sortBy(result, [](auto& a, auto& b) { return a.Time > b.Time; });
+        return result;
+    }
+
+    List<LightStats> LightingReport::ByPass() const {
+        List<LightStats> passes;
+        for (auto& entry : Entries) {
+            if (entry.Pass >= passes.size()) {
+                passes.resize(entry.Pass + 1);
+                for (int i = 0; i < passes.size(); i++)
+                    passes[i].Pass = i;
+            }
+
+            passes[entry.Pass] += entry;
+        }
+
+        return passes;
+    }
+
+    namespace {
+        LightingReport LastReport;
+
+        void SetLightingReport(LightingReport&& report) {
+            LastReport = std::move(report);
+            auto total = LastReport.Total();
             Metrics::Reset();
-            HitTests.clear();
-            HitTests.reserve(1'000'000);
-            RayCasts.clear();
-            RayCasts.reserve(1000);
-            level.LightDeltaIndices.clear();
-            level.LightDeltas.clear();
-
-            ScopedTimer timer(&Metrics::LightCalculationTime);
-            SetAmbientLight(settings.Ambient);
-
-            auto sources = GatherLightSources(level, settings);
-            EmitDirectLight(level, settings, sources);
-
-            auto bounces = std::clamp(settings.Bounces, 0, 10);
-
-            // Accumulate radiosity bounces
-            for (int i = 0; i < bounces; i++) {
-                for (auto& [_, light] : RayCasts) {
-                    auto& info = CastBounces(level, settings, light);
-                    info.AccumulatePass(!(settings.SkipFirstPass && i == 0));
+            Metrics::RaysCast = total.RaysCast;
+            Metrics::RayHits = total.RayHits;
+            Metrics::CacheHits = total.CacheHits;
+            Metrics::SegmentsTested = total.SegmentsVisited;
+            Metrics::LightCalculationTime = LastReport.TotalTime;
+        }
+
+        void WriteStatsJson(std::ostream& stream, const LightStats& stats) {
+            stream << fmt::format(R"("rays": {}, "hits": {}, "cacheHits": {}, "segmentsVisited": {}, "facesTouched": {}, "energy": {:.4f}, "timeUs": {})",
+                                  stats.RaysCast, stats.RayHits, stats.CacheHits, stats.SegmentsVisited, stats.FacesTouched, stats.Energy, stats.Time);
+        }
+    }
+
+    const LightingReport& GetLightingReport() { return LastReport; }
+
+    void WriteLightingReportJson(const LightingReport& report, std::ostream& stream) {
+        stream << "{\n";
+        stream << fmt::format("  \"totalTimeUs\": {},\n", report.TotalTime);
+        stream << fmt::format("  \"lightBufferBytes\": {},\n", report.LightBufferBytes);
+        stream << fmt::format("  \"bouncesRun\": {},\n", report.BouncesRun);
+        stream << fmt::format("  \"skippedBounces\": {},\n", report.SkippedBounces);
+        stream << fmt::format("  \"fromCache\": {},\n", report.FromCache);
+        stream << fmt::format("  \"probes\": {},\n", report.Probes);
+        stream << fmt::format("  \"probeTimeUs\": {},\n", report.ProbeTime);
+        stream << fmt::format("  \"visibilityTimeUs\": {},\n", report.VisibilityTime);
+        stream << "  \"total\": { ";
+        WriteStatsJson(stream, report.Total());
+        stream << " },\n";
+
+        stream << "  \"passes\": [\n";
+        auto passes = report.ByPass();
+        for (int i = 0; i < passes.size(); i++) {
+            stream << fmt::format("    {{ \"pass\": {}, ", passes[i].Pass);
+            WriteStatsJson(stream, passes[i]);
+            stream << (i + 1 < passes.size() ? " },\n" : " }\n");
+        }
+        stream << "  ],\n";
+
+        stream << "  \"sources\": [\n";
+        auto sources = report.BySource();
+        for (int i = 0; i < sources.size(); i++) {
+            stream << fmt::format("    {{ \"segment\": {}, \"side\": {}, ", (int)sources[i].Source.Segment, (int)sources[i].Source.Side);
+            WriteStatsJson(stream, sources[i]);
+            stream << (i + 1 < sources.size() ? " },\n" : " }\n");
+        }
+        stream << "  ]\n";
+        stream << "}\n";
+    }
+
+    void WriteLightingReportCsv(const LightingReport& report, std::ostream& stream) {
+        stream << "segment,side,pass,rays,hits,cache_hits,segments_visited,faces_touched,energy,time_us\n";
+        for (auto& e : report.Entries) {
+            stream << fmt::format("{},{},{},{},{},{},{},{},{:.4f},{}\n",
+                                  (int)e.Source.Segment, (int)e.Source.Side, e.Pass,
+                                  e.RaysCast, e.RayHits, e.CacheHits, e.SegmentsVisited, e.FacesTouched, e.Energy, e.Time);
+        }
+    }
+
+    void ExportLightingReport(const LightingReport& report, const filesystem::path& path) {
+        std::ofstream file(path);
+        if (!file) throw Exception(fmt::format("Unable to open {}", path.string()));
+
+        auto ext = path.extension().string();
+        if (String::InvariantEquals(ext, ".csv"))
+            WriteLightingReportCsv(report, file);
+        else
+            WriteLightingReportJson(report, file);
+    }
+
+    LevelLighting CaptureLighting(const Level& level) {
+        LevelLighting lighting;
+        lighting.Sides.reserve(level.Segments.size());
+        lighting.VolumeLight.reserve(level.Segments.size());
+
+        for (auto& seg : level.Segments) {
+            auto& sides = lighting.Sides.emplace_back();
+            for (int i = 0; i < 6; i++)
+                sides[i] = seg.Sides[i].Light;
+
+            lighting.VolumeLight.push_back(seg.VolumeLight);
+        }
+
+        lighting.LightDeltaIndices = level.LightDeltaIndices;
+        lighting.LightDeltas = level.LightDeltas;
+        lighting.Probes = level.LightProbes;
+        return lighting;
+    }
+
+    bool ApplyLighting(Level& level, const LevelLighting& lighting) {
+        // Segment IDs are no longer valid if segments were added or removed while lighting
+        if (lighting.Sides.size() != level.Segments.size()) return false;
+
+        for (int id = 0; id < level.Segments.size(); id++) {
+            auto& seg = level.Segments[id];
+
+            for (int i = 0; i < 6; i++) {
+                auto& side = seg.Sides[i];
+                for (int vert = 0; vert < 4; vert++) {
+                    if (side.LockLight[vert]) continue; // Lock could have been set during the job
+                    side.Light[vert] = lighting.Sides[id][i][vert];
                 }
             }
 
+            if (!seg.LockVolumeLight)
+                seg.VolumeLight = lighting.VolumeLight[id];
+
+            seg.LightSubtracted = 0;
+        }
+
+        level.LightDeltaIndices = lighting.LightDeltaIndices;
+        level.LightDeltas = lighting.LightDeltas;
+        level.LightProbes = lighting.Probes;
+        return true;
+    }
+
+    // Lights the level geometry and volumes using the context for all intermediate state
+    void LightLevel(LightContext& ctx, Level& level, const LightSettings& settings) {
+        auto inputHash = HashLightingInputs(level, settings);
+
+        if (settings.UseCache) {
+            if (auto cached = LightCache::Load(inputHash); cached && ApplyLighting(level, cached->Lighting)) {
+                // Replay the warnings of the run that produced the cache, such as running out of dynamic lights
+                ctx.Warnings = std::move(cached->Warnings);
+                ctx.Report.FromCache = true;
+                ctx.Report.BouncesRun = cached->BouncesRun;
+                ctx.Report.SkippedBounces = cached->SkippedBounces;
+                ctx.Report.Probes = cached->Probes;
+                SPDLOG_INFO("Loaded lighting from cache {:016x}", inputHash);
+                return;
+            }
+        }
+
+        {
+            // Jobs start with a copy of the editor's visibility, so usually only edited rows are rebuilt
+            ScopedTimer timer(&ctx.Report.VisibilityTime);
+            ctx.Visibility.Update(level);
+        }
+
+        ctx.HitTests.reserve(1'000'000);
+        ctx.RayCasts.reserve(1000);
+        ctx.SideIndex.Resize(level.Segments.size() * 6);
+        level.LightDeltaIndices.clear();
+        level.LightDeltas.clear();
+
+        SetAmbientLight(level, settings.Ambient);
+
+        auto bounces = std::clamp(settings.Bounces, 0, 10);
+        auto passes = bounces + 1;
+        auto maxValue = std::clamp(settings.MaxValue, 0.0f, 10.0f);
+        const Color max = { maxValue, maxValue, maxValue, 1 };
+
+        auto sources = GatherLightSources(level, settings);
+        EmitDirectLight(ctx, level, settings, sources, passes);
+
+        if (ctx.OnPreview) {
+            // Apply the direct light to a copy so the final result isn't affected
+            Level preview = level;
             if (!settings.EnableColor)
-                DesaturateAccumulated(RayCasts);
-            
-            auto maxValue = std::clamp(settings.MaxValue, 0.0f, 10.0f);
-            const Color max = { maxValue, maxValue, maxValue, 1 };
-            SetSideLighting(level, RayCasts, max, settings.EnableColor);
+                DesaturateAccumulated(ctx.RayCasts);
+
+            SetSideLighting(preview, ctx.RayCasts, max, settings.EnableColor);
             if (settings.EnableColor)
-                ClampColorBrightness(level, settings.MaxValue);
+                ClampColorBrightness(preview, settings.MaxValue);
+
+            SetVolumeLight(preview, settings.AccurateVolumes);
+            ctx.OnPreview(CaptureLighting(preview));
+        }
+
+        float directEnergy = 0;
+        for (auto& [_, cast] : ctx.RayCasts)
+            directEnergy += cast.DirectEnergy;
+
+        // Accumulate radiosity bounces until they stop adding meaningful light
+        for (int i = 0; i < bounces; i++) {
+            int source = 0;
+            float passEnergy = 0;
+
+            for (auto& [tag, light] : ctx.RayCasts) {
+                ctx.Progress(i + 1, passes, source++, (int)ctx.RayCasts.size());
+
+                if (light.Converged) {
+                    ctx.Report.SkippedBounces++;
+                    continue;
+                }
+
+                auto& stats = ctx.Measure(tag, i + 1, [&]() -> LightRayCast& {
+                    auto& info = CastBounces(ctx, level, settings, light);
+                    info.AccumulatePass(ctx.SideIndex, !(settings.SkipFirstPass && i == 0));
+                    return info;
+                });
+
+                passEnergy += stats.Energy;
+
+                // Further bounces from this light would be dimmer still
+                if (stats.Energy <= light.DirectEnergy * settings.BounceCutoff)
+                    light.Converged = true;
+            }
+
+            ctx.Report.BouncesRun++;
+            SPDLOG_INFO("Bounce {} added {:.2f} energy ({:.2f}% of direct light)",
+                        i + 1, passEnergy, directEnergy > 0 ? passEnergy / directEnergy * 100 : 0.0f);
+
+            if (passEnergy <= directEnergy * settings.BounceEpsilon)
+                break; // converged
+        }
+
+        ctx.CheckCancel();
+
+        if (!settings.EnableColor)
+            DesaturateAccumulated(ctx.RayCasts);
+
+        SetSideLighting(level, ctx.RayCasts, max, settings.EnableColor);
+        if (settings.EnableColor)
+            ClampColorBrightness(level, settings.MaxValue);
+
+        SetVolumeLight(level, settings.AccurateVolumes);
+        BakeLightProbes(ctx, level, settings, sources);
+        SetDynamicLights(ctx, level);
+
+        size_t bufferBytes = ctx.SideIndex.MemoryUsage();
+        for (auto& [_, cast] : ctx.RayCasts)
+            bufferBytes += cast.MemoryUsage();
+
+        ctx.Report.LightBufferBytes = bufferBytes;
+        SPDLOG_INFO("Light buffers: {} KB for {} sources", bufferBytes / 1024, ctx.RayCasts.size());
+
+        if (settings.UseCache && ctx.Report.ProbesSkipped > 0) {
+            // A later run with the same inputs could finish the bake, so don't keep the degraded probes
+            SPDLOG_WARN("Not caching lighting because light probes ran out of time");
+        }
+        else if (settings.UseCache) {
+            LightCache::Save(inputHash, {
+                .Lighting = CaptureLighting(level),
+                .Warnings = ctx.Warnings,
+                .BouncesRun = ctx.Report.BouncesRun,
+                .SkippedBounces = ctx.Report.SkippedBounces,
+                .Probes = ctx.Report.Probes
+            });
+        }
+    }
+
+    void ShowLightWarnings(const List<wstring>& warnings) {
+        for (auto& warning : warnings)
+            ShowWarningMessage(warning);
+    }
+
+    // Lights a copy of the level in the background
+    class LightWorker : public WorkerThread {
+        std::mutex _lock;
+        Option<Level> _request;
+        LightSettings _settings;
+        bool _preview = false;
+        bool _started = false;
+
+        Option<LevelLighting> _previewResult, _result;
+        List<wstring> _warnings;
+        string _error;
+        LightingReport _report;
+        SegmentVisibility _visibility; // Visibility of the requested level when the job was requested
+
+        std::atomic<bool> _cancel = false;
+        std::atomic<bool> _running = false;
+        std::condition_variable _idle; // Signalled when the worker stops running jobs
+        std::atomic<int> _pass, _passes, _source, _sources;
+
+    public:
+        ~LightWorker() override {
+            _cancel = true;
+            Stop();
+        }
+
+        void Request(const Level& level, const SegmentVisibility& visibility, const LightSettings& settings, bool preview) {
+            {
+                std::scoped_lock lock(_lock);
+                _cancel = true; // abort the job in progress, if any
+                _request = level;
+                _visibility = visibility;
+                _settings = settings;
+                _preview = preview;
+                _previewResult = {};
+                _result = {};
+                _running = true;
+            }
+
+            _pass = _source = _sources = 0;
+            _passes = 1;
+
+            if (!_started) {
+                Start();
+                _started = true;
+            }
+
+            Notify();
+        }
+
+        void Cancel() {
+            {
+                std::scoped_lock lock(_lock);
+                _request = {};
+                _cancel = true;
+            }
+
+            // Sources are small units of work, so the worker stops quickly
+            std::unique_lock lock(_lock);
+            _idle.wait(lock, [this] { return !_running; });
+            _previewResult = {};
+            _result = {};
+        }
+
+        bool IsRunning() const { return _running; }
+
+        LightProgress GetProgress() const {
+            return { _pass, _passes, _source, _sources };
+        }
+
+        Option<LevelLighting> TakePreview() {
+            std::scoped_lock lock(_lock);
+            auto preview = std::move(_previewResult);
+            _previewResult = {};
+            return preview;
+        }
+
+        // Returns the final lighting, warnings and error message if the job finished
+        bool TakeResult(Option<LevelLighting>& result, List<wstring>& warnings, string& error) {
+            std::scoped_lock lock(_lock);
+            if (!_result && _error.empty()) return false;
+
+            result = std::move(_result);
+            warnings = std::move(_warnings);
+            error = std::move(_error);
+            _result = {};
+            _warnings = {};
+            _error = {};
+
+            if (result)
+                SetLightingReport(std::move(_report));
 
-            SetVolumeLight(level, settings.AccurateVolumes);
-            SetDynamicLights(level, RayCasts);
+            return true;
+        }
+
+    protected:
+        void Work() override {
+            Level level;
+            SegmentVisibility visibility;
+            LightSettings settings;
+            bool preview;
+
+            {
+                std::scoped_lock lock(_lock);
+                if (!_request) {
+                    SetIdle(); // cancelled before the job started
+                    return;
+                }
+
+                level = std::move(*_request);
+                _request = {};
+                visibility = std::move(_visibility);
+                _visibility = {};
+                settings = _settings;
+                preview = _preview;
+                _cancel = false;
+            }
+
+            LightContext ctx;
+            ctx.Visibility = std::move(visibility);
+            ctx.Cancel = &_cancel;
+            ctx.OnProgress = [this](const LightProgress& progress) {
+                _pass = progress.Pass;
+                _passes = progress.Passes;
+                _source = progress.Source;
+                _sources = progress.Sources;
+            };
+
+            if (preview) {
+                ctx.OnPreview = [this](LevelLighting&& lighting) {
+                    std::scoped_lock lock(_lock);
+                    _previewResult = std::move(lighting);
+                };
+            }
+
+            try {
+                {
+                    ScopedTimer timer(&ctx.Report.TotalTime);
+                    LightLevel(ctx, level, settings);
+                }
+
+                std::scoped_lock lock(_lock);
+                if (!_request) {
+                    _result = CaptureLighting(level);
+                    _warnings = std::move(ctx.Warnings);
+                    _report = std::move(ctx.Report);
+                }
+            }
+            catch (const LightCancelled&) {
+                SPDLOG_INFO("Lighting cancelled");
+            }
+            catch (const std::exception& e) {
+                std::scoped_lock lock(_lock);
+                _error = e.what();
+            }
+
+            std::scoped_lock lock(_lock);
+            if (!_request) SetIdle(); // keep running if another job was requested
+        }
+
+    private:
+        // Call while holding the lock
+        void SetIdle() {
+            _running = false;
+            _idle.notify_all();
+        }
+    };
+
+    namespace {
+        LightWorker LightJob;
+        Option<LevelLighting> LightingBeforePreview; // Restored if the job is cancelled after a preview
+    }
+
+    void StartLightJob(const Level& level, const LightSettings& settings, bool preview) {
+        LightJob.Request(level, Game::Visibility, settings, preview);
+    }
+
+    void CancelLightJob() {
+        LightJob.Cancel();
+
+        if (LightingBeforePreview) {
+            ApplyLighting(Game::Level, *LightingBeforePreview);
+            LightingBeforePreview = {};
+            Events::LevelChanged();
+        }
+    }
+
+    bool LightJobRunning() { return LightJob.IsRunning(); }
+
+    LightProgress GetLightJobProgress() { return LightJob.GetProgress(); }
+
+    void UpdateLightJob(Level& level) {
+        if (auto preview = LightJob.TakePreview()) {
+            auto before = CaptureLighting(level);
+            if (ApplyLighting(level, *preview)) {
+                if (!LightingBeforePreview)
+                    LightingBeforePreview = std::move(before);
+
+                Events::LevelChanged();
+            }
+        }
+
+        Option<LevelLighting> result;
+        List<wstring> warnings;
+        string error;
+        if (!LightJob.TakeResult(result, warnings, error)) return;
+
+        if (!error.empty()) {
+            if (LightingBeforePreview) {
+                ApplyLighting(level, *LightingBeforePreview);
+                Events::LevelChanged();
+            }
+
+            LightingBeforePreview = {};
+            ShowErrorMessage(Convert::ToWideString(error));
+            return;
+        }
+
+        LightingBeforePreview = {};
+
+        if (result && ApplyLighting(level, *result)) {
+            Editor::History.SnapshotLevel("Light Level");
+            Events::LevelChanged();
+            SetStatusMessage("Lighting finished in {:.3f} s", Metrics::LightCalculationTime / 1000000.0f);
+            ShowLightWarnings(warnings);
+        }
+        else {
+            SetStatusMessageWarn("Segments were added or removed while lighting. Results were discarded.");
+        }
+    }
+
+    LightLevelResult LightLevelHeadless(Level& level, const LightSettings& settings) {
+        LightContext ctx;
+
+        {
+            ScopedTimer timer(&ctx.Report.TotalTime);
+            LightLevel(ctx, level, settings);
+        }
+
+        return { std::move(ctx.Report), std::move(ctx.Warnings) };
+    }
+
+    void Commands::LightLevel(Level& level, const LightSettings& settings) {
+        try {
+            ScopedCursor cursor(IDC_WAIT);
+            auto result = LightLevelHeadless(level, settings);
+            SetLightingReport(std::move(result.Report));
+            ShowLightWarnings(result.Warnings);
             Editor::History.SnapshotLevel("Light Level");
         }
         catch (const std::exception& e) {
             ShowErrorMessage(e);
         }
     }
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Level.h"
 #include "Settings.h"
 
 namespace Inferno::Editor {
@@ -19,7 +20,108 @@ namespace Inferno::Editor {
 
     Color GetLightColor(const SegmentSide& side);
 
+    // Instrumentation for a single light source during one pass
+    struct LightStats {
+        Tag Source;
+        int Pass = 0; // 0 is direct light, 1+ are bounces
+        int RaysCast = 0;
+        int RayHits = 0;
+        int CacheHits = 0;
+        int SegmentsVisited = 0;
+        int FacesTouched = 0;
+        float Energy = 0; // Sum of the light added by the pass
+        int64 Time = 0; // Microseconds
+
+        LightStats& operator+=(const LightStats& rhs) {
+            RaysCast += rhs.RaysCast;
+            RayHits += rhs.RayHits;
+            CacheHits += rhs.CacheHits;
+            SegmentsVisited += rhs.SegmentsVisited;
+            FacesTouched += rhs.FacesTouched;
+            Energy += rhs.Energy;
+            Time += rhs.Time;
+            return *this;
+        }
+    };
+
+    struct LightingReport {
+        List<LightStats> Entries; // One entry per source for each pass
+        int64 TotalTime = 0; // Microseconds, includes work outside of sources
+        size_t LightBufferBytes = 0; // Memory used by the per-source light accumulation buffers
+        int BouncesRun = 0; // Bounce passes run before converging
+        int SkippedBounces = 0; // Source bounces skipped due to low energy
+        bool FromCache = false; // Results were loaded from the lighting cache
+        int Probes = 0; // Volumetric light probes baked
+        int ProbesSkipped = 0; // Segments filled with their volume light when baking ran out of time
+        int64 ProbeTime = 0; // Microseconds spent baking probes
+        int64 VisibilityTime = 0; // Microseconds spent updating the segment visibility sets
+
+        LightStats Total() const;
+        List<LightStats> BySource() const; // Sorted by time, slowest first
+        List<LightStats> ByPass() const;
+    };
+
+    // Returns the report from the last completed lighting run
+    const LightingReport& GetLightingReport();
+
+    void WriteLightingReportJson(const LightingReport&, std::ostream&);
+    void WriteLightingReportCsv(const LightingReport&, std::ostream&);
+
+    // Writes a CSV file of all entries if the extension is .csv, otherwise writes JSON
+    void ExportLightingReport(const LightingReport&, const filesystem::path&);
+
+    // Progress of a lighting job. Reported once per source for each pass.
+    struct LightProgress {
+        int Pass = 0; // 0 is direct light, 1+ are bounces
+        int Passes = 1;
+        int Source = 0;
+        int Sources = 0;
+
+        float Fraction() const {
+            if (Passes <= 0 || Sources <= 0) return 0;
+            return ((float)Pass + (float)Source / (float)Sources) / (float)Passes;
+        }
+    };
+
+    using LightProgressCallback = std::function<void(const LightProgress&)>;
+
+    // Light values produced by the lighting algorithm. Used to move results between level copies.
+    struct LevelLighting {
+        List<Array<SideLighting, 6>> Sides;
+        List<Color> VolumeLight;
+        List<LightDeltaIndex> LightDeltaIndices;
+        List<LightDelta> LightDeltas;
+        LightProbeGrid Probes;
+    };
+
+    LevelLighting CaptureLighting(const Level&);
+
+    // Copies lighting into the level. Returns false if the level no longer matches the lighting.
+    bool ApplyLighting(Level&, const LevelLighting&);
+
+    // Lights a copy of the level on a worker thread. Replaces any job in progress.
+    // Intermediate results after the direct light pass are applied to the level when preview is true.
+    void StartLightJob(const Level&, const LightSettings&, bool preview = true);
+
+    // Cancels the active light job and waits for the worker to stop
+    void CancelLightJob();
+
+    bool LightJobRunning();
+    LightProgress GetLightJobProgress();
+
+    // Applies preview and final results from the light worker. Must be called from the main thread.
+    void UpdateLightJob(Level&);
+
+    struct LightLevelResult {
+        LightingReport Report;
+        List<wstring> Warnings;
+    };
+
+    // Lights the level without any UI. Levels that share the loaded resources can be lit in parallel.
+    LightLevelResult LightLevelHeadless(Level&, const LightSettings&);
+
     namespace Commands {
+        // Lights the level on the calling thread
         void LightLevel(Level&, const LightSettings&);
     }
-}
\ No newline at end of file
+}
@@ -9,8 +9,8 @@ namespace Inferno::Editor {
         auto pObj = level.TryGetObject(id);
         if (!pObj) return;
 
-        Events::ObjectsChanged();
         Seq::removeAt(level.Objects, (int)id);
+        Events::ObjectsChanged();
         // Shift object? are there any refs?
     }
 
@@ -43,7 +43,7 @@ namespace Inferno::Editor {
         else
             transform.Translation(face.Center() + normal * distance); // position on face
 
-        obj->Segment = tag.Segment;
+        level.RelinkObject(id, tag.Segment);
         obj->SetTransform(transform);
         return true;
     }
@@ -53,7 +53,7 @@ namespace Inferno::Editor {
         auto seg = level.TryGetSegment(segId);
         if (!obj || !seg) return false;
 
-        obj->Segment = segId;
+        level.RelinkObject(id, segId);
         obj->Position = seg->Center;
         return true;
     }
@@ -66,7 +66,7 @@ namespace Inferno::Editor {
 
         // Leave the last good ID if nothing contains the object
         auto segId = FindContainingSegment(level, position);
-        if (segId != SegID::None) obj->Segment = segId;
+        if (segId != SegID::None) level.RelinkObject(id, segId);
         return true;
     }
 
@@ -263,8 +263,7 @@ namespace Inferno::Editor {
                 break;
         }
 
-        auto id = (ObjID)level.Objects.size();
-        level.Objects.push_back(obj);
+        auto id = level.AddObject(obj);
 
         Selection.SetSelection(id);
         MoveObjectToSide(level, id, tag, true);
@@ -299,7 +298,7 @@ namespace Inferno::Editor {
         if (auto seg = level.TryGetSegment(level.SecretExitReturn))
             marker.Position = seg->Center;
 
-        level.Objects.push_back(marker);
+        level.AddObject(marker);
         Render::LoadModelDynamic(marker.Render.Model.ID);
     }
 
@@ -327,7 +326,12 @@ namespace Inferno::Editor {
         if (!PointInSegment(level, obj.Segment, obj.Position)) {
             auto id = FindContainingSegment(level, obj.Position);
             // Leave the last good ID if nothing contains the object
-            if (id != SegID::None) obj.Segment = id;
+            if (id == SegID::None) return;
+
+            if (auto objId = level.GetObjectID(obj); objId != ObjID::None)
+                level.RelinkObject(objId, id);
+            else
+                obj.Segment = id;
         }
     }
 
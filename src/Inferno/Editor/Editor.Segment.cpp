@@ -337,6 +337,7 @@ namespace Inferno::Editor {
         }
 
         Editor::Marked.RemoveSegment(segId);
+        level.LightProbes.RemoveSegment(segId); // Probes are addressed by segment
 
         // Delete the segment
         ShiftSegmentRefs(level, segId, -1);
@@ -837,6 +838,7 @@ namespace Inferno::Editor {
             removedLight |= Editor::RemoveFlickeringLight(Game::Level, tag);
 
         if (removedLight) {
+            Events::LevelChanged();
             Editor::History.SnapshotSelection();
             Editor::History.SnapshotLevel("Remove flickering light");
         }
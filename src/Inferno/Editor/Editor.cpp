@@ -17,6 +17,9 @@
 #include "Editor.IO.h"
 #include "Version.h"
 #include "Game.Segment.h"
+#include "Game.Visibility.h"
+#include "Game.Navigation.h"
+#include "Game.CollisionMesh.h"
 #include "Graphics/Render.Particles.h"
 
 namespace Inferno::Editor {
@@ -165,8 +168,7 @@ namespace Inferno::Editor {
             List<ObjID> newObjects;
             for (auto& id : GetSelectedObjects()) {
                 if (auto obj = level.TryGetObject(id)) {
-                    newObjects.push_back((ObjID)level.Objects.size());
-                    level.Objects.push_back(*obj);
+                    newObjects.push_back(level.AddObject(*obj));
                 }
             }
 
@@ -271,6 +273,8 @@ namespace Inferno::Editor {
     bool ImGuiHadMouseFocus = false;
 
     void Update() {
+        UpdateLightJob(Game::Level);
+
         // don't do anything when a modal is open
         if (ImGui::GetTopMostPopupModal()) return;
 
@@ -466,6 +470,9 @@ namespace Inferno::Editor {
             if (auto seg = level.TryGetSegment(light.Tag))
                 Inferno::AddLight(level, light.Tag, *seg);
         }
+
+        Game::FlickerSchedule.Reset();
+        Events::LevelChanged();
     }
 
     void OnLevelLoad(bool reload) {
@@ -518,7 +525,25 @@ namespace Inferno::Editor {
         Events::LevelLoaded += [] { Editor::Gizmo.UpdatePosition(); };
         Events::SelectObject += [] { Editor::Gizmo.UpdatePosition(); };
         Events::SelectSegment += [] { Editor::Gizmo.UpdatePosition(); };
-        Events::LevelChanged += [] { Editor::Gizmo.UpdatePosition(); };
+        Events::LevelChanged += [] {
+            Editor::Gizmo.UpdatePosition();
+            // Vertex edits only raise LevelChanged. Door animations also raise it while playing,
+            // but they only change textures so nothing is rebuilt.
+            Game::CollisionMesh.Update(Game::Level);
+        };
+        Events::SegmentsChanged += [] {
+            Game::Visibility.Update(Game::Level);
+            Game::CollisionMesh.Update(Game::Level);
+            Game::Navigation.Build(Game::Level);
+            Game::Level.RebuildObjectLists();
+        };
+        Events::SnapshotChanged += [] {
+            Game::Visibility.Update(Game::Level);
+            Game::CollisionMesh.Update(Game::Level);
+            Game::Navigation.Build(Game::Level);
+            Game::Level.RebuildObjectLists();
+        };
+        Events::ObjectsChanged += [] { Game::Level.RebuildObjectLists(); };
 
         if (Settings::Editor.ReopenLastLevel &&
             !Settings::Editor.RecentFiles.empty() &&
@@ -3,16 +3,110 @@
 #include "WindowBase.h"
 #include "Graphics/Render.h"
 #include "Graphics/Render.Debug.h"
+#include "Graphics/Render.Particles.h"
 #include "Input.h"
 #include "../Editor.h"
 #include "Physics.h"
+#include "Game.CollisionMesh.h"
+#include "Game.Broadphase.h"
+#include "Game.Simulation.h"
+#include "Game.Benchmark.h"
+#include "Game.Segment.h"
+#include "Game.Navigation.h"
+#include "Game.AI.h"
+#include "WindowsDialogs.h"
 
 namespace Inferno::Editor {
     class DebugWindow : public WindowBase {
         float _frameTime = 0, _timeCounter = 1;
+        int _stressCount = 300;
+        List<BroadphaseBenchmark> _broadphaseResults;
+        Option<ReplayReport> _replayReport;
+        Option<InputRecording> _lastRecording; // Keeps the level snapshot, unlike a saved recording
+        List<DataPoolBenchmark> _poolResults;
+        List<NavigationBenchmark> _navigationResults;
+        Option<SimulationBenchmark> _simulationResult;
+        Option<SimulationBenchmark> _stressResult;
+        Option<LevelMeshBenchmark> _levelMeshResult;
     public:
         DebugWindow() : WindowBase("Debug") { IsOpen(false); }
     protected:
+        void Replay(const InputRecording& recording) {
+            _replayReport = ReplayHeadless(Game::Level, recording);
+            SPDLOG_INFO("Replayed {} ticks in {:.3f} ms with {} checksum mismatches",
+                        recording.Inputs.size(), _replayReport->TotalTime / 1000.0f, _replayReport->Mismatches);
+        }
+
+        void RecordInput() {
+            static const COMDLG_FILTERSPEC filter[] = { { L"Input Recording", L"*.irec" } };
+            auto& simulation = Game::Simulation;
+
+            if (simulation.IsRecording()) {
+                if (ImGui::Button("Stop recording")) {
+                    auto recording = simulation.StopRecording();
+
+                    try {
+                        if (auto path = SaveFileDialog(filter, 1, L"recording.irec", L"Save Input Recording")) {
+                            recording->Save(*path);
+                            SetStatusMessage("Saved {} ticks to {}", recording->Inputs.size(), path->string());
+                        }
+                    }
+                    catch (const std::exception& e) {
+                        SetStatusMessageWarn("Error saving recording: {}", e.what());
+                    }
+
+                    _lastRecording = std::move(recording);
+                }
+
+                ImGui::SameLine();
+                ImGui::Text("Recording: %d ticks", simulation.RecordedTicks());
+            }
+            else {
+                if (ImGui::Button("Record input")) {
+                    simulation.StartRecording(Game::Level);
+                    Settings::Editor.EnablePhysics = true;
+                }
+
+                ImGui::SameLine();
+                if (ImGui::Button("Replay recording")) {
+                    try {
+                        if (auto path = OpenFileDialog(filter, L"Replay Input Recording")) {
+                            auto recording = InputRecording::Load(*path);
+                            Replay(recording);
+
+                            std::ofstream csv(filesystem::path(*path).replace_extension(".csv"));
+                            WriteReplayReportCsv(*_replayReport, csv);
+                        }
+                    }
+                    catch (const std::exception& e) {
+                        SetStatusMessageWarn("Error replaying recording: {}", e.what());
+                    }
+                }
+                ImGui::HelpMarker("Replays a saved recording from the current state of the loaded level without rendering.\nWrites the time and checksum of each tick to a csv next to the recording.");
+
+                if (_lastRecording) {
+                    ImGui::SameLine();
+                    if (ImGui::Button("Replay last"))
+                        Replay(*_lastRecording);
+
+                    ImGui::HelpMarker("Replays the last recording from the level as it was when recording started");
+                }
+            }
+
+            if (_replayReport) {
+                auto& report = *_replayReport;
+                auto ticks = (int)report.TickTimes.size();
+                ImGui::Text("Replay: %d ticks in %.3f ms, max tick %.3f ms", ticks, report.TotalTime / 1000.0f, report.MaxTickTime() / 1000.0f);
+
+                if (!report.StartMatches)
+                    ImGui::TextColored({ 1, 0.5f, 0, 1 }, "Level state doesn't match the start of the recording");
+                else if (report.Mismatches > 0)
+                    ImGui::TextColored({ 1, 0.5f, 0, 1 }, "Diverged at tick %d (%d mismatches)", report.FirstMismatch, report.Mismatches);
+                else
+                    ImGui::Text("All checksums match");
+            }
+        }
+
         void OnUpdate() override {
             _timeCounter += (float)Render::FrameTime;
 
@@ -26,6 +120,160 @@ namespace Inferno::Editor {
             ImGui::Text("Ship accel: %.2f, %.2f, %.2f", Debug::ShipAcceleration.x, Debug::ShipAcceleration.y, Debug::ShipAcceleration.z);
             //ImGui::Text("Ship thrust: %.3f, %.3f, %.3f", Debug::ShipThrust.x, Debug::ShipThrust.y, Debug::ShipThrust.z);
             ImGui::Text("steps: %.2f  R: %.4f  K: %.2f", Debug::Steps, Debug::R, Debug::K);
+            ImGui::Text("Physics: %.3f ms  Objects: %d", Debug::UpdateTime / 1000.0f, (int)Game::Level.Objects.size());
+
+            ImGui::Text("Move: %.3f ms  Apply: %.3f ms", Debug::MoveTime / 1000.0f, Debug::ApplyTime / 1000.0f);
+            ImGui::Text("Level queries: %d in %.3f ms  Allocations: %lld", Debug::Queries.load(), Debug::QueryTime.load() / 1000.0f, Debug::Allocations);
+            ImGui::Text("Sweep iterations: %d", Debug::SweepIterations.load());
+            ImGui::Text("Portal search heap spills: %d", Debug::PortalSearchOverflows.load());
+
+            auto& collision = Game::CollisionMesh.GetStats();
+            ImGui::Text("Collision mesh: %d KB, %d segs rebuilt in %.3f ms",
+                        (int)(collision.Bytes / 1024), collision.SegmentsBuilt, collision.BuildTime / 1000.0f);
+
+            ImGui::SetNextItemWidth(120);
+            ImGui::SliderInt("##stress", &_stressCount, 50, 1000);
+            ImGui::SameLine();
+            if (ImGui::Button("Spawn projectiles") && !Game::Level.Objects.empty())
+                SpawnTestProjectiles(Game::Level, ObjID(0), _stressCount, 13);
+            ImGui::HelpMarker("Fires projectiles in random directions from the player to stress collision queries.\nEnable physics to run them.");
+
+            ImGui::SameLine();
+            if (ImGui::Button("Time projectiles")) {
+                _stressResult = RunSimulationBenchmark(Game::Level, { .Ticks = 320, .Weapons = _stressCount });
+                SPDLOG_INFO("Projectile stress benchmark ran {} ticks with {} projectiles in {:.3f} ms",
+                            _stressResult->Options.Ticks, _stressCount, _stressResult->TotalTime / 1000.0f);
+            }
+            ImGui::HelpMarker("Runs 5 seconds of physics on a copy of the level with the projectiles and times the level queries");
+
+            if (_stressResult) {
+                auto physics = _stressResult->GetSubsystem("physics");
+                auto queries = _stressResult->GetSubsystem("physics.queries");
+
+                if (physics && queries) {
+                    auto queryTime = queries->Mean() * queries->Times.size();
+                    ImGui::Text("%d projectiles: physics p50 %.3f ms, p95 %.3f ms, %lld queries at %.2f us each",
+                                _stressResult->Options.Weapons, physics->Percentile(50) / 1000, physics->Percentile(95) / 1000,
+                                _stressResult->Queries, _stressResult->Queries ? queryTime / _stressResult->Queries : 0.0);
+                }
+            }
+
+            auto& broadphase = Game::Broadphase.GetStats();
+            ImGui::Text("Broadphase: %d objects, %d pairs (%d x overlaps) in %.3f ms",
+                        broadphase.Objects, broadphase.Pairs, broadphase.Overlaps, broadphase.BuildTime / 1000.0f);
+
+            if (ImGui::Button("Benchmark broadphase")) {
+                _broadphaseResults.clear();
+                for (auto count : { 50, 500, 5000 }) {
+                    auto& result = _broadphaseResults.emplace_back(RunBroadphaseBenchmark(Game::Level, count));
+                    SPDLOG_INFO("Broadphase benchmark {} objects: all pairs {:.3f} ms, broadphase {:.3f} ms, {} candidate pairs, {} contacts",
+                                count, result.BruteForceTime / 1000.0f, result.BroadphaseTime / 1000.0f, result.Stats.Pairs, result.Contacts);
+                }
+            }
+            ImGui::HelpMarker("Scatters moving objects through the level and compares the broadphase to testing every pair");
+
+            for (auto& result : _broadphaseResults) {
+                ImGui::Text("%d objects: all pairs %.3f ms, broadphase %.3f ms, %d pairs, %d contacts",
+                            result.Objects, result.BruteForceTime / 1000.0f, result.BroadphaseTime / 1000.0f, result.Stats.Pairs, result.Contacts);
+            }
+
+            if (ImGui::Button("Benchmark data pool")) {
+                _poolResults.clear();
+                for (auto count : { 100, 1000, 10000 }) {
+                    auto& result = _poolResults.emplace_back(RunDataPoolBenchmark(count, 1000));
+                    SPDLOG_INFO("DataPool benchmark {} elements: pool {:.3f} ms, scanning list {:.3f} ms",
+                                count, result.PoolTime / 1000.0f, result.ScanTime / 1000.0f);
+                }
+            }
+            ImGui::HelpMarker("Adds, updates and prunes short lived elements for 1000 rounds.\nCompares the pool to reusing dead elements by scanning a list.");
+
+            for (auto& result : _poolResults) {
+                ImGui::Text("%d elements: pool %.3f ms, scanning list %.3f ms, %d slots",
+                            result.Elements, result.PoolTime / 1000.0f, result.ScanTime / 1000.0f, (int)result.Slots);
+            }
+
+            if (ImGui::Button("Benchmark simulation")) {
+                SimulationBenchmarkOptions options{ .Ticks = 640, .Robots = 100, .Weapons = 200, .Particles = 1000 };
+                _simulationResult = RunSimulationBenchmark(Game::Level, options);
+                SPDLOG_INFO("Simulation benchmark ran {} ticks in {:.3f} ms", options.Ticks, _simulationResult->TotalTime / 1000.0f);
+            }
+            ImGui::HelpMarker("Runs 10 seconds of ticks on a copy of the level with extra robots, projectiles and particles.\nThe same benchmark runs without a window using --benchmark.");
+
+            if (_simulationResult) {
+                ImGui::SameLine();
+                if (ImGui::Button("Save CSV")) {
+                    static const COMDLG_FILTERSPEC filter[] = { { L"CSV", L"*.csv" } };
+                    if (auto path = SaveFileDialog(filter, 1, L"benchmark.csv", L"Save Benchmark")) {
+                        std::ofstream stream(*path);
+                        WriteSimulationBenchmarkCsv(*_simulationResult, stream);
+                    }
+                }
+
+                for (auto& subsystem : _simulationResult->Subsystems) {
+                    ImGui::Text("%s: p50 %.1f us, p95 %.1f us, p99 %.1f us, max %.1f us, %lld allocs",
+                                subsystem.Name.c_str(), subsystem.Percentile(50), subsystem.Percentile(95),
+                                subsystem.Percentile(99), subsystem.Percentile(100), subsystem.Allocations.value_or(0));
+                }
+            }
+
+            auto& navigation = Game::Navigation.GetStats();
+            ImGui::Text("Navigation: %d fields, %d builds, %d repairs, last repair %d segs in %.3f ms",
+                        navigation.Fields, navigation.FieldBuilds, navigation.FieldRepairs,
+                        navigation.SegmentsRepaired, navigation.RepairTime / 1000.0f);
+
+            if (ImGui::Button("Benchmark pathfinding")) {
+                auto target = Game::Level.Objects.empty() ? SegID(0) : Game::Level.Objects[0].Segment;
+                _navigationResults.clear();
+                for (auto count : { 10, 100, 1000 }) {
+                    auto& result = _navigationResults.emplace_back(RunNavigationBenchmark(Game::Level, target, count));
+                    SPDLOG_INFO("Pathfinding benchmark {} robots: A* {:.3f} ms, distance field {:.3f} ms (built in {:.3f} ms), {} reachable",
+                                count, result.SearchTime / 1000.0f, result.FieldTime / 1000.0f, result.FieldBuildTime / 1000.0f, result.Reachable);
+                }
+            }
+            ImGui::HelpMarker("Paths robots in random segments to the player.\nCompares searching for each robot to stepping through a cached distance field.");
+
+            for (auto& result : _navigationResults) {
+                ImGui::Text("%d robots: A* %.3f ms, field %.3f ms, build %.3f ms, %d reachable",
+                            result.Robots, result.SearchTime / 1000.0f, result.FieldTime / 1000.0f, result.FieldBuildTime / 1000.0f, result.Reachable);
+            }
+
+            auto& ai = Game::AI.GetStats();
+            ImGui::Text("AI: %d robots, %d updates (max %d), %d deferred, %.3f ms (max %.3f ms)",
+                        ai.Robots, ai.Updates, ai.MaxUpdates, ai.Deferred, ai.Time / 1000.0f, ai.MaxTime / 1000.0f);
+            ImGui::Text("AI intervals: %d every tick, %d / 2, %d / 4, %d / 8, %d / 16",
+                        ai.Intervals[0], ai.Intervals[1], ai.Intervals[2], ai.Intervals[3], ai.Intervals[4]);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Reset##ai")) Game::AI.ResetStats();
+
+            auto& particles = Render::GetParticleStats();
+            ImGui::Text("Particles: %d in %d batches, update %.3f ms, build %.3f ms",
+                        particles.Particles, particles.Batches, particles.UpdateTime / 1000.0f, particles.BuildTime / 1000.0f);
+
+            auto& flicker = Game::FlickerSchedule.GetStats();
+            ImGui::Text("Flickering lights: %d scheduled, %d changed, %d vertex updates",
+                        flicker.Scheduled, flicker.Wakes, Render::Metrics::LightVertexUpdates);
+
+            auto& levelMesh = Render::GetLevelMeshStats();
+            ImGui::Text("Level mesh: last update %d segs in %.3f ms, %d full rebuilds",
+                        levelMesh.SegmentsUpdated, levelMesh.UpdateTime / 1000.0f, levelMesh.Rebuilds);
+
+            if (ImGui::Button("Benchmark mesh edits")) {
+                constexpr int drags = 100;
+                _levelMeshResult = RunLevelMeshBenchmark(Game::Level, drags);
+                SPDLOG_INFO("Level mesh benchmark {} segments: full {:.3f} ms, patched {:.3f} ms per drag",
+                            _levelMeshResult->Segments, _levelMeshResult->FullTime / 1000.0f / drags, _levelMeshResult->IncrementalTime / 1000.0f / drags);
+            }
+            ImGui::HelpMarker("Drags random vertices of a copy of the level.\nCompares rebuilding the level mesh to patching the changed segments.");
+
+            if (_levelMeshResult) {
+                auto& result = *_levelMeshResult;
+                auto drags = (float)std::max(result.Drags, 1);
+                ImGui::Text("%d segments: full %.3f ms, patched %.3f ms per drag, %.1f segs per drag, %d rebuilds%s",
+                            result.Segments, result.FullTime / drags / 1000, result.IncrementalTime / drags / 1000,
+                            result.SegmentsUpdated / drags, result.Rebuilds, result.Matches ? "" : ", MISMATCH");
+            }
+
+            RecordInput();
 
             ImGui::PlotLines("##vel", Debug::ShipVelocities.data(), (int)Debug::ShipVelocities.size(), 0, nullptr, 0, 60, ImVec2(0, 120.0f));
 
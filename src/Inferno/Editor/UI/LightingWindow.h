@@ -3,10 +3,12 @@
 #include "WindowBase.h"
 #include "Graphics/Render.h"
 #include "../Editor.Lighting.h"
+#include "../Editor.LightCache.h"
 #include "Game.Segment.h"
 
 namespace Inferno::Editor {
     class LightingWindow : public WindowBase {
+        bool _preview = true;
     public:
         LightingWindow() : WindowBase("Lighting", &Settings::Editor.Windows.Lighting) {}
 
@@ -45,6 +47,70 @@ namespace Inferno::Editor {
             }
         }
 
+        // Shows how much light each pass added in the last run
+        void DrawPassEnergy() {
+            auto& report = GetLightingReport();
+            if (report.FromCache) {
+                ImGui::Text("Loaded from cache");
+                return;
+            }
+
+            if (report.Entries.empty()) return;
+
+            ImGui::Text("Bounces run: %d (%d source bounces skipped)", report.BouncesRun, report.SkippedBounces);
+
+            if (ImGui::TreeNode("Energy per pass")) {
+                for (auto& pass : report.ByPass()) {
+                    if (pass.Pass == 0)
+                        ImGui::Text("Direct: %.1f", pass.Energy);
+                    else
+                        ImGui::Text("Bounce %d: %.1f", pass.Pass, pass.Energy);
+                }
+
+                ImGui::TreePop();
+            }
+        }
+
+        // Lists the most expensive light sources from the last run. Clicking one selects it.
+        void DrawSlowestSources() {
+            auto& report = GetLightingReport();
+            if (report.Entries.empty()) return;
+
+            if (ImGui::TreeNode("Slowest sources")) {
+                auto sources = report.BySource();
+                auto count = std::min((int)sources.size(), 10);
+
+                for (int i = 0; i < count; i++) {
+                    auto& src = sources[i];
+                    auto label = fmt::format("{}:{} - {:.1f} ms, {} rays, {} segs, {} faces",
+                                             (int)src.Source.Segment, (int)src.Source.Side, src.Time / 1000.0f,
+                                             src.RaysCast, src.SegmentsVisited, src.FacesTouched);
+
+                    if (ImGui::Selectable(label.c_str()) && Game::Level.SegmentExists(src.Source.Segment))
+                        Editor::Selection.SetSelection(src.Source);
+                }
+
+                ImGui::TreePop();
+            }
+
+            if (ImGui::Button("Export Report")) {
+                static const COMDLG_FILTERSPEC filter[] = {
+                    { L"JSON", L"*.json" },
+                    { L"CSV", L"*.csv" }
+                };
+
+                try {
+                    if (auto path = SaveFileDialog(filter, 1, L"lighting.json", L"Export Lighting Report")) {
+                        ExportLightingReport(report, *path);
+                        SetStatusMessage("Exported lighting report to {}", path->string());
+                    }
+                }
+                catch (const std::exception& e) {
+                    SetStatusMessageWarn("Error exporting lighting report: {}", e.what());
+                }
+            }
+        }
+
         void OnUpdate() override {
             auto& settings = Settings::Editor.Lighting;
             ImGui::ColorEdit3("Ambient", &settings.Ambient.x, ImGuiColorEditFlags_HDR | ImGuiColorEditFlags_Float);
@@ -78,10 +144,22 @@ namespace Inferno::Editor {
                 ImGui::SliderInt("Bounces", &settings.Bounces, 0, 5);
                 ImGui::SliderFloat("Reflectance", &settings.Reflectance, 0, 1);
                 ImGui::HelpMarker("How much light to keep after each bounce");
+                ImGui::SliderFloat("Bounce Cutoff", &settings.BounceCutoff, 0, 0.1f, "%.3f");
+                ImGui::HelpMarker("Stops bouncing a light once a pass adds less than this fraction of its direct light.\nSet to 0 to always run every bounce.");
+                ImGui::SliderFloat("Bounce Epsilon", &settings.BounceEpsilon, 0, 0.02f, "%.4f");
+                ImGui::HelpMarker("Stops all bounces once a pass adds less than this fraction of the total direct light");
                 //ImGui::Checkbox("Skip first bounce", &settings.SkipFirstPass);
                 //ImGui::HelpMarker("Experimental: Skip the first bounce of radiosity.\nReduces artifacting and smoothes the final result but loses saturation.");
             }
 
+            DrawHeader("Light Probes");
+            {
+                ImGui::SliderInt("Probes per axis", &settings.ProbeResolution, 0, 4);
+                ImGui::HelpMarker("Samples light at a grid of points inside each segment to shade objects.\nSet to 0 to use a single volume light per segment.");
+                ImGui::SliderFloat("Time limit", &settings.ProbeTimeLimit, 0, 120, "%.0f s");
+                ImGui::HelpMarker("Segments that aren't finished in time use their volume light. 0 is unlimited.");
+            }
+
             DrawHeader("Options");
             {
                 ImGui::Checkbox("Occlusion", &settings.EnableOcclusion);
@@ -93,20 +171,46 @@ namespace Inferno::Editor {
                 ImGui::Checkbox("Color", &settings.EnableColor);
                 ImGui::HelpMarker("Enables colored lighting. Currently is not saved to the level.");
 
+                ImGui::Checkbox("Cache Results", &settings.UseCache);
+                ImGui::HelpMarker("Reuses saved lighting when the level geometry, light sources and settings are unchanged");
+                ImGui::SameLine();
+                if (ImGui::Button("Clear Cache"))
+                    LightCache::Clear();
+
                 /*ImGui::Checkbox("Check Coplanar", &_settings.CheckCoplanar);
                 ImGui::HelpMarker("Causes co-planar light sources to have a consistent brightness");*/
             }
 
 
-            if (ImGui::Button("Light Level")) {
-                Commands::LightLevel(Game::Level, settings);
-                Events::LevelChanged();
+            if (LightJobRunning()) {
+                auto progress = GetLightJobProgress();
+                auto label = progress.Pass == 0 ? fmt::format("Direct {} / {}", progress.Source, progress.Sources)
+                    : fmt::format("Bounce {} - {} / {}", progress.Pass, progress.Source, progress.Sources);
+                ImGui::ProgressBar(progress.Fraction(), { 200, 0 }, label.c_str());
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel"))
+                    CancelLightJob();
+            }
+            else {
+                if (ImGui::Button("Light Level"))
+                    StartLightJob(Game::Level, settings, _preview);
+
+                ImGui::SameLine();
+                ImGui::Checkbox("Preview", &_preview);
+                ImGui::HelpMarker("Shows direct lighting in the viewport before the bounces finish");
             }
 
             ImGui::Text("Time: %.3f s", Metrics::LightCalculationTime / 1000000.0f);
             ImGui::Text("Ray Casts: %d", Metrics::RaysCast);
             ImGui::Text("Ray Hits: %d", Metrics::RayHits);
             ImGui::Text("Cache hits: %d", Metrics::CacheHits);
+            ImGui::Text("Segments visited: %d", Metrics::SegmentsTested);
+            ImGui::Text("Light buffers: %.1f MB", GetLightingReport().LightBufferBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Light probes: %d in %.2f s", GetLightingReport().Probes, GetLightingReport().ProbeTime / 1000000.0f);
+            ImGui::Text("Visibility update: %.3f s", GetLightingReport().VisibilityTime / 1000000.0f);
+            DrawPassEnergy();
+
+            DrawSlowestSources();
 
             ToggleLight();
 #ifdef _DEBUG
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include <bit>
+#include "Game.AI.h"
+#include "ScopedTimer.h"
+
+namespace Inferno {
+    namespace {
+        // Path distance to the player for each doubling of the update interval
+        constexpr Array<float, 4> IntervalDistances = { 80, 160, 320, 640 };
+
+        bool IsRobot(const Object& obj) {
+            return obj.Type == ObjectType::Robot && obj.Control.Type == ControlType::AI && Object::IsAlive(obj);
+        }
+
+        bool IsAware(const AIRuntime& ail) {
+            return ail.Awareness != RobotAwareness::None || ail.AwarenessTime > 0;
+        }
+    }
+
+    uint8 AIScheduler::GetInterval(const Object& robot, const DistanceField* field) {
+        if (IsAware(robot.Control.AI.ail)) return 1;
+        if (!field || (size_t)robot.Segment >= field->Distance.size()) return MaxInterval;
+
+        auto distance = field->Distance[(int)robot.Segment];
+        for (int i = 0; i < IntervalDistances.size(); i++) {
+            if (distance < IntervalDistances[i])
+                return uint8(1 << i);
+        }
+
+        return MaxInterval; // Far away or unreachable
+    }
+
+    void AIScheduler::Update(Level& level, uint32 tick, float dt, const std::function<void(Object&, float)>& updateRobot) {
+        _stats.Robots = _stats.Updates = _stats.Deferred = 0;
+        _stats.Intervals = {};
+        int64 time = 0;
+
+        {
+            ScopedTimer timer(&time);
+            _entries.resize(level.Objects.size());
+
+            const DistanceField* field = nullptr;
+            if (!level.Objects.empty() && level.Objects[0].Type == ObjectType::Player && level.SegmentExists(level.Objects[0].Segment))
+                field = &Game::Navigation.GetDistanceField(level, level.Objects[0].Segment, { .OpenDoors = true });
+
+            auto count = level.Objects.size();
+            Option<size_t> firstDeferred;
+
+            for (size_t n = 0; n < count; n++) {
+                auto id = (_cursor + n) % count;
+                auto& obj = level.Objects[id];
+                auto& entry = _entries[id];
+
+                if (!IsRobot(obj)) {
+                    entry = {};
+                    continue;
+                }
+
+                auto& ail = obj.Control.AI.ail;
+                ail.LastUpdate += dt;
+                _stats.Robots++;
+
+                if (entry.Interval == 0) {
+                    // Spread new robots across their interval
+                    entry.Interval = GetInterval(obj, field);
+                    entry.NextTick = tick + uint32(id % entry.Interval);
+                }
+                else if (entry.Interval > 1 && IsAware(ail)) {
+                    entry.NextTick = tick; // Noticed the player, respond now
+                }
+
+                _stats.Intervals[std::countr_zero(entry.Interval)]++;
+
+                if (int32(entry.NextTick - tick) > 0) continue; // Not due
+
+                if (_stats.Updates >= MaxUpdatesPerTick) {
+                    if (!firstDeferred) firstDeferred = id;
+                    _stats.Deferred++;
+                    continue;
+                }
+
+                updateRobot(obj, ail.LastUpdate);
+                ail.LastUpdate = 0;
+                _stats.Updates++;
+
+                entry.Interval = GetInterval(obj, field);
+                entry.NextTick = tick + entry.Interval;
+            }
+
+            if (firstDeferred) _cursor = *firstDeferred;
+        }
+
+        _stats.Time = time;
+        _stats.MaxTime = std::max(_stats.MaxTime, time);
+        _stats.MaxUpdates = std::max(_stats.MaxUpdates, _stats.Updates);
+    }
+
+    void AIScheduler::Clear() {
+        _entries.clear();
+        _cursor = 0;
+        _stats = {};
+    }
+
+    void UpdateAI(Level& level, uint32 tick, float dt) {
+        // Robots don't act yet, so only their timers advance
+        Game::AI.Update(level, tick, dt, [](Object& robot, float elapsed) {
+            auto& ail = robot.Control.AI.ail;
+            ail.FireDelay = std::max(ail.FireDelay - elapsed, 0.0f);
+            ail.FireDelay2 = std::max(ail.FireDelay2 - elapsed, 0.0f);
+            ail.LastSeenPlayer += elapsed;
+            ail.LastSeenAttackingPlayer += elapsed;
+            ail.MiscSoundTime += elapsed;
+
+            if (ail.AwarenessTime > 0) {
+                ail.AwarenessTime -= elapsed;
+                if (ail.AwarenessTime <= 0) {
+                    ail.AwarenessTime = 0;
+                    ail.Awareness = RobotAwareness::None;
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Level.h"
+#include "Game.Navigation.h"
+
+namespace Inferno {
+    // Runs robot AI less often the further a robot is from the player.
+    // Robots that are aware of the player update every tick. Others slow down by their path distance to the player.
+    // Each robot starts at an offset within its interval so robots sharing an interval update on different ticks.
+    class AIScheduler {
+        struct Entry {
+            uint32 NextTick = 0;
+            uint8 Interval = 0; // Ticks between updates. 0 until the robot is first scheduled.
+        };
+
+        List<Entry> _entries; // Per object
+        size_t _cursor = 0; // Object to start from, so robots deferred by the budget go first next tick
+
+    public:
+        static constexpr int MaxInterval = 16;
+        static constexpr int MaxUpdatesPerTick = 64; // Due robots beyond this wait for the next tick
+
+        struct Stats {
+            int Robots = 0;
+            int Updates = 0; // Robots updated during the last tick
+            int Deferred = 0; // Due robots pushed to the next tick by the budget
+            int MaxUpdates = 0; // Most updates in a tick since the stats were reset
+            Array<int, 5> Intervals{}; // Robots updating every 1, 2, 4, 8 and 16 ticks
+            int64 Time = 0; // Microseconds spent on AI during the last tick
+            int64 MaxTime = 0;
+        };
+
+        // Updates robots that are due this tick. The callback receives the time since the robot's last update.
+        void Update(Level& level, uint32 tick, float dt, const std::function<void(Object&, float)>& updateRobot);
+
+        void Clear();
+        void ResetStats() { _stats = {}; }
+
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        Stats _stats;
+
+        // Distance field is towards the player, null if there is no player
+        static uint8 GetInterval(const Object& robot, const DistanceField* field);
+    };
+
+    // Updates the AI state of every robot that is due this tick
+    void UpdateAI(Level& level, uint32 tick, float dt);
+
+    namespace Game {
+        // AI update rates for the loaded level
+        inline AIScheduler AI;
+    }
+}
@@ -0,0 +1,303 @@
+#include "pch.h"
+#include <numeric>
+#include <crtdbg.h>
+#include "Game.Benchmark.h"
+#include "DataPool.h"
+#include "Utility.h"
+#include "ScopedTimer.h"
+#include "Game.h"
+#include "Game.AI.h"
+#include "Game.Navigation.h"
+#include "Game.Segment.h"
+#include "Game.Simulation.h"
+#include "Graphics/Render.h"
+#include "Graphics/Render.Particles.h"
+#include "Resources.h"
+
+namespace Inferno {
+#ifdef _DEBUG
+    namespace {
+        thread_local int64 ThreadAllocations = 0;
+        thread_local int ThreadScopes = 0; // Only threads inside a scope count their allocations
+
+        std::mutex HookLock;
+        int HookUsers = 0;
+        _CRT_ALLOC_HOOK PreviousHook = nullptr;
+
+        // Counts allocations made through the CRT debug heap
+        int CountAllocations(int type, void* data, size_t size, int blockType, long request, const unsigned char* file, int line) {
+            if (ThreadScopes > 0 && (type == _HOOK_ALLOC || type == _HOOK_REALLOC))
+                ThreadAllocations++;
+
+            return PreviousHook ? PreviousHook(type, data, size, blockType, request, file, line) : TRUE;
+        }
+    }
+#endif
+
+    AllocationScope::AllocationScope() {
+#ifdef _DEBUG
+        {
+            std::scoped_lock lock(HookLock);
+            if (HookUsers++ == 0)
+                PreviousHook = _CrtSetAllocHook(CountAllocations);
+        }
+
+        ThreadScopes++;
+        _start = ThreadAllocations;
+#endif
+    }
+
+    AllocationScope::~AllocationScope() {
+#ifdef _DEBUG
+        ThreadScopes--;
+
+        std::scoped_lock lock(HookLock);
+        if (--HookUsers == 0)
+            _CrtSetAllocHook(PreviousHook);
+#endif
+    }
+
+    Option<int64> AllocationScope::Count() const {
+#ifdef _DEBUG
+        return ThreadAllocations - _start;
+#else
+        return {};
+#endif
+    }
+
+    namespace {
+        constexpr int BenchmarkWeapon = 13; // Plasma
+        constexpr int MaxLifetime = 8; // Rounds an element can live
+
+        struct BenchmarkElement {
+            Vector3 Position, Velocity;
+            int Life = 0;
+
+            static bool IsAlive(const BenchmarkElement& e) { return e.Life > 0; }
+        };
+
+        void UpdateElement(BenchmarkElement& e) {
+            e.Position += e.Velocity;
+            e.Life--;
+        }
+    }
+
+    DataPoolBenchmark RunDataPoolBenchmark(int elements, int rounds) {
+        DataPoolBenchmark result{ .Elements = elements, .Rounds = rounds };
+
+        // Lifetimes average half the maximum, so adding this many each round keeps the pool near the element count
+        auto addsPerRound = std::max(elements * 2 / MaxLifetime, 1);
+        List<BenchmarkElement> added(addsPerRound * rounds);
+        for (auto& e : added) {
+            e.Velocity = Vector3(Random(), Random(), Random());
+            e.Life = 1 + int(Random() * (MaxLifetime - 1));
+        }
+
+        int poolLive = 0, scanLive = 0;
+
+        {
+            DataPool<BenchmarkElement> pool(BenchmarkElement::IsAlive, 100);
+            ScopedTimer timer(&result.PoolTime);
+
+            for (int round = 0; round < rounds; round++) {
+                for (int i = 0; i < addsPerRound; i++)
+                    pool.Add(added[round * addsPerRound + i]);
+
+                for (auto& e : pool)
+                    UpdateElement(e);
+
+                pool.Prune();
+            }
+
+            poolLive = (int)pool.Size();
+            pool.Compact();
+            result.Slots = pool.SlotCount();
+        }
+
+        {
+            // Reuses the first dead element when adding and checks every element when updating
+            List<BenchmarkElement> list;
+            list.reserve(100);
+            ScopedTimer timer(&result.ScanTime);
+
+            for (int round = 0; round < rounds; round++) {
+                for (int i = 0; i < addsPerRound; i++) {
+                    auto& e = added[round * addsPerRound + i];
+                    auto dead = std::ranges::find_if(list, [](auto& x) { return !BenchmarkElement::IsAlive(x); });
+                    if (dead != list.end()) *dead = e;
+                    else list.push_back(e);
+                }
+
+                for (auto& e : list) {
+                    if (BenchmarkElement::IsAlive(e)) UpdateElement(e);
+                }
+            }
+
+            scanLive = (int)std::ranges::count_if(list, BenchmarkElement::IsAlive);
+        }
+
+        if (poolLive != scanLive)
+            SPDLOG_WARN("DataPool benchmark ended with {} live elements but the list has {}", poolLive, scanLive);
+
+        return result;
+    }
+
+    namespace {
+        // Copies a robot from the level so it matches the game data, otherwise makes one from the first robot type
+        Object CreateBenchmarkRobot(const Level& level) {
+            for (auto& obj : level.Objects) {
+                if (obj.Type == ObjectType::Robot && Object::IsAlive(obj))
+                    return obj;
+            }
+
+            auto& info = Resources::GetRobotInfo(0);
+            Object robot{};
+            robot.Type = ObjectType::Robot;
+            robot.ID = 0;
+            robot.Control.Type = ControlType::AI;
+            robot.Control.AI.Behavior = AIBehavior::Normal;
+            robot.Movement.Type = MovementType::Physics;
+            robot.Movement.Physics.Mass = info.Mass;
+            robot.Movement.Physics.Drag = info.Drag;
+            robot.Render.Type = RenderType::Model;
+            robot.Render.Model.ID = info.Model;
+            robot.Shields = info.HitPoints;
+            robot.Radius = Resources::GetModel(info.Model).Radius;
+            return robot;
+        }
+
+        SegID RandomSegment(const Level& level) {
+            return SegID(Random() * (level.Segments.size() - 1));
+        }
+
+        // Times a subsystem for one tick and adds the allocations it made on this thread
+        void Measure(SubsystemTimes& subsystem, auto&& fn) {
+            AllocationScope allocations;
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            subsystem.Times.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+
+            if (auto count = allocations.Count())
+                subsystem.Allocations = subsystem.Allocations.value_or(0) + *count;
+        }
+    }
+
+    double SubsystemTimes::Percentile(double percent) const {
+        if (Times.empty()) return 0;
+        auto sorted = Times;
+        ranges::sort(sorted);
+        auto rank = (size_t)std::ceil(percent / 100 * sorted.size());
+        return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+    }
+
+    double SubsystemTimes::Mean() const {
+        if (Times.empty()) return 0;
+        return std::accumulate(Times.begin(), Times.end(), 0.0) / Times.size();
+    }
+
+    const SubsystemTimes* SimulationBenchmark::GetSubsystem(string_view name) const {
+        for (auto& subsystem : Subsystems) {
+            if (subsystem.Name == name) return &subsystem;
+        }
+
+        return nullptr;
+    }
+
+    SimulationBenchmark RunSimulationBenchmark(const Level& source, const SimulationBenchmarkOptions& options) {
+        SimulationBenchmark result{ .Options = options };
+        if (source.Objects.empty() || source.Segments.empty()) return result;
+
+        auto level = source;
+        level.RebuildObjectLists();
+        HeadlessSimulationScope scope(level); // The live game keeps its own navigation, AI and collision state
+
+        // Spawn positions, projectile directions and robot decisions all use Random(),
+        // so a fixed seed makes runs comparable. Reseeded from the clock afterwards like startup does.
+        std::srand(options.Seed);
+        FlickeringLightSchedule flicker;
+        List<Tag> changedLightSides;
+
+        auto robot = CreateBenchmarkRobot(level);
+        for (int i = 0; i < options.Robots; i++) {
+            auto seg = RandomSegment(level);
+            robot.Segment = seg;
+            robot.Position = robot.LastPosition = level.GetSegment(seg).Center;
+            SpawnObject(level, robot);
+        }
+
+        if (options.Weapons > 0)
+            SpawnTestProjectiles(level, ObjID(0), options.Weapons, BenchmarkWeapon);
+
+        constexpr float dt = FixedStepSimulation::TickTime;
+        Render::ParticleSystem particles;
+
+        for (int i = 0; i < options.Particles; i++) {
+            auto& seg = level.GetSegment(RandomSegment(level));
+            Render::Particle p{};
+            p.Clip = Resources::GameData.Weapons[BenchmarkWeapon].WallHitVClip;
+            p.Position = seg.Center + Vector3(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f) * 10;
+            p.Radius = 2.5f;
+            p.Life = options.Ticks * dt + 1;
+            particles.Add(p);
+        }
+
+        enum { Physics, PhysicsMove, PhysicsApply, PhysicsQueries, AI, FlickeringLights, Particles, Count };
+        result.Subsystems.resize(Count);
+        result.Subsystems[Physics].Name = "physics";
+        result.Subsystems[PhysicsMove].Name = "physics.move";
+        result.Subsystems[PhysicsApply].Name = "physics.apply";
+        result.Subsystems[PhysicsQueries].Name = "physics.queries"; // Summed across threads
+        result.Subsystems[AI].Name = "ai";
+        result.Subsystems[FlickeringLights].Name = "flickering_lights";
+        result.Subsystems[Particles].Name = "particles";
+
+        for (auto& subsystem : result.Subsystems)
+            subsystem.Times.reserve(options.Ticks);
+
+        {
+            ScopedTimer timer(&result.TotalTime);
+            double t = 0;
+
+            for (int tick = 0; tick < options.Ticks; tick++) {
+                // Includes object lifetimes and doors
+                Measure(result.Subsystems[Physics], [&] { UpdatePhysics(level, t, dt, {}); });
+                result.Subsystems[PhysicsMove].Times.push_back((double)Debug::MoveTime);
+                result.Subsystems[PhysicsApply].Times.push_back((double)Debug::ApplyTime);
+                result.Subsystems[PhysicsQueries].Times.push_back((double)Debug::QueryTime.load());
+                result.Queries += Debug::Queries;
+
+                Measure(result.Subsystems[AI], [&] { UpdateAI(level, tick, dt); });
+
+                Measure(result.Subsystems[FlickeringLights], [&] {
+                    flicker.Update(level, t, changedLightSides);
+                    changedLightSides.clear(); // Nothing draws the copy
+                });
+
+                Measure(result.Subsystems[Particles], [&] {
+                    auto& player = level.Objects[0];
+                    particles.Update(dt);
+                    particles.BuildBatches(player.Position, player.Rotation.Up());
+                });
+
+                t += dt;
+            }
+        }
+
+        result.Objects = (int)ranges::count_if(level.Objects, &Object::IsAlive);
+        std::srand((uint)std::time(nullptr));
+        return result;
+    }
+
+    void WriteSimulationBenchmarkCsv(const SimulationBenchmark& result, std::ostream& stream) {
+        stream << "subsystem,ticks,mean_us,p50_us,p95_us,p99_us,max_us,allocations\n";
+
+        for (auto& subsystem : result.Subsystems) {
+            auto allocations = subsystem.Allocations ? std::to_string(*subsystem.Allocations) : "";
+            stream << fmt::format("{},{},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{}\n",
+                                  subsystem.Name, subsystem.Times.size(), subsystem.Mean(),
+                                  subsystem.Percentile(50), subsystem.Percentile(95), subsystem.Percentile(99),
+                                  subsystem.Percentile(100), allocations);
+        }
+    }
+}
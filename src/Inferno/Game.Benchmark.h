@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Types.h"
+#include "Level.h"
+
+namespace Inferno {
+    // Counts heap allocations made on the calling thread while in scope. Scopes can nest.
+    // Uses the CRT debug heap hook, so counts are only available in debug builds.
+    class AllocationScope {
+        int64 _start = 0;
+
+    public:
+        AllocationScope();
+        ~AllocationScope();
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+        // Allocations since the scope started. Empty in release builds.
+        Option<int64> Count() const;
+    };
+
+    struct DataPoolBenchmark {
+        int Elements = 0; // Live elements once the pool is full
+        int Rounds = 0;
+        int64 PoolTime = 0; // Microseconds to add, update and prune elements in a DataPool
+        int64 ScanTime = 0; // Microseconds for the same work in a list that scans for dead elements
+        size_t Slots = 0; // Pool slots after compacting
+    };
+
+    // Churns short lived elements through a DataPool each round, like particles and doors,
+    // and compares it to reusing dead elements by scanning a list.
+    DataPoolBenchmark RunDataPoolBenchmark(int elements, int rounds);
+
+    struct SimulationBenchmarkOptions {
+        int Ticks = 1000;
+        int Robots = 0; // Spawned at random segment centers
+        int Weapons = 0; // Projectiles fired from the player on the first tick
+        int Particles = 0; // Kept alive for the whole run
+        uint Seed = 1; // Seeds Random() so runs with the same options simulate the same scene
+    };
+
+    struct SubsystemTimes {
+        string Name;
+        List<double> Times; // Microseconds for each tick
+        Option<int64> Allocations; // Total for the run on the benchmark thread. Empty in release builds and for the physics phases.
+
+        // Nearest rank percentile in microseconds
+        double Percentile(double percent) const;
+        double Mean() const;
+    };
+
+    struct SimulationBenchmark {
+        SimulationBenchmarkOptions Options;
+        List<SubsystemTimes> Subsystems;
+        int Objects = 0; // Live objects after the last tick
+        int64 Queries = 0; // Sphere and capsule level queries over the run
+        int64 TotalTime = 0; // Microseconds
+
+        const SubsystemTimes* GetSubsystem(string_view name) const;
+    };
+
+    // Runs fixed ticks on a copy of the level without rendering or sound and times each game subsystem.
+    // Physics is also broken down into its phases and level query time, which don't have allocation counts.
+    SimulationBenchmark RunSimulationBenchmark(const Level& level, const SimulationBenchmarkOptions& options);
+
+    // Writes one row per subsystem with the tick time percentiles and allocations
+    void WriteSimulationBenchmarkCsv(const SimulationBenchmark& result, std::ostream& stream);
+}
@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "Game.Broadphase.h"
+#include "ScopedTimer.h"
+
+namespace Inferno {
+    namespace {
+        bool Overlaps(const Vector3& minA, const Vector3& maxA, const Vector3& minB, const Vector3& maxB) {
+            return minA.y <= maxB.y && minB.y <= maxA.y &&
+                minA.z <= maxB.z && minB.z <= maxA.z;
+        }
+
+        bool IsMoving(const Object& obj) {
+            return obj.Movement.Type == MovementType::Physics;
+        }
+    }
+
+    void ObjectBroadphase::Update(span<const Object> objects, float dt) {
+        _stats = {};
+        ScopedTimer timer(&_stats.BuildTime);
+
+        _min.resize(objects.size());
+        _max.resize(objects.size());
+
+        // Drop entries for objects that died or no longer exist, keeping the order of the rest
+        std::erase_if(_entries, [&objects](const Entry& e) {
+            return (size_t)e.Object >= objects.size() || !Object::IsAlive(objects[e.Object]);
+        });
+
+        List<bool> present(objects.size());
+        for (auto& entry : _entries)
+            present[entry.Object] = true;
+
+        _included.assign(objects.size(), false);
+
+        for (int i = 0; i < objects.size(); i++) {
+            auto& obj = objects[i];
+            if (!Object::IsAlive(obj)) continue;
+            _included[i] = true;
+
+            auto extent = obj.Radius;
+            if (IsMoving(obj))
+                extent += obj.Movement.Physics.Velocity.Length() * dt;
+
+            _min[i] = obj.Position - Vector3(extent);
+            _max[i] = obj.Position + Vector3(extent);
+
+            if (!present[i])
+                _entries.push_back({ .Object = i });
+        }
+
+        for (auto& entry : _entries) {
+            entry.MinX = _min[entry.Object].x;
+            entry.MaxX = _max[entry.Object].x;
+        }
+
+        // Objects move a little each tick, so the previous order is nearly sorted and insertion sort is close to linear
+        for (size_t i = 1; i < _entries.size(); i++) {
+            auto entry = _entries[i];
+            auto j = i;
+            for (; j > 0 && _entries[j - 1].MinX > entry.MinX; j--)
+                _entries[j] = _entries[j - 1];
+
+            _entries[j] = entry;
+        }
+
+        _pairs.clear();
+
+        for (size_t i = 0; i < _entries.size(); i++) {
+            auto a = _entries[i].Object;
+            auto& objA = objects[a];
+
+            for (size_t j = i + 1; j < _entries.size() && _entries[j].MinX <= _entries[i].MaxX; j++) {
+                auto b = _entries[j].Object;
+                auto& objB = objects[b];
+                _stats.Overlaps++;
+
+                if (!IsMoving(objA) && !IsMoving(objB)) continue; // only moving objects run queries
+                if (!Overlaps(_min[a], _max[a], _min[b], _max[b])) continue;
+                if (!CanCollide(ObjID(a), objA, ObjID(b), objB)) continue;
+
+                _pairs.push_back({ a, b });
+            }
+        }
+
+        // Store the candidates of each object contiguously
+        _offsets.assign(objects.size() + 1, 0);
+        for (auto& [a, b] : _pairs) {
+            _offsets[a + 1]++;
+            _offsets[b + 1]++;
+        }
+
+        for (size_t i = 1; i < _offsets.size(); i++)
+            _offsets[i] += _offsets[i - 1];
+
+        _candidates.resize(_pairs.size() * 2);
+        List<int> fill(_offsets.begin(), _offsets.end() - 1);
+        for (auto& [a, b] : _pairs) {
+            _candidates[fill[a]++] = ObjID(b);
+            _candidates[fill[b]++] = ObjID(a);
+        }
+
+        _stats.Objects = (int)_entries.size();
+        _stats.Pairs = (int)_pairs.size();
+    }
+
+    void ObjectBroadphase::Clear() {
+        _entries.clear();
+        _included.clear();
+        _min.clear();
+        _max.clear();
+        _offsets.clear();
+        _candidates.clear();
+        _pairs.clear();
+        _stats = {};
+    }
+
+    BroadphaseBenchmark RunBroadphaseBenchmark(const Level& level, int count) {
+        BroadphaseBenchmark result{ .Objects = count };
+        if (level.Segments.empty()) return result;
+
+        constexpr float dt = 1 / 64.0f;
+
+        // Half the objects are fired by the player to exercise the ownership rules
+        List<Object> objects(count);
+        for (int i = 0; i < count; i++) {
+            auto& obj = objects[i];
+            auto& seg = level.Segments[(size_t)(Random() * (level.Segments.size() - 1))];
+            obj.Position = seg.Center + Vector3(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f) * 10;
+            obj.Radius = 1 + Random() * 4;
+            obj.Lifespan = 1;
+            obj.Parent = i % 2 == 0 ? ObjID(0) : ObjID::None;
+            obj.Movement.Type = MovementType::Physics;
+            obj.Movement.Physics.Velocity = Vector3(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f) * 200;
+        }
+
+        auto contact = [&objects](int a, int b) {
+            auto& objA = objects[a];
+            auto& objB = objects[b];
+            auto dist = objA.Radius + objB.Radius;
+            return Vector3::DistanceSquared(objA.Position, objB.Position) <= dist * dist;
+        };
+
+        int bruteContacts = 0;
+
+        {
+            ScopedTimer timer(&result.BruteForceTime);
+            for (int a = 0; a < count; a++) {
+                for (int b = a + 1; b < count; b++) {
+                    if (!CanCollide(ObjID(a), objects[a], ObjID(b), objects[b])) continue;
+                    if (contact(a, b)) bruteContacts++;
+                }
+            }
+        }
+
+        ObjectBroadphase broadphase;
+
+        {
+            ScopedTimer timer(&result.BroadphaseTime);
+            broadphase.Update(objects, dt);
+
+            for (int a = 0; a < count; a++) {
+                for (auto b : broadphase.GetCandidates(ObjID(a))) {
+                    if ((int)b > a && contact(a, (int)b)) result.Contacts++;
+                }
+            }
+        }
+
+        result.Stats = broadphase.GetStats();
+
+        if (bruteContacts != result.Contacts)
+            SPDLOG_WARN("Broadphase found {} contacts but testing every pair found {}", result.Contacts, bruteContacts);
+
+        return result;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Level.h"
+
+namespace Inferno {
+    // Ownership rules for object collisions. Objects don't collide with themselves, their parent, their children or their siblings.
+    inline bool CanCollide(ObjID aId, const Object& a, ObjID bId, const Object& b) {
+        if (aId == bId) return false;
+        if (a.Parent == bId || b.Parent == aId) return false;
+        if (a.Parent == b.Parent) return false;
+        return true;
+    }
+
+    // Finds pairs of objects that might collide during a tick using sort and sweep along the x axis.
+    // Bounds cover every position an object can reach in the tick, so sliding along walls stays inside them.
+    // Ownership rules are applied while building, so narrowphase only sees pairs that can collide.
+    class ObjectBroadphase {
+        struct Entry {
+            float MinX, MaxX;
+            int Object;
+        };
+
+        List<Entry> _entries; // Sorted by MinX. Kept between ticks so sorting is close to linear.
+        List<Vector3> _min, _max; // Bounds per object
+        List<bool> _included; // Objects that were alive during the last update
+        List<int> _offsets; // Start of each object's candidates, one extra entry at the end
+        List<ObjID> _candidates;
+        List<std::pair<int, int>> _pairs;
+
+    public:
+        struct Stats {
+            int Objects = 0; // Objects with bounds
+            int Overlaps = 0; // Bounds that overlap on the x axis
+            int Pairs = 0; // Pairs that passed the bounds and ownership tests
+            int64 BuildTime = 0; // Microseconds
+        };
+
+        // Rebuilds candidates for the live objects. Moving objects are expanded by the distance they can travel in dt.
+        void Update(span<const Object> objects, float dt);
+
+        void Clear();
+
+        // Returns true if candidates were built for the object
+        bool Contains(ObjID id) const { return id >= ObjID(0) && (size_t)id < _included.size() && _included[(int)id]; }
+
+        // Objects that might collide with the object. Empty if it wasn't included in the last update.
+        span<const ObjID> GetCandidates(ObjID id) const {
+            if (!Contains(id)) return {};
+            auto begin = _offsets[(int)id], end = _offsets[(int)id + 1];
+            return { _candidates.data() + begin, (size_t)(end - begin) };
+        }
+
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        Stats _stats;
+    };
+
+    struct BroadphaseBenchmark {
+        int Objects = 0;
+        int Contacts = 0; // Overlapping pairs found by both methods
+        int64 BruteForceTime = 0; // Microseconds to test every pair
+        int64 BroadphaseTime = 0; // Microseconds to build candidates and test them
+        ObjectBroadphase::Stats Stats;
+    };
+
+    // Scatters moving objects through the level and compares the broadphase against testing every pair
+    BroadphaseBenchmark RunBroadphaseBenchmark(const Level& level, int objects);
+
+    namespace Game {
+        // Object collision candidates for the current physics tick
+        inline ObjectBroadphase Broadphase;
+    }
+}
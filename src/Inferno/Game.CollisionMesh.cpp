@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "Game.CollisionMesh.h"
+#include "ScopedTimer.h"
+#include "Utility.h"
+
+namespace Inferno {
+    namespace {
+        // Hashes the segment state that affects collision: vertices, connections, side splits and walls.
+        // Textures are left out so door animations don't rebuild anything.
+        uint64 GetCollisionSignature(const Level& level, const Segment& seg) {
+            uint64 hash = 0;
+
+            for (auto& index : seg.Indices) {
+                auto& v = level.Vertices[index];
+                HashCombine(hash, v.x);
+                HashCombine(hash, v.y);
+                HashCombine(hash, v.z);
+            }
+
+            for (auto& sideId : SideIDs) {
+                HashCombine(hash, (uint64)seg.GetConnection(sideId));
+                HashCombine(hash, (uint64)seg.GetSide(sideId).Type);
+                HashCombine(hash, (uint64)seg.GetSide(sideId).Wall);
+            }
+
+            return hash;
+        }
+
+        void BuildTriangle(SegmentCollision& mesh, int tri, const Vector3& p0, const Vector3& p1, const Vector3& p2) {
+            mesh.P0[tri] = p0;
+            mesh.P1[tri] = p1;
+            mesh.P2[tri] = p2;
+
+            // Matches the winding used for side normals
+            auto normal = (p1 - p0).Cross(p2 - p1);
+            normal.Normalize();
+            mesh.Valid[tri] = IsNormalized(normal);
+            if (!mesh.Valid[tri]) normal = Vector3::UnitY;
+
+            mesh.Normal[tri] = normal;
+            mesh.PlaneDist[tri] = normal.Dot(p0);
+
+            auto edgeNormal = [&normal](const Vector3& a, const Vector3& b) {
+                auto n = normal.Cross(b - a);
+                n.Normalize();
+                return n;
+            };
+
+            mesh.Edge0[tri] = edgeNormal(p0, p1);
+            mesh.Edge1[tri] = edgeNormal(p1, p2);
+            mesh.Edge2[tri] = edgeNormal(p2, p0);
+        }
+
+        void BuildSegment(Level& level, const Segment& seg, SegmentCollision& mesh) {
+            for (auto& sideId : SideIDs) {
+                auto& side = seg.GetSide(sideId);
+                auto indices = seg.GetVertexIndices(sideId);
+                auto ri = side.GetRenderIndices();
+                auto point = [&](int i) { return level.Vertices[indices[ri[i]]]; };
+
+                auto tri = (int)sideId * 2;
+                BuildTriangle(mesh, tri, point(0), point(1), point(2));
+                BuildTriangle(mesh, tri + 1, point(3), point(4), point(5));
+
+                mesh.SideNormal[(int)sideId] = side.AverageNormal;
+                mesh.Portal[(int)sideId] = seg.GetConnection(sideId);
+                mesh.Solid[(int)sideId] = seg.SideIsSolid(sideId, level);
+            }
+        }
+    }
+
+    void LevelCollisionMesh::Build(Level& level) {
+        _stats = {};
+        ScopedTimer timer(&_stats.BuildTime);
+
+        _instance = level.Instance.Value();
+        _segments.resize(level.Segments.size());
+        _signatures.resize(level.Segments.size());
+
+        for (size_t i = 0; i < level.Segments.size(); i++) {
+            auto& seg = level.Segments[i];
+            _signatures[i] = GetCollisionSignature(level, seg);
+            BuildSegment(level, seg, _segments[i]);
+        }
+
+        _stats.SegmentsBuilt = (int)_segments.size();
+        UpdateStats();
+    }
+
+    void LevelCollisionMesh::Update(Level& level) {
+        if (!Matches(level)) {
+            Build(level);
+            return;
+        }
+
+        int64 elapsed = 0;
+
+        {
+            ScopedTimer timer(&elapsed);
+            _stats.SegmentsBuilt = 0;
+
+            for (size_t i = 0; i < _segments.size(); i++) {
+                auto& seg = level.Segments[i];
+                auto signature = GetCollisionSignature(level, seg);
+                if (signature == _signatures[i]) continue;
+
+                _signatures[i] = signature;
+                BuildSegment(level, seg, _segments[i]);
+                _stats.SegmentsBuilt++;
+            }
+
+            // Doors open and walls are destroyed or retyped without changing the signature
+            UpdateWalls(level);
+        }
+
+        _stats.BuildTime = elapsed;
+    }
+
+    void LevelCollisionMesh::UpdateWalls(Level& level) {
+        if (!Matches(level)) return;
+
+        for (auto& wall : level.Walls) {
+            if (!SegmentExists(wall.Tag.Segment)) continue;
+            auto& seg = level.GetSegment(wall.Tag.Segment);
+            _segments[(int)wall.Tag.Segment].Solid[(int)wall.Tag.Side] = seg.SideIsSolid(wall.Tag.Side, level);
+        }
+    }
+
+    void LevelCollisionMesh::Clear() {
+        _segments.clear();
+        _signatures.clear();
+        _instance = 0;
+        _stats = {};
+    }
+
+    PortalSearch::PortalSearch(const LevelCollisionMesh& mesh, SegID start) {
+        thread_local List<uint32> stamps;
+        thread_local uint32 generation = 0;
+
+        // Reset on level change or when the generation wraps around
+        if (stamps.size() != mesh.Size() || generation == UINT32_MAX) {
+            stamps.assign(mesh.Size(), 0);
+            generation = 0;
+        }
+
+        _generation = ++generation;
+        _stamps = stamps;
+        Push(start);
+    }
+
+    bool PortalSearch::Push(SegID id) {
+        if (id < SegID(0) || (size_t)id >= _stamps.size()) return false;
+        auto& stamp = _stamps[(int)id];
+        if (stamp == _generation) return false;
+
+        stamp = _generation;
+
+        if (_count == Capacity) {
+            Debug::PortalSearchOverflows++;
+            _overflow.push_back(id);
+        }
+        else {
+            _stack[_count++] = id;
+        }
+
+        return true;
+    }
+
+    void LevelCollisionMesh::UpdateStats() {
+        _stats.Segments = (int)_segments.size();
+        _stats.Bytes = _segments.size() * sizeof(SegmentCollision) + _signatures.size() * sizeof(uint64);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Level.h"
+
+namespace Inferno {
+    // Collision geometry for one segment. Each side is split into two triangles using its render indices,
+    // stored in side order so triangle i belongs to side i / 2. Fields are kept as parallel arrays so queries
+    // can reject triangles by plane distance before touching the vertices.
+    struct SegmentCollision {
+        static constexpr int Triangles = 12;
+
+        Array<Vector3, Triangles> P0, P1, P2;
+        Array<Vector3, Triangles> Normal; // Triangle plane normal, points into the segment
+        Array<float, Triangles> PlaneDist; // Plane offset, Normal.Dot(p) - PlaneDist is the signed distance
+        Array<Vector3, Triangles> Edge0, Edge1, Edge2; // In-plane edge normals pointing into the triangle
+        Array<bool, Triangles> Valid; // False for degenerate triangles
+
+        Array<Vector3, 6> SideNormal; // Average normal of each side
+        Array<bool, 6> Solid; // Objects collide with the side
+        Array<SegID, 6> Portal; // Connected segment, or None
+
+        float DistanceFromPlane(int tri, const Vector3& point) const {
+            return Normal[tri].Dot(point) - PlaneDist[tri];
+        }
+
+        // Returns true if a point on the triangle plane is inside all three edges
+        bool Contains(int tri, const Vector3& point) const {
+            return Edge0[tri].Dot(point - P0[tri]) >= 0 &&
+                Edge1[tri].Dot(point - P1[tri]) >= 0 &&
+                Edge2[tri].Dot(point - P2[tri]) >= 0;
+        }
+
+        static SideID GetSide(int tri) { return SideID(tri / 2); }
+    };
+
+    // Per-segment collision triangles for the loaded level.
+    // Geometry is rebuilt for segments whose vertices, connections, split type or walls changed,
+    // while wall solidity is refreshed separately as doors open and walls are destroyed.
+    class LevelCollisionMesh {
+        List<SegmentCollision> _segments;
+        List<uint64> _signatures; // Per segment hash of the state that affects collision geometry
+        uint64 _instance = 0; // Level the mesh was built for
+
+    public:
+        struct Stats {
+            int Segments = 0;
+            size_t Bytes = 0;
+            int SegmentsBuilt = 0; // Segments rebuilt by the last Build or Update
+            int64 BuildTime = 0; // Microseconds for the last Build or Update
+        };
+
+        // Rebuilds the mesh for all segments
+        void Build(Level& level);
+
+        // Rebuilds segments that changed since the last build and refreshes wall solidity.
+        // Texture changes such as door animations only cost the signature scan.
+        // Falls back to a full build if segments were added or removed.
+        void Update(Level& level);
+
+        // Refreshes the solidity of sides with walls. Cheap enough to call every tick.
+        void UpdateWalls(Level& level);
+
+        void Clear();
+
+        // Returns true if the mesh was built for this level object. Copies of a level don't match.
+        bool Matches(const Level& level) const {
+            return _instance == level.Instance.Value() && _segments.size() == level.Segments.size();
+        }
+
+        const SegmentCollision& GetSegment(SegID id) const { return _segments[(int)id]; }
+        bool SegmentExists(SegID id) const { return id >= SegID(0) && (size_t)id < _segments.size(); }
+
+        const Stats& GetStats() const { return _stats; }
+        size_t Size() const { return _segments.size(); }
+
+    private:
+        Stats _stats;
+
+        void UpdateStats();
+    };
+
+    // Depth-first search over segments connected by portals that doesn't allocate in practice.
+    // Visited segments are tracked with per-thread generation stamps sized to the level,
+    // so starting a search is constant time and each segment is visited at most once.
+    // Segments beyond the fixed stack spill into a heap list so searches never skip geometry.
+    class PortalSearch {
+    public:
+        static constexpr int Capacity = 64;
+
+    private:
+        Array<SegID, Capacity> _stack{};
+        int _count = 0;
+        List<SegID> _overflow; // Used when the stack is full, which is rare
+        uint32 _generation = 0;
+        span<uint32> _stamps;
+
+    public:
+        PortalSearch(const LevelCollisionMesh& mesh, SegID start);
+
+        // Queues a segment. Returns false if it was already visited.
+        bool Push(SegID id);
+
+        SegID Pop() {
+            if (!_overflow.empty()) {
+                auto id = _overflow.back();
+                _overflow.pop_back();
+                return id;
+            }
+
+            return _stack[--_count];
+        }
+
+        bool Empty() const { return _count == 0 && _overflow.empty(); }
+    };
+
+    namespace Debug {
+        inline std::atomic<int> PortalSearchOverflows = 0; // Segments queued on the heap because a search stack was full
+    }
+
+    namespace Game {
+        // Collision mesh for the loaded level
+        inline LevelCollisionMesh CollisionMesh;
+    }
+}
@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "Game.Lights.h"
+#include "Settings.h"
+
+namespace Inferno {
+    namespace {
+        void ChangeLight(Level& level, const LightDeltaIndex& index, float multiplier, List<Tag>* changedSides) {
+            for (int j = 0; j < index.Count; j++) {
+                auto& dlp = level.LightDeltas[index.Index + j];
+                assert(level.SegmentExists(dlp.Tag));
+                auto& side = level.GetSide(dlp.Tag);
+
+                for (int k = 0; k < 4; k++) {
+                    side.Light[k] += dlp.Color[k] * multiplier;
+                    ClampColor(side.Light[k], 0.0f, Settings::Editor.Lighting.MaxValue);
+                }
+
+                if (changedSides)
+                    changedSides->push_back(dlp.Tag);
+            }
+        }
+
+        bool FlickerIsDisabled(const FlickeringLight& light) {
+            return light.Timer == FLT_MAX || light.Delay <= 0.001f;
+        }
+
+        // Each step of the delay moves to the next lower bit of the mask, starting from bit 0 and wrapping to bit 31
+        bool FlickerIsOn(uint32 mask, int64 step) {
+            auto bit = (32 - step % 32) % 32;
+            return (mask >> bit) & 0x1;
+        }
+
+        // Returns the next step where the light changes state. Masks with every bit the same never change.
+        Option<int64> NextFlickerChange(uint32 mask, int64 step) {
+            auto on = FlickerIsOn(mask, step);
+            for (int64 i = 1; i < 32; i++) {
+                if (FlickerIsOn(mask, step + i) != on)
+                    return step + i;
+            }
+
+            return {};
+        }
+    }
+
+    void SubtractLight(Level& level, Tag light, Segment& seg, List<Tag>* changedSides) {
+        auto index = level.GetLightDeltaIndex(light);
+        if (!index) return;
+
+        if (seg.LightIsSubtracted(light.Side))
+            return;
+
+        seg.LightSubtracted |= (1 << (int)light.Side);
+        ChangeLight(level, *index, -1, changedSides);
+    }
+
+    void AddLight(Level& level, Tag light, Segment& seg, List<Tag>* changedSides) {
+        auto index = level.GetLightDeltaIndex(light);
+        if (!index) return;
+
+        if (!seg.LightIsSubtracted(light.Side))
+            return;
+
+        seg.LightSubtracted &= ~(1 << (int)light.Side);
+        ChangeLight(level, *index, 1, changedSides);
+    }
+
+    void ToggleLight(Level& level, Tag light, List<Tag>* changedSides) {
+        auto index = level.GetLightDeltaIndex(light);
+        if (!index) return;
+
+        auto& seg = level.GetSegment(light);
+        if (seg.LightSubtracted & (1 << (int)light.Side)) {
+            AddLight(level, light, seg, changedSides);
+        }
+        else {
+            SubtractLight(level, light, seg, changedSides);
+        }
+    }
+
+    // Returns true if the lights were edited since they were scheduled
+    bool FlickeringLightSchedule::IsStale(const Level& level) const {
+        if (level.FlickeringLights.size() != _scheduled.size()) return true;
+
+        for (size_t i = 0; i < _scheduled.size(); i++) {
+            auto& a = level.FlickeringLights[i];
+            auto& b = _scheduled[i];
+            if (a.Tag != b.Tag || a.Mask != b.Mask || a.Delay != b.Delay || FlickerIsDisabled(a) != FlickerIsDisabled(b))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Sets the state of a light for a step and schedules its next change
+    void FlickeringLightSchedule::UpdateLight(Level& level, int index, int64 step, List<Tag>& changedSides) {
+        auto& light = level.FlickeringLights[index];
+        auto seg = level.TryGetSegment(light.Tag);
+        if (!seg) return;
+
+        // Lights on open sides stay scheduled in case the side closes
+        if (!seg->SideHasConnection(light.Tag.Side) || seg->SideIsWall(light.Tag.Side)) {
+            if (FlickerIsOn(light.Mask, step))
+                AddLight(level, light.Tag, *seg, &changedSides);
+            else
+                SubtractLight(level, light.Tag, *seg, &changedSides);
+        }
+
+        if (auto next = NextFlickerChange(light.Mask, step))
+            _events.push({ *next * (double)light.Delay, *next, index });
+    }
+
+    void FlickeringLightSchedule::Schedule(Level& level, double t, List<Tag>& changedSides) {
+        _events = {};
+        _scheduled = level.FlickeringLights;
+
+        for (int i = 0; i < level.FlickeringLights.size(); i++) {
+            auto& light = level.FlickeringLights[i];
+            if (FlickerIsDisabled(light)) continue;
+            UpdateLight(level, i, (int64)std::floor(t / light.Delay), changedSides);
+        }
+    }
+
+    void FlickeringLightSchedule::Update(Level& level, double t, List<Tag>& changedSides) {
+        _stats.Wakes = 0;
+
+        if (t < _lastTime || IsStale(level))
+            Schedule(level, t, changedSides);
+
+        _lastTime = t;
+
+        while (!_events.empty() && _events.top().Time <= t) {
+            auto event = _events.top();
+            _events.pop();
+
+            // Skip ahead if several steps passed since the last update
+            auto& light = level.FlickeringLights[event.Light];
+            auto step = std::max(event.Step, (int64)std::floor(t / light.Delay));
+            UpdateLight(level, event.Light, step, changedSides);
+            _stats.Wakes++;
+        }
+
+        _stats.Scheduled = (int)_events.size();
+    }
+
+    void FlickeringLightSchedule::Reset() {
+        _events = {};
+        _scheduled.clear();
+        _lastTime = 0;
+        _stats = {};
+    }
+}
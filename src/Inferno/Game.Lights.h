@@ -0,0 +1,51 @@
+#pragma once
+#include "Level.h"
+
+namespace Inferno {
+    // Sides whose light changed are appended to changedSides when it is provided
+    void SubtractLight(Level& level, Tag light, Segment& seg, List<Tag>* changedSides = nullptr);
+    void AddLight(Level& level, Tag light, Segment& seg, List<Tag>* changedSides = nullptr);
+    void ToggleLight(Level& level, Tag light, List<Tag>* changedSides = nullptr);
+
+    struct FlickeringLightStats {
+        int Scheduled = 0; // Lights waiting for a change
+        int Wakes = 0; // Lights that changed during the last update
+    };
+
+    // Wakes flickering lights only when their mask changes state.
+    // Rescheduled when the lights are edited or time goes backwards.
+    class FlickeringLightSchedule {
+        // The next time a flickering light changes state
+        struct Event {
+            double Time;
+            int64 Step; // Step of the mask the light changes at
+            int Light; // Index into the level's flickering lights
+
+            bool operator>(const Event& rhs) const { return Time > rhs.Time; }
+        };
+
+        std::priority_queue<Event, List<Event>, std::greater<>> _events;
+        List<FlickeringLight> _scheduled; // Lights as they were when scheduled
+        double _lastTime = 0;
+        FlickeringLightStats _stats;
+
+    public:
+        // Sets the lights that changed state by time t and appends the sides whose light changed
+        void Update(Level& level, double t, List<Tag>& changedSides);
+
+        // Reschedules every light on the next update, such as after lights were turned back on
+        void Reset();
+
+        const FlickeringLightStats& GetStats() const { return _stats; }
+
+    private:
+        bool IsStale(const Level& level) const;
+        void Schedule(Level& level, double t, List<Tag>& changedSides);
+        void UpdateLight(Level& level, int index, int64 step, List<Tag>& changedSides);
+    };
+
+    namespace Game {
+        // Flickering light state for the loaded level
+        inline FlickeringLightSchedule FlickerSchedule;
+    }
+}
@@ -0,0 +1,312 @@
+#include "pch.h"
+#include "Game.Navigation.h"
+#include "ScopedTimer.h"
+
+namespace Inferno {
+    namespace {
+        using OpenList = List<std::pair<float, SegID>>; // Min-heap of cost and segment
+
+        void PushOpen(OpenList& open, float cost, SegID seg) {
+            open.push_back({ cost, seg });
+            ranges::push_heap(open, std::greater<>{});
+        }
+
+        std::pair<float, SegID> PopOpen(OpenList& open) {
+            ranges::pop_heap(open, std::greater<>{});
+            auto top = open.back();
+            open.pop_back();
+            return top;
+        }
+
+        bool HasKeys(WallKey held, WallKey required) {
+            auto keys = (uint8)required & ~(uint8)WallKey::None;
+            return ((uint8)held & keys) == keys;
+        }
+    }
+
+    bool CanPassSide(const Level& level, Tag tag, const PathAccess& access) {
+        auto seg = level.TryGetSegment(tag);
+        if (!seg || !seg->SideHasConnection(tag.Side)) return false;
+
+        auto wall = level.TryGetWall(level.TryGetWallID(tag));
+        if (!wall) return true;
+
+        switch (wall->Type) {
+            case WallType::Illusion:
+            case WallType::FlyThroughTrigger:
+                return true;
+
+            case WallType::Destroyable:
+                return wall->HasFlag(WallFlag::Blasted);
+
+            case WallType::Door:
+                if (wall->HasFlag(WallFlag::DoorOpened)) return true;
+                if (!access.OpenDoors || wall->HasFlag(WallFlag::DoorLocked)) return false;
+                if (access.GuideBot && wall->HasFlag(WallFlag::BuddyProof)) return false;
+                return HasKeys(access.Keys, wall->Keys);
+
+            default:
+                return false; // Closed, cloaked and trigger walls are solid
+        }
+    }
+
+    void SegmentNavigation::Build(const Level& level) {
+        Clear();
+        _edges.resize(level.Segments.size());
+        _centers.resize(level.Segments.size());
+
+        for (int id = 0; id < level.Segments.size(); id++) {
+            auto& seg = level.Segments[id];
+            _centers[id] = seg.Center;
+
+            for (auto& sideId : SideIDs) {
+                auto conn = seg.GetConnection(sideId);
+                if (!level.SegmentExists(conn)) continue;
+
+                auto& side = seg.GetSide(sideId);
+                auto& edge = _edges[id][(int)sideId];
+                edge.Neighbor = conn;
+                edge.Back = level.GetConnectedSide(SegID(id), conn);
+                edge.Cost = Vector3::Distance(seg.Center, side.Center) +
+                    Vector3::Distance(side.Center, level.GetSegment(conn).Center);
+            }
+        }
+
+        _stats.Segments = (int)_edges.size();
+    }
+
+    void SegmentNavigation::Clear() {
+        _edges.clear();
+        _centers.clear();
+        _fields.clear();
+        _cost.clear();
+        _from.clear();
+        _stats = {};
+    }
+
+    float SegmentNavigation::GetCost(const Level& level, SegID seg, SideID side, const PathAccess& access) const {
+        auto& edge = _edges[(int)seg][(int)side];
+        if (edge.Neighbor == SegID::None || !CanPassSide(level, { seg, side }, access))
+            return FLT_MAX;
+
+        return edge.Cost;
+    }
+
+    bool SegmentNavigation::FindPath(const Level& level, SegID start, SegID goal, const PathAccess& access, List<SegID>& path) {
+        path.clear();
+        if (!Matches(level)) Build(level);
+        if (!level.SegmentExists(start) || !level.SegmentExists(goal)) return false;
+
+        _cost.assign(_edges.size(), FLT_MAX);
+        _from.assign(_edges.size(), SegID::None);
+
+        // Each step costs at least the straight line between centers, so the distance to the goal never overestimates
+        auto& goalCenter = _centers[(int)goal];
+        auto estimate = [&](SegID seg) { return Vector3::Distance(_centers[(int)seg], goalCenter); };
+
+        OpenList open;
+        _cost[(int)start] = 0;
+        PushOpen(open, estimate(start), start);
+
+        while (!open.empty()) {
+            auto [score, seg] = PopOpen(open);
+            if (seg == goal) break;
+
+            // Skip entries that were superseded by a cheaper route
+            auto cost = _cost[(int)seg];
+            if (score > cost + estimate(seg)) continue;
+
+            for (auto& sideId : SideIDs) {
+                auto step = GetCost(level, seg, sideId, access);
+                if (step == FLT_MAX) continue;
+
+                auto next = _edges[(int)seg][(int)sideId].Neighbor;
+                if (cost + step < _cost[(int)next]) {
+                    _cost[(int)next] = cost + step;
+                    _from[(int)next] = seg;
+                    PushOpen(open, cost + step + estimate(next), next);
+                }
+            }
+        }
+
+        if (_cost[(int)goal] == FLT_MAX) return false;
+
+        for (auto seg = goal; seg != SegID::None; seg = _from[(int)seg])
+            path.push_back(seg);
+
+        ranges::reverse(path);
+        return true;
+    }
+
+    const DistanceField& SegmentNavigation::GetDistanceField(const Level& level, SegID target, const PathAccess& access) {
+        if (!Matches(level)) Build(level);
+
+        auto iter = ranges::find_if(_fields, [&](const DistanceField& f) { return f.Target == target && f.Access == access; });
+        if (iter != _fields.end()) {
+            iter->LastUsed = ++_useCounter;
+            return *iter;
+        }
+
+        DistanceField* field;
+        if (_fields.size() < MaxDistanceFields) {
+            field = &_fields.emplace_back();
+        }
+        else {
+            field = &*ranges::min_element(_fields, {}, &DistanceField::LastUsed);
+        }
+
+        field->Target = target;
+        field->Access = access;
+        field->LastUsed = ++_useCounter;
+        BuildField(level, *field);
+        _stats.Fields = (int)_fields.size();
+        return *field;
+    }
+
+    void SegmentNavigation::BuildField(const Level& level, DistanceField& field) {
+        field.Distance.assign(_edges.size(), FLT_MAX);
+        field.Next.assign(_edges.size(), SegID::None);
+        _stats.FieldBuilds++;
+
+        if (!level.SegmentExists(field.Target)) return;
+
+        OpenList open;
+        field.Distance[(int)field.Target] = 0;
+        PushOpen(open, 0, field.Target);
+        Propagate(level, field, open);
+    }
+
+    // Dijkstra outwards from the open segments. Costs are checked from the neighbor's side, as that is the direction of travel.
+    void SegmentNavigation::Propagate(const Level& level, DistanceField& field, OpenList& open) {
+        while (!open.empty()) {
+            auto [distance, seg] = PopOpen(open);
+            if (distance > field.Distance[(int)seg]) continue; // Superseded
+
+            for (auto& edge : _edges[(int)seg]) {
+                if (edge.Neighbor == SegID::None || edge.Back == SideID::None) continue;
+
+                auto step = GetCost(level, edge.Neighbor, edge.Back, field.Access);
+                if (step == FLT_MAX) continue;
+
+                auto& neighbor = field.Distance[(int)edge.Neighbor];
+                if (distance + step < neighbor) {
+                    neighbor = distance + step;
+                    field.Next[(int)edge.Neighbor] = seg;
+                    PushOpen(open, neighbor, edge.Neighbor);
+                }
+            }
+        }
+    }
+
+    void SegmentNavigation::OnWallChanged(const Level& level, Tag tag) {
+        if (!Matches(level) || !level.SegmentExists(tag)) return;
+
+        auto other = level.GetConnectedSide(tag);
+        if (!other) return;
+
+        _stats.RepairTime = 0;
+        _stats.SegmentsRepaired = 0;
+        ScopedTimer timer(&_stats.RepairTime);
+
+        for (auto& field : _fields)
+            RepairField(level, field, tag.Segment, other.Segment);
+    }
+
+    // Invalidates segments whose route crossed a side that closed, then floods back in from their valid neighbors.
+    // The ends of the side are also reopened so a side that opened can offer shorter routes.
+    void SegmentNavigation::RepairField(const Level& level, DistanceField& field, SegID a, SegID b) {
+        _stats.FieldRepairs++;
+
+        auto blocked = [&](SegID from, SegID to) {
+            auto side = level.GetConnectedSide(to, from); // Side of the segment being left
+            return side == SideID::None || GetCost(level, from, side, field.Access) == FLT_MAX;
+        };
+
+        List<SegID> invalid;
+        if (field.Next[(int)a] == b && blocked(a, b)) invalid.push_back(a);
+        if (field.Next[(int)b] == a && blocked(b, a)) invalid.push_back(b);
+
+        if (!invalid.empty()) {
+            // Index the route tree by parent to find everything routed through the invalid segments
+            List<int> offsets(_edges.size() + 1);
+            for (auto next : field.Next)
+                if (next != SegID::None) offsets[(int)next + 1]++;
+
+            for (size_t i = 1; i < offsets.size(); i++)
+                offsets[i] += offsets[i - 1];
+
+            List<SegID> children(offsets.back());
+            List<int> fill(offsets.begin(), offsets.end() - 1);
+            for (int i = 0; i < field.Next.size(); i++)
+                if (field.Next[i] != SegID::None) children[fill[(int)field.Next[i]]++] = SegID(i);
+
+            for (size_t i = 0; i < invalid.size(); i++) {
+                auto seg = (int)invalid[i];
+                for (int c = offsets[seg]; c < offsets[seg + 1]; c++)
+                    invalid.push_back(children[c]);
+            }
+
+            for (auto seg : invalid) {
+                field.Distance[(int)seg] = FLT_MAX;
+                field.Next[(int)seg] = SegID::None;
+            }
+        }
+
+        _stats.SegmentsRepaired += (int)invalid.size();
+
+        OpenList open;
+        for (auto seg : invalid) {
+            for (auto& edge : _edges[(int)seg]) {
+                if (edge.Neighbor != SegID::None && field.Distance[(int)edge.Neighbor] != FLT_MAX)
+                    PushOpen(open, field.Distance[(int)edge.Neighbor], edge.Neighbor);
+            }
+        }
+
+        if (field.Distance[(int)a] != FLT_MAX) PushOpen(open, field.Distance[(int)a], a);
+        if (field.Distance[(int)b] != FLT_MAX) PushOpen(open, field.Distance[(int)b], b);
+
+        Propagate(level, field, open);
+    }
+
+    NavigationBenchmark RunNavigationBenchmark(const Level& level, SegID target, int robots) {
+        NavigationBenchmark result{ .Robots = robots };
+        if (!level.SegmentExists(target)) return result;
+
+        SegmentNavigation navigation;
+        navigation.Build(level);
+        PathAccess access{ .OpenDoors = true };
+
+        List<SegID> starts(robots);
+        for (auto& start : starts)
+            start = SegID(Random() * (level.Segments.size() - 1));
+
+        List<SegID> path;
+        int searchReachable = 0;
+
+        {
+            ScopedTimer timer(&result.SearchTime);
+            for (auto start : starts) {
+                if (navigation.FindPath(level, start, target, access, path))
+                    searchReachable++;
+            }
+        }
+
+        {
+            ScopedTimer timer(&result.FieldBuildTime);
+            navigation.GetDistanceField(level, target, access);
+        }
+
+        {
+            ScopedTimer timer(&result.FieldTime);
+            for (auto start : starts) {
+                if (start == target || navigation.GetNextSegment(level, start, target, access) != SegID::None)
+                    result.Reachable++;
+            }
+        }
+
+        if (searchReachable != result.Reachable)
+            SPDLOG_WARN("A* reached the target from {} segments but the distance field from {}", searchReachable, result.Reachable);
+
+        return result;
+    }
+}
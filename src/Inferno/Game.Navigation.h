@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Level.h"
+#include "Robot.h"
+
+namespace Inferno {
+    // Walls an object can path through
+    struct PathAccess {
+        WallKey Keys = WallKey::None; // Keys for locked doors
+        bool OpenDoors = false; // Can open closed doors that don't need keys
+        bool GuideBot = false; // Blocked by buddy proof doors
+
+        bool operator==(const PathAccess&) const = default;
+
+        // Robots open unlocked doors like in the original game
+        static PathAccess ForRobot(const RobotInfo& robot) {
+            return { .OpenDoors = true, .GuideBot = robot.IsCompanion };
+        }
+    };
+
+    // Returns true if an object with the access can move through the side. Sides without a connection are never passable.
+    bool CanPassSide(const Level& level, Tag tag, const PathAccess& access);
+
+    // Cost of reaching each segment from a target, used to step many objects towards the same place
+    struct DistanceField {
+        SegID Target = SegID::None;
+        PathAccess Access;
+        List<float> Distance; // To the target from each segment. FLT_MAX when unreachable.
+        List<SegID> Next; // Next segment towards the target. None at the target or when unreachable.
+        uint32 LastUsed = 0;
+    };
+
+    // Paths between segments through the connectivity graph.
+    // Moving between two segments costs the distance from the first center to the shared side's center and on to the second center.
+    // Distance fields for common targets are cached and repaired when walls open or close instead of being rebuilt.
+    class SegmentNavigation {
+        struct Edge {
+            SegID Neighbor = SegID::None;
+            SideID Back = SideID::None; // Side of the neighbor that connects back
+            float Cost = 0;
+        };
+
+        List<Array<Edge, 6>> _edges; // Per segment
+        List<Vector3> _centers;
+        List<DistanceField> _fields;
+        uint32 _useCounter = 0;
+
+        // Search buffers reused between queries
+        List<float> _cost;
+        List<SegID> _from;
+
+    public:
+        static constexpr int MaxDistanceFields = 16; // Least recently used fields are replaced
+
+        struct Stats {
+            int Segments = 0;
+            int Fields = 0; // Cached distance fields
+            int FieldBuilds = 0; // Fields built from scratch
+            int FieldRepairs = 0; // Fields repaired after a wall changed
+            int SegmentsRepaired = 0; // Segments invalidated by the last repair
+            int64 RepairTime = 0; // Microseconds for the last wall change
+        };
+
+        // Builds the graph and drops cached fields
+        void Build(const Level& level);
+        void Clear();
+
+        bool Matches(const Level& level) const { return _edges.size() == level.Segments.size(); }
+
+        // Finds the cheapest path with A*. The path includes both ends. Returns false if the goal can't be reached.
+        bool FindPath(const Level& level, SegID start, SegID goal, const PathAccess& access, List<SegID>& path);
+
+        // Returns the distance field towards a target, building it on first use
+        const DistanceField& GetDistanceField(const Level& level, SegID target, const PathAccess& access);
+
+        // Next segment to move to from a segment to reach the target. None if already there or unreachable.
+        SegID GetNextSegment(const Level& level, SegID from, SegID target, const PathAccess& access) {
+            auto& field = GetDistanceField(level, target, access);
+            return (size_t)from < field.Next.size() ? field.Next[(int)from] : SegID::None;
+        }
+
+        // Repairs cached fields after the wall on a side opened, closed or was destroyed
+        void OnWallChanged(const Level& level, Tag tag);
+
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        Stats _stats;
+
+        float GetCost(const Level& level, SegID seg, SideID side, const PathAccess& access) const;
+        void BuildField(const Level& level, DistanceField& field);
+        void RepairField(const Level& level, DistanceField& field, SegID a, SegID b);
+        void Propagate(const Level& level, DistanceField& field, List<std::pair<float, SegID>>& open);
+    };
+
+    struct NavigationBenchmark {
+        int Robots = 0;
+        int Reachable = 0; // Robots that found a path
+        int64 SearchTime = 0; // Microseconds to run A* for every robot
+        int64 FieldTime = 0; // Microseconds to step every robot using the cached field
+        int64 FieldBuildTime = 0; // Microseconds to build the field
+    };
+
+    // Places robots in random segments and paths them to a target, comparing A* against a cached distance field
+    NavigationBenchmark RunNavigationBenchmark(const Level& level, SegID target, int robots);
+
+    namespace Game {
+        // Navigation for the loaded level
+        inline SegmentNavigation Navigation;
+    }
+}
@@ -1,9 +1,8 @@
 #pragma once
 #include "Level.h"
+#include "Game.Lights.h"
 
 namespace Inferno {
-    void SubtractLight(Level& level, Tag light, Segment& seg);
-    void AddLight(Level& level, Tag light, Segment& seg);
-    void ToggleLight(Level& level, Tag light);
-    void UpdateFlickeringLights(Level& level, float t, float dt);
+    // Returns true if light can pass through this side. Depends on the connections, texture and wall type if present.
+    bool LightPassesThroughSide(const Level& level, const Segment& seg, SideID sideId);
 }
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "pch.h"
+#include <bit>
+#include <fstream>
+#include "Game.Simulation.h"
+#include "Game.h"
+#include "Resources.h"
+#include "ScopedTimer.h"
+#include "SoundSystem.h"
+
+namespace Inferno {
+    namespace {
+        constexpr uint32 RecordingMagic = 0x43455249; // IREC
+        constexpr uint32 RecordingVersion = 1;
+        constexpr int FireWeapon = 13;
+
+        struct RecordingHeader {
+            uint32 Magic = RecordingMagic;
+            uint32 Version = RecordingVersion;
+            uint32 TicksPerSecond = 0;
+            uint32 ChecksumInterval = 0;
+            uint64 StartChecksum = 0;
+            uint32 Ticks = 0;
+            uint32 Runs = 0;
+            uint32 Checksums = 0;
+            uint32 LevelNameLength = 0;
+        };
+
+        // A span of ticks with the same input
+        struct InputRun {
+            InputButton Buttons;
+            uint16 Count;
+        };
+
+        class StateHash {
+            uint64 _hash = 0xcbf29ce484222325;
+
+        public:
+            void Add(uint64 value) {
+                _hash ^= value + 0x9e3779b97f4a7c15ull + (_hash << 6) + (_hash >> 2);
+            }
+
+            void Add(float value) { Add((uint64)std::bit_cast<uint32>(value)); }
+
+            void Add(const Vector3& v) {
+                Add(v.x);
+                Add(v.y);
+                Add(v.z);
+            }
+
+            uint64 Value() const { return _hash; }
+        };
+
+        template<class T>
+        void Read(std::istream& stream, T* data, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            stream.read((char*)data, count * sizeof(T));
+            if (stream.gcount() != (std::streamsize)(count * sizeof(T)))
+                throw Exception("Recording is truncated");
+        }
+
+        template<class T>
+        void Write(std::ostream& stream, const T* data, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            stream.write((const char*)data, count * sizeof(T));
+        }
+    }
+
+    uint64 GetStateChecksum(const Level& level) {
+        StateHash hash;
+        hash.Add((uint64)level.Objects.size());
+
+        for (auto& obj : level.Objects) {
+            hash.Add((uint64)obj.Type);
+            hash.Add((uint64)obj.Segment);
+            hash.Add(obj.Lifespan);
+            hash.Add(obj.Position);
+            hash.Add(obj.Rotation.Forward());
+            hash.Add(obj.Rotation.Up());
+
+            if (obj.Movement.Type == MovementType::Physics) {
+                auto& pd = obj.Movement.Physics;
+                hash.Add(pd.Velocity);
+                hash.Add(pd.AngularVelocity);
+                hash.Add(pd.TurnRoll);
+            }
+        }
+
+        for (auto& wall : level.Walls) {
+            hash.Add((uint64)wall.State);
+            hash.Add((uint64)wall.Flags);
+            hash.Add(wall.HitPoints);
+        }
+
+        return hash.Value();
+    }
+
+    void InputRecording::Save(const filesystem::path& path) const {
+        List<InputRun> runs;
+        for (auto& input : Inputs) {
+            if (!runs.empty() && runs.back().Buttons == input.Buttons && runs.back().Count < UINT16_MAX)
+                runs.back().Count++;
+            else
+                runs.push_back({ input.Buttons, 1 });
+        }
+
+        RecordingHeader header{
+            .TicksPerSecond = (uint32)std::round(1 / FixedStepSimulation::TickTime),
+            .ChecksumInterval = ChecksumInterval,
+            .StartChecksum = StartChecksum,
+            .Ticks = (uint32)Inputs.size(),
+            .Runs = (uint32)runs.size(),
+            .Checksums = (uint32)Checksums.size(),
+            .LevelNameLength = (uint32)LevelName.size()
+        };
+
+        std::ofstream stream(path, std::ios::binary);
+        Write(stream, &header, 1);
+        Write(stream, LevelName.data(), LevelName.size());
+        Write(stream, runs.data(), runs.size());
+        Write(stream, Checksums.data(), Checksums.size());
+        if (!stream) throw Exception("Unable to write recording");
+    }
+
+    InputRecording InputRecording::Load(const filesystem::path& path) {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) throw Exception("Unable to open recording");
+
+        RecordingHeader header;
+        Read(stream, &header, 1);
+
+        if (header.Magic != RecordingMagic || header.Version != RecordingVersion)
+            throw Exception("Not a supported recording");
+
+        if (header.TicksPerSecond != (uint32)std::round(1 / FixedStepSimulation::TickTime) ||
+            header.ChecksumInterval != ChecksumInterval)
+            throw Exception("Recording uses a different tick rate");
+
+        InputRecording recording;
+        recording.StartChecksum = header.StartChecksum;
+        recording.LevelName.resize(header.LevelNameLength);
+        Read(stream, recording.LevelName.data(), header.LevelNameLength);
+
+        List<InputRun> runs(header.Runs);
+        Read(stream, runs.data(), runs.size());
+
+        recording.Inputs.reserve(header.Ticks);
+        for (auto& run : runs)
+            recording.Inputs.insert(recording.Inputs.end(), run.Count, TickInput{ run.Buttons });
+
+        if (recording.Inputs.size() != header.Ticks)
+            throw Exception("Recording tick count doesn't match its inputs");
+
+        recording.Checksums.resize(header.Checksums);
+        Read(stream, recording.Checksums.data(), recording.Checksums.size());
+        return recording;
+    }
+
+    float FixedStepSimulation::Update(Level& level, double frameTime) {
+        _accumulator += frameTime;
+        int ticks = 0;
+
+        while (_accumulator >= TickTime) {
+            if (ticks++ == MaxTicksPerFrame) {
+                _accumulator = 0; // Drop the remaining time instead of spiraling
+                break;
+            }
+
+            Tick(level, SampleInput());
+            _accumulator -= TickTime;
+        }
+
+        return float(_accumulator / TickTime);
+    }
+
+    void FixedStepSimulation::Tick(Level& level, const TickInput& input) {
+        if (level.Objects.empty()) return;
+
+        _fireDelay -= TickTime;
+        if (input.Has(InputButton::Fire) && _fireDelay <= 0) {
+            _fireDelay = Resources::GameData.Weapons[FireWeapon].FireDelay;
+            FirePlayerWeapon(level, level.Objects[0], 0, FireWeapon);
+            FirePlayerWeapon(level, level.Objects[0], 1, FireWeapon);
+        }
+
+        UpdatePhysics(level, _time, TickTime, input);
+        UpdateAI(level, _tick, TickTime);
+        if (!Game::Headless) Sound::UpdateOcclusion(); // Uses the live level and camera
+        _time += TickTime;
+        _tick++;
+
+        if (_recording) {
+            _recording->Inputs.push_back(input);
+            if (_recording->Inputs.size() % InputRecording::ChecksumInterval == 0)
+                _recording->Checksums.push_back(GetStateChecksum(level));
+        }
+    }
+
+    void FixedStepSimulation::StartRecording(const Level& level) {
+        // Replays start from a fresh simulation, so the recording has to as well
+        _accumulator = _time = 0;
+        _tick = 0;
+        _fireDelay = 0;
+        Game::AI.Clear();
+        Game::Broadphase.Clear();
+
+        _recording = InputRecording{
+            .LevelName = level.FileName,
+            .StartChecksum = GetStateChecksum(level),
+            .StartLevel = level
+        };
+    }
+
+    Option<InputRecording> FixedStepSimulation::StopRecording() {
+        auto recording = std::move(_recording);
+        _recording = {};
+        return recording;
+    }
+
+    HeadlessSimulationScope::HeadlessSimulationScope(const Level& level) : _headless(Game::Headless) {
+        Game::Headless = true;
+        _navigation.Build(level);
+        std::swap(_collisionMesh, Game::CollisionMesh);
+        std::swap(_broadphase, Game::Broadphase);
+        std::swap(_navigation, Game::Navigation);
+        std::swap(_ai, Game::AI);
+        std::swap(_flicker, Game::FlickerSchedule);
+    }
+
+    HeadlessSimulationScope::~HeadlessSimulationScope() {
+        std::swap(_collisionMesh, Game::CollisionMesh);
+        std::swap(_broadphase, Game::Broadphase);
+        std::swap(_navigation, Game::Navigation);
+        std::swap(_ai, Game::AI);
+        std::swap(_flicker, Game::FlickerSchedule);
+        Game::Headless = _headless;
+    }
+
+    ReplayReport ReplayHeadless(const Level& source, const InputRecording& recording) {
+        if (!recording.StartLevel && source.FileName != recording.LevelName)
+            throw Exception(fmt::format("Recording was made in {} but the loaded level is {}", recording.LevelName, source.FileName));
+
+        ReplayReport report;
+        auto level = recording.StartLevel ? *recording.StartLevel : source;
+        report.StartMatches = GetStateChecksum(level) == recording.StartChecksum;
+        if (!report.StartMatches)
+            SPDLOG_WARN("Level state doesn't match the start of the recording. Replay will diverge.");
+
+        report.TickTimes.reserve(recording.Inputs.size());
+        report.Checksums.reserve(recording.Inputs.size());
+
+        FixedStepSimulation simulation;
+        HeadlessSimulationScope scope(level);
+
+        {
+            ScopedTimer timer(&report.TotalTime);
+
+            for (int tick = 0; tick < recording.Inputs.size(); tick++) {
+                int64 time = 0;
+
+                {
+                    ScopedTimer tickTimer(&time);
+                    simulation.Tick(level, recording.Inputs[tick]);
+                }
+
+                auto checksum = GetStateChecksum(level);
+                report.TickTimes.push_back(time);
+                report.Checksums.push_back(checksum);
+
+                // Checksums are stored after every interval of ticks
+                if ((tick + 1) % InputRecording::ChecksumInterval == 0) {
+                    auto index = (tick + 1) / InputRecording::ChecksumInterval - 1;
+                    if ((size_t)index < recording.Checksums.size() && recording.Checksums[index] != checksum) {
+                        if (report.Mismatches++ == 0) report.FirstMismatch = tick;
+                    }
+                }
+            }
+        }
+
+        return report;
+    }
+
+    void WriteReplayReportCsv(const ReplayReport& report, std::ostream& stream) {
+        stream << "tick,time_us,checksum\n";
+        for (size_t i = 0; i < report.TickTimes.size(); i++)
+            stream << fmt::format("{},{},{:016x}\n", i, report.TickTimes[i], report.Checksums[i]);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Level.h"
+#include "Physics.h"
+#include "Game.AI.h"
+#include "Game.Broadphase.h"
+#include "Game.CollisionMesh.h"
+#include "Game.Lights.h"
+
+namespace Inferno {
+    // Inputs for each tick of a simulation run, with state checksums to verify replays against
+    struct InputRecording {
+        static constexpr int ChecksumInterval = 16; // Ticks between stored checksums
+
+        string LevelName; // File name of the level the recording started in
+        uint64 StartChecksum = 0; // Level state when recording started
+        List<TickInput> Inputs; // One per tick
+        List<uint64> Checksums; // State after every ChecksumInterval ticks
+
+        // The level as it was when recording started. Not saved, so loaded recordings replay against the named level.
+        Option<Level> StartLevel;
+
+        // Inputs are run-length encoded as they rarely change between ticks. Throws on failure.
+        void Save(const filesystem::path& path) const;
+        static InputRecording Load(const filesystem::path& path);
+    };
+
+    // Returns a hash of the simulated state: objects, their movement and walls.
+    // Floats are hashed by their bits so any divergence between runs changes the checksum.
+    uint64 GetStateChecksum(const Level& level);
+
+    // Runs physics at a fixed rate regardless of the frame rate. Rendering blends between
+    // the previous and current tick using LastPosition and LastRotation.
+    class FixedStepSimulation {
+        double _accumulator = 0;
+        double _time = 0;
+        uint32 _tick = 0;
+        float _fireDelay = 0;
+        Option<InputRecording> _recording;
+
+    public:
+        static constexpr float TickTime = 1.0f / 64;
+        static constexpr int MaxTicksPerFrame = 8; // Drops time instead of falling further behind after a stall
+
+        // Runs the ticks that fit in the elapsed time using live input.
+        // Returns the blend factor between the previous and current tick.
+        float Update(Level& level, double frameTime);
+
+        // Advances the simulation by one tick
+        void Tick(Level& level, const TickInput& input);
+
+        // Also resets the AI schedule and broadphase so the recording starts from the same state as a replay
+        void StartRecording(const Level& level);
+        Option<InputRecording> StopRecording();
+        bool IsRecording() const { return _recording.has_value(); }
+        int RecordedTicks() const { return _recording ? (int)_recording->Inputs.size() : 0; }
+
+        uint32 GetTick() const { return _tick; }
+    };
+
+    // Swaps empty simulation state in for the loaded level's and turns on headless mode for the lifetime of the scope.
+    // Lets a copy of a level be simulated without touching the live game, which is restored untouched afterwards.
+    class HeadlessSimulationScope {
+        bool _headless;
+        LevelCollisionMesh _collisionMesh;
+        ObjectBroadphase _broadphase;
+        SegmentNavigation _navigation;
+        AIScheduler _ai;
+        FlickeringLightSchedule _flicker;
+
+    public:
+        // Navigation is built for the level being simulated. The other state builds itself on the first tick.
+        HeadlessSimulationScope(const Level& level);
+        ~HeadlessSimulationScope();
+
+        HeadlessSimulationScope(const HeadlessSimulationScope&) = delete;
+        HeadlessSimulationScope(HeadlessSimulationScope&&) = delete;
+        HeadlessSimulationScope& operator=(const HeadlessSimulationScope&) = delete;
+        HeadlessSimulationScope& operator=(HeadlessSimulationScope&&) = delete;
+    };
+
+    struct ReplayReport {
+        List<int64> TickTimes; // Microseconds per tick
+        List<uint64> Checksums; // State after each tick
+        bool StartMatches = false; // The level matched the state the recording started from
+        int Mismatches = 0; // Stored checksums that didn't match
+        int FirstMismatch = -1; // Tick of the first mismatch
+        int64 TotalTime = 0; // Microseconds
+
+        int64 MaxTickTime() const { return TickTimes.empty() ? 0 : *std::ranges::max_element(TickTimes); }
+    };
+
+    // Reruns a recording without rendering, sounds or effects. Starts from the recording's snapshot of the level
+    // when it has one, otherwise from a copy of the level passed in. Throws if that level isn't the recorded one.
+    ReplayReport ReplayHeadless(const Level& level, const InputRecording& recording);
+
+    // Writes the timing and checksum of each tick
+    void WriteReplayReportCsv(const ReplayReport& report, std::ostream& stream);
+
+    namespace Game {
+        // Physics simulation for the loaded level
+        inline FixedStepSimulation Simulation;
+    }
+}
@@ -0,0 +1,399 @@
+#include "pch.h"
+#include <execution>
+#include "Game.Visibility.h"
+#include "Game.Segment.h"
+#include "ScopedTimer.h"
+#include "Utility.h"
+
+namespace Inferno {
+    namespace {
+        constexpr float PortalPlaneTolerance = 0.01f;
+
+        // Points this close to a clip plane are kept, which also absorbs sides that aren't quite planar
+        constexpr float ClipTolerance = 0.1f;
+
+        // Portal steps and path length allowed for a row before it falls back to the coarse flood
+        constexpr int MaxFlowSteps = 20000;
+        constexpr int MaxFlowDepth = 256;
+
+        // Hashes the segment state that affects visibility: connections, vertices, walls and textures
+        uint64 GetVisibilitySignature(const Level& level, const Segment& seg) {
+            uint64 hash = 0;
+
+            for (auto& index : seg.Indices) {
+                auto& v = level.Vertices[index];
+                HashCombine(hash, v.x);
+                HashCombine(hash, v.y);
+                HashCombine(hash, v.z);
+            }
+
+            for (auto& sideId : SideIDs) {
+                auto& side = seg.GetSide(sideId);
+                HashCombine(hash, (uint64)seg.GetConnection(sideId));
+                HashCombine(hash, (uint64)side.TMap);
+                HashCombine(hash, (uint64)side.TMap2);
+
+                if (auto wall = level.TryGetWall(side.Wall)) {
+                    HashCombine(hash, (uint64)wall->Type);
+                    HashCombine(hash, (uint64)(wall->BlocksLight ? 1 + *wall->BlocksLight : 0));
+                }
+            }
+
+            return hash;
+        }
+
+        // Returns true if any vertex of the portal is on the far side of the source portal plane
+        bool PortalIsBeyond(const Level& level, const Segment& seg, SideID sideId, const Vector3& center, const Vector3& normal) {
+            for (auto& index : seg.GetVertexIndices(sideId)) {
+                // Side normals point into the segment, so the far side of a portal is negative
+                if (DistanceFromPlane(level.Vertices[index], center, normal) < -PortalPlaneTolerance)
+                    return true;
+            }
+
+            return false;
+        }
+
+        // Floods the portal graph from each open side of the source segment.
+        // Only checks portals against the source portal's plane, so it is coarse but cheap.
+        void FloodRow(const Level& level, SegID src, span<uint64> row, List<uint32>& visited, uint32& generation) {
+            auto setBit = [&row](SegID id) { row[(size_t)id / 64] |= 1ull << ((size_t)id % 64); };
+            setBit(src);
+
+            auto& srcSeg = level.GetSegment(src);
+            Stack<SegID> search;
+
+            for (auto& srcSide : SideIDs) {
+                if (!LightPassesThroughSide(level, srcSeg, srcSide)) continue;
+
+                auto& portal = srcSeg.GetSide(srcSide);
+                auto center = portal.Center;
+                auto normal = portal.AverageNormal;
+
+                generation++;
+                visited[(int)src] = generation;
+                auto start = srcSeg.GetConnection(srcSide);
+                visited[(int)start] = generation;
+                search.push(start);
+
+                while (!search.empty()) {
+                    auto segId = search.top();
+                    search.pop();
+                    setBit(segId);
+                    auto& seg = level.GetSegment(segId);
+
+                    for (auto& sideId : SideIDs) {
+                        if (!LightPassesThroughSide(level, seg, sideId)) continue;
+                        auto connection = seg.GetConnection(sideId);
+                        if (visited[(int)connection] == generation) continue;
+                        if (!PortalIsBeyond(level, seg, sideId, center, normal)) continue;
+
+                        visited[(int)connection] = generation;
+                        search.push(connection);
+                    }
+                }
+            }
+        }
+
+        // The part of a portal that can still be seen through
+        struct Winding {
+            static constexpr int Capacity = 16;
+            Array<Vector3, Capacity> Points;
+            int Count = 0;
+        };
+
+        Winding GetPortalWinding(const Level& level, const Segment& seg, SideID sideId) {
+            Winding winding;
+            for (auto& index : seg.GetVertexIndices(sideId))
+                winding.Points[winding.Count++] = level.Vertices[index];
+
+            return winding;
+        }
+
+        // Keeps the part of the winding in front of the plane. Returns false if nothing is left.
+        // A winding that would outgrow its capacity is left unclipped, which only makes the result larger.
+        bool ClipWinding(Winding& winding, const Plane& plane) {
+            Array<float, Winding::Capacity> dists;
+            int front = 0;
+
+            for (int i = 0; i < winding.Count; i++) {
+                dists[i] = plane.DotCoordinate(winding.Points[i]) + ClipTolerance;
+                if (dists[i] >= 0) front++;
+            }
+
+            if (front == 0) return false;
+            if (front == winding.Count) return true;
+
+            Winding clipped;
+            for (int i = 0; i < winding.Count; i++) {
+                auto j = (i + 1) % winding.Count;
+                auto& a = winding.Points[i];
+                auto& b = winding.Points[j];
+
+                if (dists[i] >= 0) {
+                    if (clipped.Count == Winding::Capacity) return true;
+                    clipped.Points[clipped.Count++] = a;
+                }
+
+                if ((dists[i] >= 0) != (dists[j] >= 0)) {
+                    if (clipped.Count == Winding::Capacity) return true;
+                    clipped.Points[clipped.Count++] = a + (b - a) * (dists[i] / (dists[i] - dists[j]));
+                }
+            }
+
+            winding = clipped;
+            return true;
+        }
+
+        // Clips the target to the planes that separate the source from the pass winding.
+        // Any line through both windings stays in front of these planes. Flip clips to the back
+        // side, used when the source and pass are swapped to find the planes from the other side.
+        bool ClipToSeparators(const Winding& source, const Winding& pass, Winding& target, bool flip) {
+            for (int i = 0; i < source.Count; i++) {
+                auto l = (i + 1) % source.Count;
+                auto edge = source.Points[l] - source.Points[i];
+
+                for (int j = 0; j < pass.Count; j++) {
+                    auto normal = edge.Cross(pass.Points[j] - source.Points[i]);
+                    if (normal.Length() < 0.001f) continue;
+                    normal.Normalize();
+                    Plane plane(pass.Points[j], normal);
+
+                    // Find which side of the plane the source is on
+                    Option<bool> sourceInFront;
+                    for (int k = 0; k < source.Count && !sourceInFront; k++) {
+                        if (k == i || k == l) continue;
+                        auto d = plane.DotCoordinate(source.Points[k]);
+                        if (d < -ClipTolerance) sourceInFront = false;
+                        else if (d > ClipTolerance) sourceInFront = true;
+                    }
+
+                    if (!sourceInFront) continue; // Source is on the plane
+                    if (*sourceInFront) plane = Plane(pass.Points[j], -normal);
+
+                    // It is a separating plane if the whole pass winding is in front of it
+                    bool behind = false;
+                    int front = 0;
+                    for (int k = 0; k < pass.Count && !behind; k++) {
+                        if (k == j) continue;
+                        auto d = plane.DotCoordinate(pass.Points[k]);
+                        if (d < -ClipTolerance) behind = true;
+                        else if (d > ClipTolerance) front++;
+                    }
+
+                    if (behind || front == 0) continue;
+
+                    if (flip) plane = Plane(-plane.Normal(), -plane.D());
+                    if (!ClipWinding(target, plane)) return false;
+                }
+            }
+
+            return true;
+        }
+
+        struct PortalFlow {
+            const Inferno::Level& Level;
+            span<uint64> Row;
+            List<uint8>& OnPath; // Segments on the current path. A line can't pass through a segment twice.
+            Winding Source;
+            Plane SourcePlane;
+            int Steps = 0;
+
+            // Marks the segment and follows its portals that can be seen through the pass winding.
+            // Returns false when the row runs out of steps.
+            bool Trace(SegID segId, const Winding* pass, int depth) {
+                if (++Steps > MaxFlowSteps || depth > MaxFlowDepth) return false;
+
+                Row[(size_t)segId / 64] |= 1ull << ((size_t)segId % 64);
+                OnPath[(int)segId] = true;
+                auto& seg = Level.GetSegment(segId);
+                bool finished = true;
+
+                for (auto& sideId : SideIDs) {
+                    if (!LightPassesThroughSide(Level, seg, sideId)) continue;
+                    auto connection = seg.GetConnection(sideId);
+                    if (OnPath[(int)connection]) continue;
+
+                    auto target = GetPortalWinding(Level, seg, sideId);
+                    if (!ClipWinding(target, SourcePlane)) continue;
+
+                    if (pass) {
+                        if (!ClipToSeparators(Source, *pass, target, false)) continue;
+                        if (!ClipToSeparators(*pass, Source, target, true)) continue;
+                    }
+
+                    if (!Trace(connection, &target, depth + 1)) {
+                        finished = false;
+                        break;
+                    }
+                }
+
+                OnPath[(int)segId] = false;
+                return finished;
+            }
+        };
+
+        // Traces the portals seen through each open side of the source segment.
+        // Returns false if the row was too expensive to trace and was flooded instead.
+        bool BuildRow(const Level& level, SegID src, span<uint64> row, List<uint8>& onPath, List<uint32>& visited, uint32& generation) {
+            std::ranges::fill(row, 0);
+            row[(size_t)src / 64] |= 1ull << ((size_t)src % 64);
+
+            auto& srcSeg = level.GetSegment(src);
+            onPath[(int)src] = true;
+            bool finished = true;
+
+            for (auto& srcSide : SideIDs) {
+                if (!LightPassesThroughSide(level, srcSeg, srcSide)) continue;
+
+                // Side normals point into the segment, so the far side of the portal is in front of the flipped plane
+                auto& portal = srcSeg.GetSide(srcSide);
+                PortalFlow flow{
+                    .Level = level,
+                    .Row = row,
+                    .OnPath = onPath,
+                    .Source = GetPortalWinding(level, srcSeg, srcSide),
+                    .SourcePlane = Plane(portal.Center, -portal.AverageNormal)
+                };
+
+                if (!flow.Trace(srcSeg.GetConnection(srcSide), nullptr, 0)) {
+                    finished = false;
+                    break;
+                }
+            }
+
+            onPath[(int)src] = false;
+            if (finished) return true;
+
+            std::ranges::fill(onPath, 0);
+            std::ranges::fill(row, 0);
+            FloodRow(level, src, row, visited, generation);
+            return false;
+        }
+    }
+
+    void SegmentVisibility::BuildRows(const Level& level, span<const SegID> rows) {
+        // Rows are word aligned, so each worker writes to separate memory
+        std::atomic<int> fallbacks = 0;
+
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [this, &level, &fallbacks](SegID seg) {
+            thread_local List<uint8> onPath;
+            thread_local List<uint32> visited;
+            thread_local uint32 generation = 0;
+
+            if (visited.size() < _segments) {
+                onPath.assign(_segments, 0);
+                visited.assign(_segments, 0);
+                generation = 0;
+            }
+
+            if (!BuildRow(level, seg, GetRow(seg), onPath, visited, generation))
+                fallbacks++;
+        });
+
+        _stats.RowsBuilt = (int)rows.size();
+        _stats.FallbackRows = fallbacks;
+    }
+
+    void SegmentVisibility::Build(const Level& level) {
+        _stats = {};
+        ScopedTimer timer(&_stats.BuildTime);
+
+        _segments = level.Segments.size();
+        _rowWords = (_segments + 63) / 64;
+        _bits.assign(_segments * _rowWords, 0);
+        _signatures.resize(_segments);
+
+        List<SegID> rows(_segments);
+        for (size_t i = 0; i < _segments; i++) {
+            rows[i] = SegID(i);
+            _signatures[i] = GetVisibilitySignature(level, level.Segments[i]);
+        }
+
+        BuildRows(level, rows);
+        UpdateStats();
+    }
+
+    void SegmentVisibility::Update(const Level& level) {
+        if (level.Segments.size() != _segments) {
+            Build(level);
+            SPDLOG_INFO("Built segment visibility for {} segments in {:.3f} ms", _stats.Segments, _stats.BuildTime / 1000.0f);
+            return;
+        }
+
+        int64 elapsed = 0;
+
+        {
+            ScopedTimer timer(&elapsed);
+
+            // Segments touched by a change. Rows that can see any of them need to be rebuilt,
+            // as a change can open or close portals leading out of these segments.
+            List<uint64> touched(_rowWords);
+            auto touch = [&touched](SegID id) { touched[(size_t)id / 64] |= 1ull << ((size_t)id % 64); };
+            bool changed = false;
+
+            for (size_t i = 0; i < _segments; i++) {
+                auto& seg = level.Segments[i];
+                auto signature = GetVisibilitySignature(level, seg);
+                if (signature == _signatures[i]) continue;
+
+                _signatures[i] = signature;
+                changed = true;
+                touch(SegID(i));
+
+                for (auto& conn : seg.Connections)
+                    if (level.SegmentExists(conn)) touch(conn);
+            }
+
+            if (!changed) return;
+
+            List<SegID> rows;
+            for (size_t i = 0; i < _segments; i++) {
+                auto row = GetRow(SegID(i));
+                bool affected = (touched[i / 64] >> (i % 64)) & 1;
+
+                for (size_t w = 0; w < _rowWords && !affected; w++)
+                    affected = row[w] & touched[w];
+
+                if (affected) rows.push_back(SegID(i));
+            }
+
+            BuildRows(level, rows);
+        }
+
+        _stats.BuildTime = elapsed;
+        UpdateStats();
+        SPDLOG_INFO("Rebuilt {} of {} visibility rows in {:.3f} ms", _stats.RowsBuilt, _stats.Segments, _stats.BuildTime / 1000.0f);
+    }
+
+    void SegmentVisibility::Clear() {
+        _bits.clear();
+        _signatures.clear();
+        _segments = _rowWords = 0;
+        _stats = {};
+    }
+
+    List<SegID> SegmentVisibility::GetVisible(SegID from) const {
+        List<SegID> visible;
+        ForEachVisible(from, [&visible](SegID id) { visible.push_back(id); });
+        return visible;
+    }
+
+    int SegmentVisibility::CountVisible(SegID from) const {
+        if ((size_t)from >= _segments) return 0;
+
+        int count = 0;
+        for (auto word : GetRow(from))
+            count += std::popcount(word);
+
+        return count;
+    }
+
+    void SegmentVisibility::UpdateStats() {
+        _stats.Segments = (int)_segments;
+        _stats.Bytes = _bits.size() * sizeof(uint64) + _signatures.size() * sizeof(uint64);
+        _stats.VisiblePairs = 0;
+
+        for (auto word : _bits)
+            _stats.VisiblePairs += std::popcount(word);
+    }
+}
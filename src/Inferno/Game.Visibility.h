@@ -0,0 +1,82 @@
+#pragma once
+
+#include <bit>
+#include "Level.h"
+
+namespace Inferno {
+    // Potentially visible sets between segments, built by tracing the portal graph.
+    // A segment is potentially visible from a source if a line can pass through every portal leading to it.
+    // Portals are clipped to the separating planes between the source portal and the last portal passed.
+    // Stored as one bit row per segment.
+    class SegmentVisibility {
+        List<uint64> _bits; // Row-major bit matrix, _rowWords words per segment
+        List<uint64> _signatures; // Per segment hash of the state that affects visibility
+        size_t _segments = 0;
+        size_t _rowWords = 0;
+
+    public:
+        struct Stats {
+            int Segments = 0;
+            size_t Bytes = 0; // Memory used by the bit matrix
+            int RowsBuilt = 0; // Rows rebuilt by the last Build or Update
+            int FallbackRows = 0; // Rows that ran out of portal steps and used the coarse flood instead
+            int64 VisiblePairs = 0;
+            int64 BuildTime = 0; // Microseconds for the last Build or Update
+        };
+
+        // Rebuilds visibility for all segments
+        void Build(const Level& level);
+
+        // Rebuilds rows affected by segments that changed since the last build.
+        // Falls back to a full build if segments were added or removed.
+        void Update(const Level& level);
+
+        void Clear();
+
+        bool IsVisible(SegID from, SegID to) const {
+            if ((size_t)from >= _segments || (size_t)to >= _segments) return false;
+            auto word = _bits[(size_t)from * _rowWords + (size_t)to / 64];
+            return word & (1ull << ((size_t)to % 64));
+        }
+
+        // Calls fn(SegID) for each segment visible from the source
+        void ForEachVisible(SegID from, auto&& fn) const {
+            if ((size_t)from >= _segments) return;
+            auto row = GetRow(from);
+
+            for (size_t w = 0; w < row.size(); w++) {
+                auto word = row[w];
+                while (word) {
+                    auto bit = std::countr_zero(word);
+                    fn(SegID(w * 64 + bit));
+                    word &= word - 1; // clear lowest bit
+                }
+            }
+        }
+
+        List<SegID> GetVisible(SegID from) const;
+        int CountVisible(SegID from) const;
+
+        const Stats& GetStats() const { return _stats; }
+        bool Empty() const { return _segments == 0; }
+
+    private:
+        Stats _stats;
+
+        span<const uint64> GetRow(SegID seg) const {
+            return { &_bits[(size_t)seg * _rowWords], _rowWords };
+        }
+
+        span<uint64> GetRow(SegID seg) {
+            return { &_bits[(size_t)seg * _rowWords], _rowWords };
+        }
+
+        void BuildRows(const Level& level, span<const SegID> rows);
+        void UpdateStats();
+    };
+
+    namespace Game {
+        // Visibility for the loaded level
+        inline SegmentVisibility Visibility;
+    }
+}
@@ -3,6 +3,8 @@
 #include "SoundSystem.h"
 #include "Physics.h"
 #include "Face.h"
+#include "Game.Navigation.h"
+#include "Game.h"
 
 namespace Inferno {
  //template<class TData, class TKey = int>
@@ -49,13 +51,17 @@ namespace Inferno {
  //};
 
     constexpr float DOOR_WAIT_TIME = 5;
+    constexpr float DOOR_BLOCKED_RETRY_TIME = 0.1f; // Delay before trying to close a blocked door again
 
-    ActiveDoor* FindDoor(Level& level, WallID id) {
-        for (auto& door : level.ActiveDoors) {
-            if (door.Front == id || door.Back == id) return &door;
+    PoolHandle FindDoor(Level& level, WallID id) {
+        auto& doors = level.ActiveDoors;
+
+        for (size_t i = 0; i < doors.Size(); i++) {
+            auto& door = *(doors.begin() + i);
+            if (door.Front == id || door.Back == id) return doors.GetHandle(i);
         }
 
-        return nullptr;
+        return {};
     }
 
     void SetWallTMap(SegmentSide& side1, SegmentSide& side2, const WallClip& clip, int frame) {
@@ -74,21 +80,47 @@ namespace Inferno {
             side1.TMap2 = side2.TMap2 = tmap;
         }
 
-        if (changed) Editor::Events::LevelChanged();
+        if (changed && !Game::Headless) Editor::Events::LevelChanged();
+    }
+
+    void ScheduleDoor(Level& level, PoolHandle handle, ActiveDoor& door, float delay, WallEventType type) {
+        door.Event = level.WallEvents.Schedule(delay, type, handle);
+    }
+
+    // Schedules the next frame change of an animating door
+    void ScheduleNextFrame(Level& level, PoolHandle handle, ActiveDoor& door) {
+        auto frameTime = door.Clip->PlayTime / door.Clip->NumFrames;
+        auto next = (std::floor(door.Time / frameTime) + 1) * frameTime;
+        ScheduleDoor(level, handle, door, next - door.Time, WallEventType::DoorFrame);
     }
 
-    void DoOpenDoor(Level& level, ActiveDoor& door, float dt) {
+    bool DoorIsBlocked(Level& level, const Wall& wall, const ActiveDoor& door) {
+        auto face = Face::FromSide(level, wall.Tag);
+        bool blocked = false;
+
+        auto checkObject = [&](ObjID, const Object& obj) {
+            if (blocked || !Object::IsAlive(obj)) return;
+            DirectX::BoundingSphere sphere(obj.Position, obj.Radius);
+            if (IntersectFaceSphere(face, sphere))
+                blocked = true;
+        };
+
+        level.ForEachObjectInSegment(wall.Tag.Segment, checkObject);
+        level.ForEachObjectInSegment(door.Connection.Segment, checkObject);
+        return blocked;
+    }
+
+    void DoOpenDoor(Level& level, PoolHandle handle, ActiveDoor& door) {
         auto& wall = level.GetWall(door.Front);
-        auto conn = level.GetConnectedSide(wall.Tag);
         auto& side = level.GetSide(wall.Tag);
-        auto& cside = level.GetSide(conn);
-        auto& cwall = level.GetWall(cside.Wall);
+        auto& cside = level.GetSide(door.Connection);
+        auto back = level.TryGetWall(door.Back);
 
         // todo: remove objects stuck on door
 
-        door.Time += dt;
+        door.Time = float(level.WallEvents.Time() - door.Start);
 
-        auto& clip = Resources::GetWallClip(wall.Clip);
+        auto& clip = *door.Clip;
         auto frameTime = clip.PlayTime / clip.NumFrames;
         auto i = int(door.Time / frameTime);
 
@@ -96,9 +128,10 @@ namespace Inferno {
             SetWallTMap(side, cside, clip, i);
         }
 
-        if (i > clip.NumFrames / 2) { // half way open
+        if (i > clip.NumFrames / 2 && !wall.HasFlag(WallFlag::DoorOpened)) { // half way open
             wall.SetFlag(WallFlag::DoorOpened);
-            cwall.SetFlag(WallFlag::DoorOpened);
+            if (back) back->SetFlag(WallFlag::DoorOpened);
+            Game::Navigation.OnWallChanged(level, wall.Tag);
         }
 
         if (i >= clip.NumFrames - 1) {
@@ -110,62 +143,73 @@ namespace Inferno {
             else {
                 fmt::print("Waiting door\n");
                 wall.State = WallState::DoorWaiting;
-                cwall.State = WallState::DoorWaiting;
+                if (back) back->State = WallState::DoorWaiting;
                 door.Time = 0;
+                ScheduleDoor(level, handle, door, DOOR_WAIT_TIME, WallEventType::DoorClose);
             }
         }
+        else {
+            ScheduleNextFrame(level, handle, door);
+        }
     }
 
-    void DoCloseDoor(Level& level, ActiveDoor& door, float dt) {
+    // Starts closing a door that finished waiting
+    void StartClosingDoor(Level& level, PoolHandle handle, ActiveDoor& door) {
         auto& wall = level.GetWall(door.Front);
 
-        auto front = level.TryGetWall(door.Front);
-        auto back = level.TryGetWall(door.Back);
+        if (wall.HasFlag(WallFlag::DoorAuto) && DoorIsBlocked(level, wall, door)) {
+            ScheduleDoor(level, handle, door, DOOR_BLOCKED_RETRY_TIME, WallEventType::DoorClose);
+            return; // object blocking doorway!
+        }
 
-        auto conn = level.GetConnectedSide(wall.Tag);
+        fmt::print("Closing door\n");
         auto& side = level.GetSide(wall.Tag);
-        auto& cside = level.GetSide(conn);
-
-        if (wall.HasFlag(WallFlag::DoorAuto)) {
-            for (auto& obj : level.Objects | views::filter(Object::IsAlive)) {
-                if (obj.Segment == wall.Tag.Segment || obj.Segment == conn.Segment) {
-                    DirectX::BoundingSphere sphere(obj.Position, obj.Radius);
-                    auto face = Face::FromSide(level, wall.Tag);
-                    if (IntersectFaceSphere(face, sphere))
-                        return; // object blocking doorway!
-                }
-            }
-        }
+        Sound::Sound3D sound(side.Center, wall.Tag.Segment);
+        sound.Resource = Resources::GetSoundResource(door.Clip->CloseSound);
+        Sound::Play(sound);
+
+        wall.State = WallState::DoorClosing;
+        if (auto back = level.TryGetWall(door.Back)) back->State = WallState::DoorClosing;
+        door.Time = 0;
+        door.Start = level.WallEvents.Time();
+        ScheduleDoor(level, handle, door, 0, WallEventType::DoorFrame);
+    }
 
-        auto& clip = Resources::GetWallClip(wall.Clip);
+    void DoCloseDoor(Level& level, PoolHandle handle, ActiveDoor& door) {
+        auto& wall = level.GetWall(door.Front);
+        auto back = level.TryGetWall(door.Back);
 
-        if (door.Time == 0) { // play sound at start of closing
-            //auto sound = Resources::GetSoundIndex(clip.CloseSound);
-            Sound::Sound3D sound(side.Center, wall.Tag.Segment);
-            sound.Resource = Resources::GetSoundResource(clip.CloseSound);
-            Sound::Play(sound);
+        if (wall.HasFlag(WallFlag::DoorAuto) && DoorIsBlocked(level, wall, door)) {
+            // Pause the animation until the doorway is clear
+            door.Start += DOOR_BLOCKED_RETRY_TIME;
+            ScheduleDoor(level, handle, door, DOOR_BLOCKED_RETRY_TIME, WallEventType::DoorFrame);
+            return;
         }
 
-        door.Time += dt;
+        auto& side = level.GetSide(wall.Tag);
+        auto& cside = level.GetSide(door.Connection);
+        auto& clip = *door.Clip;
+
+        door.Time = float(level.WallEvents.Time() - door.Start);
         auto frameTime = clip.PlayTime / clip.NumFrames;
         auto i = int(clip.NumFrames - door.Time / frameTime - 1);
 
-        if (i < clip.NumFrames / 2) { // Half way closed
-            front->ClearFlag(WallFlag::DoorOpened);
+        if (i < clip.NumFrames / 2 && wall.HasFlag(WallFlag::DoorOpened)) { // Half way closed
+            wall.ClearFlag(WallFlag::DoorOpened);
             if (back) back->ClearFlag(WallFlag::DoorOpened);
+            Game::Navigation.OnWallChanged(level, wall.Tag);
         }
 
         if (i > 0) {
             SetWallTMap(side, cside, clip, i);
-            front->State = WallState::DoorClosing;
-            if (back) back->State = WallState::DoorClosing;
-            //door.Time = 0;
+            ScheduleNextFrame(level, handle, door);
         }
         else {
             // CloseDoor()
-            front->State = WallState::Closed;
+            wall.State = WallState::Closed;
             if (back) back->State = WallState::Closed;
             SetWallTMap(side, cside, clip, 0);
+            door.Time = -1; // closed, free the door slot
         }
     }
 
@@ -186,29 +230,36 @@ namespace Inferno {
 
         fmt::print("Opening door {}:{}\n", tag.Segment, tag.Side);
 
-        ActiveDoor* door = nullptr;
         auto& clip = Resources::GetWallClip(wall->Clip);
+        auto now = level.WallEvents.Time();
+        PoolHandle handle;
+        ActiveDoor* door = nullptr;
 
         if (wall->State != WallState::Closed) {
-            // Reuse door
-            door = FindDoor(level, side.Wall);
+            // Reuse door, continuing from how far it had closed
+            handle = FindDoor(level, side.Wall);
+            door = level.ActiveDoors.TryGet(handle);
             if (door)
-                door->Time = std::max(clip.PlayTime - door->Time, 0.0f);
+                door->Start = now - std::max(clip.PlayTime - float(now - door->Start), 0.0f);
         }
 
         if (!door) {
-            door = &level.ActiveDoors.Alloc();
+            door = &level.ActiveDoors.Alloc(&handle);
             door->Time = 0;
+            door->Start = now;
         }
 
         wall->State = WallState::DoorOpening;
         door->Front = side.Wall;
+        door->Connection = conn;
+        door->Clip = &clip;
 
         if (cwall) {
             door->Back = cwallId;
             cwall->State = cwall->State = WallState::DoorOpening;
         }
 
+        ScheduleDoor(level, handle, *door, 0, WallEventType::DoorFrame);
 
         if (clip.OpenSound != SoundID::None) {
             Sound::Sound3D sound(side.Center, tag.Segment);
@@ -235,24 +286,29 @@ namespace Inferno {
 
 
     void UpdateDoors(Level& level, float dt) {
-        for (auto& door : level.ActiveDoors) {
-            auto wall = level.TryGetWall(door.Front);
+        auto& events = level.WallEvents;
+        events.Advance(dt);
+
+        WallEvent e;
+        while (events.PopDue(e)) {
+            auto door = level.ActiveDoors.TryGet(e.Door);
+            if (!door || door->Event != e.Sequence || !ActiveDoor::IsAlive(*door))
+                continue; // door was freed or rescheduled
+
+            auto wall = level.TryGetWall(door->Front);
             if (!wall) continue;
 
-            if (wall->State == WallState::DoorOpening) {
-                DoOpenDoor(level, door, dt);
+            if (e.Type == WallEventType::DoorClose) {
+                StartClosingDoor(level, e.Door, *door);
             }
-            else if (wall->State == WallState::DoorClosing) {
-                DoCloseDoor(level, door, dt);
+            else if (wall->State == WallState::DoorOpening) {
+                DoOpenDoor(level, e.Door, *door);
             }
-            else if (wall->State == WallState::DoorWaiting) {
-                door.Time += dt;
-                if (door.Time > DOOR_WAIT_TIME) {
-                    fmt::print("Closing door\n");
-                    wall->State = WallState::DoorClosing;
-                    door.Time = 0;
-                }
+            else if (wall->State == WallState::DoorClosing) {
+                DoCloseDoor(level, e.Door, *door);
             }
         }
+
+        level.ActiveDoors.Prune(); // Free doors that finished
     }
 }
@@ -5,6 +5,11 @@
 #include "Resources.h"
 #include "Editor/Editor.h"
 #include "SoundSystem.h"
+#include "Game.Visibility.h"
+#include "Game.CollisionMesh.h"
+#include "Game.Broadphase.h"
+#include "Game.Navigation.h"
+#include "Game.AI.h"
 
 namespace Inferno::Game {
     void LoadLevel(Inferno::Level&& level) {
@@ -20,9 +25,18 @@ namespace Inferno::Game {
                 !String::InvariantEquals(level.Palette, Level.Palette);
 
             IsLoading = true;
+            Editor::CancelLightJob(); // The light worker reads level resources
 
             Level = std::move(level); // Move to global so resource loading works properly
             Resources::LoadLevel(Level);
+            Level.RebuildObjectLists();
+            Visibility.Build(Level);
+            SPDLOG_INFO("Built segment visibility in {:.3f} ms using {} KB",
+                        Visibility.GetStats().BuildTime / 1000.0f, Visibility.GetStats().Bytes / 1024);
+            CollisionMesh.Build(Level);
+            Broadphase.Clear();
+            Navigation.Build(Level);
+            AI.Clear();
 
             if (forceReload || Resources::HasCustomTextures()) // Check for custom textures before or after load
                 Render::Materials->Unload();
@@ -29,4 +29,7 @@ namespace Inferno::Game {
 
     // Game time elapsed in seconds
     inline double ElapsedTime = 0;
+
+    // Set while simulating without rendering, such as during a replay. Skips sounds and visual effects.
+    inline bool Headless = false;
 }
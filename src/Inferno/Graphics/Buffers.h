@@ -60,6 +60,11 @@ namespace Inferno {
 
         void ResetIndex() { _index = 0; }
 
+        // CPU address of data packed into the buffer, for updating it in place
+        void* GetMappedData(D3D12_GPU_VIRTUAL_ADDRESS address) {
+            return (byte*)_resource.Memory() + (address - _resource.GpuAddress());
+        }
+
         // Aligns offset to a stride
         constexpr uint Stride(uint offset, uint stride) {
             return (offset + stride - 1) / stride * stride;
@@ -0,0 +1,401 @@
+#include "pch.h"
+#include "LevelGeometry.h"
+#include "Face.h"
+#include "Resources.h"
+#include "ScopedTimer.h"
+#include "Utility.h"
+
+namespace Inferno {
+    using namespace DirectX;
+
+    Vector2 GetOverlayRotation(SegmentSide& side, Vector2 uv) {
+        float overlayAngle = [&side]() {
+            switch (side.OverlayRotation) {
+                case OverlayRotation::Rotate0: default: return 0.0f;
+                case OverlayRotation::Rotate90: return XM_PIDIV2;
+                case OverlayRotation::Rotate180: return XM_PI;
+                case OverlayRotation::Rotate270: return XM_PI * 1.5f;
+            };
+        }();
+
+        return Vector2::Transform(uv, Matrix::CreateRotationZ(overlayAngle));
+    }
+
+    LevelVertex CreateLevelVertex(const Vector3& pos, const Vector2& uv, const Color& light, SegmentSide& side) {
+        // todo: pick normal 0 or 1 based on side split type
+        auto& normal = side.AverageNormal;
+        Vector2 uv2 = side.HasOverlay() ? GetOverlayRotation(side, uv) : Vector2();
+        return { pos, uv, light, uv2, normal };
+    }
+
+    void AddPolygon(Array<Vector3, 4>& verts,
+                    Array<Vector2, 4>& uv,
+                    Array<Color, 4>& lt,
+                    LevelGeometry& geo,
+                    LevelChunk& chunk,
+                    SegmentSide& side) {
+        auto startIndex = geo.Vertices.size();
+        chunk.AddQuad((uint16)startIndex, side);
+
+        // create vertices for this face
+        for (int i = 0; i < 4; i++) {
+            chunk.Center += verts[i];
+            geo.Vertices.push_back(CreateLevelVertex(verts[i], uv[i], lt[i], side));
+        }
+
+        chunk.Center /= 4;
+    }
+
+    void Tessellate(Array<Vector3, 4>& verts,
+                    LevelGeometry& geo,
+                    LevelChunk& chunk,
+                    SegmentSide& side,
+                    int steps) {
+        auto incr = 1 / ((float)steps + 1);
+        auto vTop = (verts[1] - verts[0]) * incr; // top
+        auto vBottom = (verts[2] - verts[3]) * incr; // bottom
+
+        auto uvTop = (side.UVs[1] - side.UVs[0]) * incr; // top
+        auto uvBottom = (side.UVs[2] - side.UVs[3]) * incr; // bottom
+
+        auto ltTop = (side.Light[1] - side.Light[0]) * incr; // top
+        auto ltBottom = (side.Light[2] - side.Light[3]) * incr; // bottom
+
+        // 1 step: 4 quads
+        // 2 step: 9 quads
+        // 3 step: 16 quads
+        for (int x = 0; x < steps + 1; x++) {
+            for (int y = 0; y < steps + 1; y++) {
+                auto fx = (float)x, fy = (float)y;
+                Array<Vector3, 4> p;
+                auto edge0a = verts[0] + vTop * fx; // top left edge
+                auto edge0b = verts[0] + vTop * (fx + 1); // top right edge
+                auto edge1a = verts[3] + vBottom * fx; // bottom left edge
+                auto edge1b = verts[3] + vBottom * (fx + 1); // bottom right edge
+                auto vLeft = (edge1a - edge0a) * incr;
+                auto vRight = (edge1b - edge0b) * incr;
+
+                p[0] = edge0a + vLeft * fy; // top left
+                p[1] = edge0b + vRight * fy; // top right
+                p[2] = edge0b + vRight * (fy + 1); // bottom right
+                p[3] = edge0a + vLeft * (fy + 1); // bottom left
+
+                Array<Vector2, 4> uv;
+                auto uvEdge0a = side.UVs[0] + uvTop * fx; // top left edge
+                auto uvEdge0b = side.UVs[0] + uvTop * (fx + 1); // top right edge
+                auto uvEdge1a = side.UVs[3] + uvBottom * fx; // bottom left edge
+                auto uvEdge1b = side.UVs[3] + uvBottom * (fx + 1); // bottom right edge
+                auto uvLeft = (uvEdge1a - uvEdge0a) * incr;
+                auto uvRight = (uvEdge1b - uvEdge0b) * incr;
+
+                uv[0] = uvEdge0a + uvLeft * fy; // top left
+                uv[1] = uvEdge0b + uvRight * fy; // top right
+                uv[2] = uvEdge0b + uvRight * (fy + 1); // bottom right
+                uv[3] = uvEdge0a + uvLeft * (fy + 1); // bottom left
+
+                Array<Color, 4> lt{};
+                auto ltEdge0a = side.Light[0] + ltTop * fx; // top left edge
+                auto ltEdge0b = side.Light[0] + ltTop * (fx + 1); // top right edge
+                auto ltEdge1a = side.Light[3] + ltBottom * fx; // bottom left edge
+                auto ltEdge1b = side.Light[3] + ltBottom * (fx + 1); // bottom right edge
+                auto ltLeft = (ltEdge1a - ltEdge0a) * incr;
+                auto ltRight = (ltEdge1b - ltEdge0b) * incr;
+
+                lt[0] = ltEdge0a + ltLeft * fy; // top left
+                lt[1] = ltEdge0b + ltRight * fy; // top right
+                lt[2] = ltEdge0b + ltRight * (fy + 1); // bottom right
+                lt[3] = ltEdge0a + ltLeft * (fy + 1); // bottom left
+
+                AddPolygon(p, uv, lt, geo, chunk, side);
+            }
+        }
+    }
+
+    BlendMode GetWallBlendMode(const Level& level, LevelTexID id) {
+        if (level.IsDescent2()) {
+            if (id == LevelTexID(353) ||
+                id == LevelTexID(420) ||
+                id == LevelTexID(432)) {
+                return BlendMode::Additive;
+            }
+        }
+        else if (level.IsDescent1()) {
+            // energy field
+            if (id == LevelTexID(328)) {
+                return BlendMode::Additive;
+            }
+        }
+
+        return BlendMode::Alpha;
+    }
+
+    namespace {
+        // How a rendered side is grouped into chunks
+        struct SideLayout {
+            const Wall* WallData = nullptr;
+            uint32 ChunkId = 0; // Texture ids and overlay rotation packed together
+            bool IsWall = false; // Walls get their own chunk for depth sorting
+            bool NeedsOverlaySlide = false;
+
+            bool IsCloaked() const { return IsWall && WallData && WallData->Type == WallType::Cloaked; }
+
+            // Sides with the same key share a chunk and chunk settings
+            uint64 Key() const { return ChunkId | (uint64)IsWall << 32 | (uint64)IsCloaked() << 33; }
+        };
+
+        // Returns nothing if the side isn't rendered
+        Option<SideLayout> GetSideLayout(const Level& level, const Segment& seg, SideID sideId) {
+            auto& side = seg.GetSide(sideId);
+            auto isWall = seg.SideIsWall(sideId);
+
+            // Do not render open sides
+            if (seg.SideHasConnection(sideId) && !isWall)
+                return {};
+
+            // Do not render the exit
+            if (seg.GetConnection(sideId) == SegID::Exit)
+                return {};
+
+            auto wall = level.TryGetWall(side.Wall);
+            WallType wallType = wall ? wall->Type : WallType::None;
+
+            // Do not render fly-through walls
+            if (isWall && wallType == WallType::FlyThroughTrigger)
+                return {};
+
+            if (wallType == WallType::WallTrigger)
+                isWall = false; // wall triggers aren't really walls for the purposes of rendering
+
+            // For sliding textures that have an overlay, we must store the overlay rotation sliding as well
+            auto& ti = Resources::GetLevelTextureInfo(side.TMap);
+            bool needsOverlaySlide = side.HasOverlay() && ti.Slide != Vector2::Zero;
+
+            // pack the map ids together into a single integer (15 bits, 15 bits, 2 bits);
+            uint16 overlayBit = needsOverlaySlide ? (uint16)side.OverlayRotation : 0;
+            uint32 chunkId = (uint16)side.TMap | (uint16)side.TMap2 << 15 | overlayBit << 30;
+
+            return SideLayout{ wall, chunkId, isWall, needsOverlaySlide };
+        }
+
+        Array<Color, 4> GetSideLight(const SegmentSide& side, const SideLayout& layout) {
+            Array<Color, 4> lt = side.Light;
+            if (layout.IsCloaked()) {
+                auto alpha = 1 - layout.WallData->CloakValue();
+                Seq::iter(lt, [alpha](auto& x) { x.A(alpha); });
+            }
+            return lt;
+        }
+    }
+
+    void CreateLevelGeometry(Level& level, ChunkCache& chunks, LevelGeometry& geo) {
+        chunks.clear();
+        geo.Chunks.clear();
+        geo.Vertices.clear();
+        geo.Walls.clear();
+        geo.Sides.assign(level.Segments.size() * 6, {});
+
+        for (int id = 0; id < level.Segments.size(); id++) {
+            auto& seg = level.Segments[id];
+            for (auto& sideId : SideIDs) {
+                auto layout = GetSideLayout(level, seg, sideId);
+                if (!layout) continue;
+
+                auto& side = seg.GetSide(sideId);
+                auto isWall = layout->IsWall;
+
+                LevelChunk wallChunk; // always use a new chunk for walls
+                LevelChunk& chunk = isWall ? wallChunk : chunks[layout->ChunkId];
+
+                chunk.TMap1 = side.TMap;
+                chunk.TMap2 = side.TMap2;
+                chunk.EffectClip1 = Resources::GetEffectClip(side.TMap);
+                chunk.ID = id;
+
+                if (side.HasOverlay())
+                    chunk.EffectClip2 = Resources::GetEffectClip(side.TMap2);
+
+                if (isWall && layout->WallData) {
+                    chunk.Blend = GetWallBlendMode(level, side.TMap);
+                    if (layout->IsCloaked()) {
+                        chunk.Blend = BlendMode::Alpha;
+                        chunk.Cloaked = true;
+                    }
+                }
+
+                auto lt = GetSideLight(side, *layout);
+                auto verts = Face::FromSide(level, seg, sideId).CopyPoints();
+
+                auto& sideMesh = geo.Sides[id * 6 + (int)sideId];
+                sideMesh.Vertex = (int32)geo.Vertices.size();
+                sideMesh.Index = (int32)chunk.Indices.size();
+                sideMesh.Chunk = isWall ? (int32)geo.Walls.size() : -1; // Static chunks are numbered once they are all known
+                sideMesh.Wall = isWall;
+                sideMesh.Key = layout->Key();
+                sideMesh.Alpha = lt[0].A();
+                AddPolygon(verts, side.UVs, lt, geo, chunk, side);
+
+                // Overlays should slide in the same direction as the base texture regardless of their rotation
+                if (layout->NeedsOverlaySlide) {
+                    auto& ti = Resources::GetLevelTextureInfo(side.TMap);
+                    chunk.OverlaySlide = GetOverlayRotation(side, ti.Slide);
+                }
+
+                if (isWall) {
+                    // Adjust wall positions to the center of the segment so objects and walls of a segment can be sorted correctly
+                    chunk.Center = seg.Center;
+                    geo.Walls.push_back(chunk);
+                }
+            }
+        }
+
+        Dictionary<uint32, int32> chunkIndices;
+        for (auto& [key, chunk] : chunks) {
+            chunkIndices[key] = (int32)geo.Chunks.size();
+            geo.Chunks.push_back(chunk);
+        }
+
+        for (auto& sideMesh : geo.Sides) {
+            if (sideMesh.Vertex >= 0 && !sideMesh.Wall)
+                sideMesh.Chunk = chunkIndices[(uint32)sideMesh.Key];
+        }
+    }
+
+    bool UpdateLevelGeometry(Level& level, LevelGeometry& geo, span<const SegID> segments) {
+        if (geo.Sides.size() != level.Segments.size() * 6) return false;
+
+        // Sides that appeared, disappeared or changed chunk need the chunks to be regrouped
+        for (auto segId : segments) {
+            auto& seg = level.GetSegment(segId);
+            for (auto& sideId : SideIDs) {
+                auto& sideMesh = geo.Sides[(int)segId * 6 + (int)sideId];
+                auto layout = GetSideLayout(level, seg, sideId);
+                if (layout.has_value() != (sideMesh.Vertex >= 0)) return false;
+                if (layout && layout->Key() != sideMesh.Key) return false;
+            }
+        }
+
+        for (auto segId : segments) {
+            auto& seg = level.GetSegment(segId);
+            for (auto& sideId : SideIDs) {
+                auto& sideMesh = geo.Sides[(int)segId * 6 + (int)sideId];
+                if (sideMesh.Vertex < 0) continue;
+
+                auto& side = seg.GetSide(sideId);
+                auto lt = GetSideLight(side, *GetSideLayout(level, seg, sideId));
+                sideMesh.Alpha = lt[0].A();
+                auto verts = Face::FromSide(level, seg, sideId).CopyPoints();
+
+                for (int i = 0; i < 4; i++)
+                    geo.Vertices[sideMesh.Vertex + i] = CreateLevelVertex(verts[i], side.UVs[i], lt[i], side);
+
+                // The split of the side can change when its vertices move
+                auto& chunk = sideMesh.Wall ? geo.Walls[sideMesh.Chunk] : geo.Chunks[sideMesh.Chunk];
+                auto indices = side.GetRenderIndices();
+                for (int i = 0; i < 6; i++)
+                    chunk.Indices[sideMesh.Index + i] = uint16(sideMesh.Vertex + indices[i]);
+
+                if (sideMesh.Wall)
+                    chunk.Center = seg.Center;
+            }
+        }
+
+        return true;
+    }
+
+    uint64 GetGeometrySignature(const Level& level, const Segment& seg) {
+        uint64 hash = 0;
+
+        for (auto& index : seg.Indices) {
+            auto& v = level.Vertices[index];
+            HashCombine(hash, v.x);
+            HashCombine(hash, v.y);
+            HashCombine(hash, v.z);
+        }
+
+        for (auto& sideId : SideIDs) {
+            auto& side = seg.GetSide(sideId);
+            HashCombine(hash, (uint64)seg.GetConnection(sideId));
+            HashCombine(hash, (uint64)side.TMap);
+            HashCombine(hash, (uint64)side.TMap2);
+            HashCombine(hash, (uint64)side.OverlayRotation);
+            HashCombine(hash, (uint64)side.Type);
+
+            for (auto& uv : side.UVs) {
+                HashCombine(hash, uv.x);
+                HashCombine(hash, uv.y);
+            }
+
+            for (auto& light : side.Light) {
+                HashCombine(hash, light.x);
+                HashCombine(hash, light.y);
+                HashCombine(hash, light.z);
+            }
+
+            HashCombine(hash, (uint64)side.Wall);
+            if (auto wall = level.TryGetWall(side.Wall)) {
+                HashCombine(hash, (uint64)wall->Type);
+                HashCombine(hash, wall->CloakValue());
+            }
+        }
+
+        return hash;
+    }
+
+    LevelMeshBenchmark RunLevelMeshBenchmark(const Level& source, int drags) {
+        LevelMeshBenchmark result{ .Segments = (int)source.Segments.size(), .Drags = drags };
+        if (source.Segments.empty() || source.Vertices.empty()) return result;
+
+        auto level = source;
+        ChunkCache chunks, fullChunks;
+        LevelGeometry geo, full;
+        CreateLevelGeometry(level, chunks, geo);
+
+        List<uint64> signatures(level.Segments.size());
+        for (int id = 0; id < level.Segments.size(); id++)
+            signatures[id] = GetGeometrySignature(level, level.Segments[id]);
+
+        List<SegID> changed;
+
+        for (int drag = 0; drag < drags; drag++) {
+            // Nudge a vertex and update the segments using it, as the editor does while dragging
+            auto index = (PointID)(Random() * (level.Vertices.size() - 1));
+            level.Vertices[index] += Vector3(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f);
+
+            for (auto& seg : level.Segments) {
+                if (Seq::contains(seg.Indices, index))
+                    seg.UpdateGeometricProps(level);
+            }
+
+            {
+                ScopedTimer timer(&result.IncrementalTime);
+                changed.clear();
+                for (int id = 0; id < level.Segments.size(); id++) {
+                    auto signature = GetGeometrySignature(level, level.Segments[id]);
+                    if (signature != signatures[id]) {
+                        signatures[id] = signature;
+                        changed.push_back(SegID(id));
+                    }
+                }
+
+                result.SegmentsUpdated += (int)changed.size();
+                if (!UpdateLevelGeometry(level, geo, changed)) {
+                    CreateLevelGeometry(level, chunks, geo);
+                    result.Rebuilds++;
+                }
+            }
+
+            {
+                ScopedTimer timer(&result.FullTime);
+                CreateLevelGeometry(level, fullChunks, full);
+            }
+        }
+
+        result.Matches = geo.Vertices.size() == full.Vertices.size() &&
+            std::memcmp(geo.Vertices.data(), full.Vertices.data(), geo.Vertices.size() * sizeof(LevelVertex)) == 0;
+
+        if (!result.Matches)
+            SPDLOG_WARN("Patched level geometry doesn't match a full rebuild");
+
+        return result;
+    }
+}
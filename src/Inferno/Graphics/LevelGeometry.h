@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Level.h"
+#include "VertexTypes.h"
+#include "LevelSideMesh.h"
+
+namespace Inferno {
+    // A chunk of level geometry grouped by texture maps
+    struct LevelChunk {
+        List<uint16> Indices; // Indices into the LevelGeometry buffer (NOT level vertices)
+        LevelTexID TMap1, TMap2;
+        uint ID = 0;
+        EClipID EffectClip1 = EClipID::None;
+        EClipID EffectClip2 = EClipID::None;
+        Vector2 OverlaySlide; // UV sliding corrected for overlay rotation
+
+        // Geometric center, used for wall depth sorting
+        Vector3 Center;
+        BlendMode Blend = BlendMode::Opaque;
+        bool Cloaked = false;
+
+        void AddQuad(uint16 index, const SegmentSide& side) {
+            for (auto i : side.GetRenderIndices())
+                Indices.push_back(index + i);
+        }
+    };
+
+    struct HeatVolume {
+        List<uint16> Indices;
+        List<FlatVertex> Vertices;
+    };
+
+    struct LevelGeometry {
+        // Static meshes
+        List<LevelChunk> Chunks;
+        // 'Wall' meshes that require depth sorting
+        List<LevelChunk> Walls;
+        // Technically vertices are no longer needed after being uploaded
+        List<LevelVertex> Vertices;
+        // Indexed by segment * 6 + side
+        List<LevelSideMesh> Sides;
+        HeatVolume HeatVolumes;
+    };
+
+    using ChunkCache = Dictionary<uint32, LevelChunk>;
+
+    void CreateLevelGeometry(Level& level, ChunkCache& chunks, LevelGeometry& geo);
+
+    // Rewrites the vertices and indices of the sides of each segment in place.
+    // Returns false without changing anything if a side was added, removed or moved to another chunk, which requires CreateLevelGeometry().
+    bool UpdateLevelGeometry(Level& level, LevelGeometry& geo, span<const SegID> segments);
+
+    // Hashes the segment state that affects its geometry, to find segments that changed since the last update
+    uint64 GetGeometrySignature(const Level& level, const Segment& seg);
+
+    struct LevelMeshBenchmark {
+        int Segments = 0;
+        int Drags = 0;
+        int SegmentsUpdated = 0; // Segments patched across all drags
+        int Rebuilds = 0; // Drags that fell back to a full rebuild
+        bool Matches = true; // Patched geometry matched a full rebuild
+        int64 FullTime = 0; // Microseconds spent rebuilding the geometry after every drag
+        int64 IncrementalTime = 0; // Microseconds spent finding changed segments and patching them
+    };
+
+    // Drags random vertices of a copy of the level like the editor does, comparing a full rebuild against patching changed segments
+    LevelMeshBenchmark RunLevelMeshBenchmark(const Level& level, int drags);
+}
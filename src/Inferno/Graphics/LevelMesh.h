@@ -1,48 +1,10 @@
 #pragma once
 
-#include <array>
 #include "Buffers.h"
 #include "ShaderLibrary.h"
-#include "Face.h"
+#include "LevelGeometry.h"
 
 namespace Inferno {
-    // A chunk of level geometry grouped by texture maps
-    struct LevelChunk {
-        List<uint16> Indices; // Indices into the LevelGeometry buffer (NOT level vertices)
-        LevelTexID TMap1, TMap2;
-        uint ID = 0;
-        EClipID EffectClip1 = EClipID::None;
-        EClipID EffectClip2 = EClipID::None;
-        Vector2 OverlaySlide; // UV sliding corrected for overlay rotation
-
-        // Geometric center, used for wall depth sorting
-        Vector3 Center;
-        BlendMode Blend = BlendMode::Opaque;
-        bool Cloaked = false;
-
-        void AddQuad(uint16 index, const SegmentSide& side) {
-            for (auto i : side.GetRenderIndices())
-                Indices.push_back(index + i);
-        }
-    };
-
-    struct HeatVolume {
-        List<uint16> Indices;
-        List<FlatVertex> Vertices;
-    };
-
-    struct LevelGeometry {
-        // Static meshes
-        List<LevelChunk> Chunks;
-        // 'Wall' meshes that require depth sorting
-        List<LevelChunk> Walls;
-        // Technically vertices are no longer needed after being uploaded
-        List<LevelVertex> Vertices;
-        HeatVolume HeatVolumes;
-    };
-
-    using ChunkCache = Dictionary<uint32, LevelChunk>;
-
     struct LevelMesh {
         D3D12_VERTEX_BUFFER_VIEW VertexBuffer;
         D3D12_INDEX_BUFFER_VIEW IndexBuffer;
@@ -101,20 +63,57 @@ namespace Inferno {
 
 
     class LevelMeshBuilder {
+        // Geometry uploaded for one frame in flight. The GPU can still be drawing a frame after the
+        // CPU moves on, so patches are only written to a frame's buffer when it comes around again.
+        struct FrameMeshes {
+            PackedBuffer* Buffer = nullptr;
+            List<LevelMesh> Meshes;
+            List<LevelMesh> WallMeshes;
+            LevelVertex* MappedVertices = nullptr; // Uploaded vertices
+            List<uint16*> MappedIndices, MappedWallIndices; // Uploaded indices of each chunk
+            List<int> PendingSides; // Sides patched since the buffer was written, indexed like LevelGeometry::Sides
+        };
+
         int _lastSegCount = 0, _lastVertexCount = 0, _lastWallCount = 0;
 
         LevelGeometry _geometry;
-        List<LevelMesh> _meshes;
-        List<LevelMesh> _wallMeshes;
         ChunkCache _chunks;
+        List<FrameMeshes> _frames;
+        uint _frame = 0; // Frame being recorded
+        List<VertexLightUpdate> _lightUpdates;
+        List<uint64> _signatures, _nextSignatures; // Per segment
+        List<SegID> _changed;
     public:
-        List<LevelMesh>& GetMeshes() { return _meshes; }
-        List<LevelMesh>& GetWallMeshes() { return _wallMeshes; }
+        struct Stats {
+            int SegmentsUpdated = 0; // Segments patched by the last update
+            int Rebuilds = 0; // Full updates
+            int64 UpdateTime = 0; // Microseconds for the last update
+        };
+
+        span<LevelMesh> GetMeshes() { return _frames.empty() ? span<LevelMesh>() : _frames[_frame].Meshes; }
+        span<LevelMesh> GetWallMeshes() { return _frames.empty() ? span<LevelMesh>() : _frames[_frame].WallMeshes; }
+
+        // Rebuilds the geometry and uploads it to the buffer of every frame. The GPU must be idle.
+        void Update(Level& level, span<Ptr<PackedBuffer>> buffers);
 
-        void Update(Level& level, PackedBuffer& buffer);
+        // Updates the light of changed sides without rebuilding the geometry.
+        // Returns the number of vertices updated.
+        int UpdateLights(const Level& level, span<const Tag> sides);
 
+        // Patches the segments that changed since the last update.
+        // Returns false if a full update is needed, either because sides were added, removed or retextured or because nothing in the level changed.
+        bool UpdateChanged(Level& level);
+
+        // Writes the patches the frame's buffer hasn't received yet and draws the frame from it.
+        // Call after waiting on the frame's fence, otherwise the GPU may still be reading the buffer.
+        void BeginFrame(uint frameIndex);
+
+        const Stats& GetStats() const { return _stats; }
 
     private:
-        void UpdateBuffers(PackedBuffer& buffer);
+        Stats _stats;
+
+        void UpdateBuffers(FrameMeshes& frame);
+        void QueuePatch(int side);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,20 @@
+#include "pch.h"
+#include "LevelSideMesh.h"
+
+namespace Inferno {
+    void GetVertexLightUpdates(const Level& level, span<const LevelSideMesh> sideMeshes, span<const Tag> sides, List<VertexLightUpdate>& updates) {
+        updates.clear();
+
+        for (auto& tag : sides) {
+            auto sideMesh = GetSideMesh(sideMeshes, tag);
+            if (!sideMesh || sideMesh->Vertex < 0 || !level.SegmentExists(tag)) continue;
+
+            auto& side = level.GetSegment(tag).GetSide(tag.Side);
+            for (int i = 0; i < 4; i++) {
+                Color light = side.Light[i];
+                light.A(sideMesh->Alpha);
+                updates.push_back({ uint32(sideMesh->Vertex + i), light });
+            }
+        }
+    }
+}
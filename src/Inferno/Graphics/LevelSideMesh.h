@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Level.h"
+
+namespace Inferno {
+    // Where a side is stored in the level geometry
+    struct LevelSideMesh {
+        int32 Vertex = -1; // First of the side's four vertices. -1 if the side isn't rendered.
+        int32 Chunk = -1; // Index into the chunks or walls
+        int32 Index = 0; // First of the side's six indices in the chunk
+        bool Wall = false;
+        uint64 Key = 0; // Chunk grouping of the side. Sides that change key need a rebuild.
+        float Alpha = 1; // Vertex alpha of the side. Less than one for cloaked walls.
+    };
+
+    // Side meshes are indexed by segment * 6 + side
+    inline const LevelSideMesh* GetSideMesh(span<const LevelSideMesh> sides, Tag tag) {
+        auto index = (size_t)tag.Segment * 6 + (size_t)tag.Side;
+        return index < sides.size() ? &sides[index] : nullptr;
+    }
+
+    // New light for a vertex of the level geometry
+    struct VertexLightUpdate {
+        uint32 Vertex;
+        Color Light;
+    };
+
+    // Collects the light of the rendered vertices on each side. Alpha is kept so cloaked walls stay transparent.
+    void GetVertexLightUpdates(const Level& level, span<const LevelSideMesh> sideMeshes, span<const Tag> sides, List<VertexLightUpdate>& updates);
+}
@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "ParticleSystem.h"
+#include "Resources.h"
+#include "ScopedTimer.h"
+
+namespace Inferno::Render {
+    using namespace DirectX;
+
+    TexID GetParticleFrame(const VClip& vclip, float life) {
+        auto elapsed = vclip.PlayTime - life;
+        auto frame = vclip.NumFrames - (int)std::floor(elapsed / vclip.FrameTime) % vclip.NumFrames - 1;
+        return vclip.Frames[frame];
+    }
+
+    void ParticleSystem::Add(const Particle& p) {
+        _position.push_back(p.Position);
+        _up.push_back(p.Up);
+        _color.push_back(p.Color);
+        _radius.push_back(p.Radius);
+        _rotation.push_back(p.Rotation);
+        _life.push_back(p.Life);
+        _clip.push_back(p.Clip);
+    }
+
+    void ParticleSystem::Update(float dt) {
+        _stats.UpdateTime = 0;
+        ScopedTimer timer(&_stats.UpdateTime);
+
+        auto life = _life.data();
+        auto count = _life.size();
+        auto delta = XMVectorReplicate(dt);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            auto v = XMLoadFloat4((XMFLOAT4*)&life[i]);
+            XMStoreFloat4((XMFLOAT4*)&life[i], XMVectorSubtract(v, delta));
+        }
+
+        for (; i < count; i++)
+            life[i] -= dt;
+
+        // Iterate in reverse so the particle moved into a gap was already checked
+        for (size_t j = count; j-- > 0;) {
+            if (_life[j] <= 0) Remove(j);
+        }
+
+        _stats.Particles = (int)_life.size();
+    }
+
+    void ParticleSystem::Remove(size_t index) {
+        auto swapRemove = [index](auto& list) {
+            list[index] = list.back();
+            list.pop_back();
+        };
+
+        swapRemove(_position);
+        swapRemove(_up);
+        swapRemove(_color);
+        swapRemove(_radius);
+        swapRemove(_rotation);
+        swapRemove(_life);
+        swapRemove(_clip);
+    }
+
+    void ParticleSystem::BuildBatches(const Vector3& cameraPosition, const Vector3& cameraUp) {
+        _stats.BuildTime = 0;
+        ScopedTimer timer(&_stats.BuildTime);
+
+        _order.clear();
+        _batches.clear();
+
+        for (int i = 0; i < _life.size(); i++) {
+            auto& vclip = Resources::GetVideoClip(_clip[i]);
+            if (vclip.NumFrames <= 0) continue;
+
+            _order.push_back({ GetParticleFrame(vclip, _life[i]), i });
+        }
+
+        std::ranges::sort(_order);
+        _vertices.resize(_order.size() * 4);
+
+        for (int n = 0; n < _order.size(); n++) {
+            auto [tid, i] = _order[n];
+
+            if (_batches.empty() || _batches.back().Texture != tid)
+                _batches.push_back({ .Texture = tid, .Start = n * 4 });
+
+            auto& position = _position[i];
+            auto transform = _up[i] == Vector3::Zero ?
+                Matrix::CreateBillboard(position, cameraPosition, cameraUp) :
+                Matrix::CreateConstrainedBillboard(position, cameraPosition, _up[i]);
+
+            if (_rotation[i] != 0)
+                transform = Matrix::CreateRotationZ(_rotation[i]) * transform;
+
+            auto& ti = Resources::GetTextureInfo(tid);
+            auto ratio = (float)ti.Height / (float)ti.Width;
+            auto h = _radius[i] * ratio;
+            auto w = _radius[i];
+            auto& color = _color[i];
+
+            auto v = &_vertices[n * 4];
+            v[0] = { Vector3::Transform({ -w, h, 0 }, transform), { 0, 0 }, color }; // bl
+            v[1] = { Vector3::Transform({ w, h, 0 }, transform), { 1, 0 }, color }; // br
+            v[2] = { Vector3::Transform({ w, -h, 0 }, transform), { 1, 1 }, color }; // tr
+            v[3] = { Vector3::Transform({ -w, -h, 0 }, transform), { 0, 1 }, color }; // tl
+            _batches.back().Count += 4;
+        }
+
+        _stats.Batches = (int)_batches.size();
+    }
+
+    void ParticleSystem::Clear() {
+        _position.clear();
+        _up.clear();
+        _color.clear();
+        _radius.clear();
+        _rotation.clear();
+        _life.clear();
+        _clip.clear();
+        _order.clear();
+        _vertices.clear();
+        _batches.clear();
+        _stats = {};
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Types.h"
+#include "EffectClip.h"
+
+namespace Inferno::Render {
+    struct Particle {
+        VClipID Clip = VClipID::None;
+        Vector3 Position;
+        Vector3 Up = Vector3::Zero;
+        Color Color = { 1, 1, 1 };
+        float Radius = 1;
+        float Rotation = 0;
+        float Life = 0;
+
+        static bool IsAlive(const Particle& p) { return p.Life > 0; }
+    };
+
+    struct ParticleVertex {
+        Vector3 Position;
+        Vector2 UV;
+        Color Color;
+    };
+
+    // Quads for every particle using the same texture. Four vertices per particle.
+    struct ParticleBatch {
+        TexID Texture = TexID::None;
+        int Start = 0; // First vertex
+        int Count = 0; // Vertices
+    };
+
+    // Particles stored as one array per attribute, so updating only touches lifetimes.
+    // Dead particles are replaced by the last one, keeping the arrays dense.
+    // Doesn't use the device, so it runs headless.
+    class ParticleSystem {
+        List<Vector3> _position, _up;
+        List<Color> _color;
+        List<float> _radius, _rotation, _life;
+        List<VClipID> _clip;
+
+        List<std::pair<TexID, int>> _order; // Texture of each particle, sorted to group batches
+        List<ParticleVertex> _vertices;
+        List<ParticleBatch> _batches;
+
+    public:
+        struct Stats {
+            int Particles = 0;
+            int Batches = 0;
+            int64 UpdateTime = 0; // Microseconds
+            int64 BuildTime = 0; // Microseconds to build the vertex stream
+        };
+
+        void Add(const Particle& particle);
+
+        // Ages every particle and removes the ones that expired
+        void Update(float dt);
+
+        // Builds camera facing quads for every particle grouped into one batch per texture
+        void BuildBatches(const Vector3& cameraPosition, const Vector3& cameraUp);
+
+        void Clear();
+
+        size_t Size() const { return _life.size(); }
+        float GetLife(size_t index) const { return _life[index]; }
+        span<const ParticleVertex> GetVertices() const { return _vertices; }
+        span<const ParticleBatch> GetBatches() const { return _batches; }
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        Stats _stats;
+        void Remove(size_t index);
+    };
+
+    // Frame of a clip that a particle shows once it has this much life left. Particles live for the play time of their clip.
+    TexID GetParticleFrame(const VClip& vclip, float life);
+}
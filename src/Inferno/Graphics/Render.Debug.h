@@ -57,6 +57,7 @@ namespace Inferno::Render::Metrics {
     inline int64 Debug;
     inline int64 DrawTransparent;
     inline int64 FindNearestLight;
+    inline int LightVertexUpdates; // Level vertices with new light this frame
 
     inline void BeginFrame() {
         Present = 0;
@@ -64,6 +65,7 @@ namespace Inferno::Render::Metrics {
         Debug = 0;
         DrawTransparent = 0;
         FindNearestLight = 0;
+        LightVertexUpdates = 0;
         QueueLevel = 0;
         ImGui = 0;
         ExecuteRenderCommands = 0;
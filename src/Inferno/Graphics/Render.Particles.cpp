@@ -1,14 +1,17 @@
 #include "pch.h"
 #include "Render.Particles.h"
-#include "DataPool.h"
 #include "Render.h"
+#include "Game.h"
 
 namespace Inferno::Render {
-    //using namespace DirectX;
+    using namespace DirectX;
 
-    DataPool<Particle> Particles(Particle::IsAlive, 100);
+    namespace {
+        ParticleSystem Particles;
+    }
 
     void AddParticle(Particle& p, bool randomRotation) {
+        if (Game::Headless) return;
         auto& vclip = Resources::GetVideoClip(p.Clip);
         p.Life = vclip.PlayTime;
         if (randomRotation)
@@ -18,54 +21,38 @@ namespace Inferno::Render {
     }
 
     void UpdateParticles(float dt) {
-        for (auto& p : Particles) {
-            if (!Particle::IsAlive(p)) continue;
-            p.Life -= dt;
-        }
+        Particles.Update(dt);
     }
 
     void DrawParticles(ID3D12GraphicsCommandList* cmd) {
-        //auto& effect = Effects->SpriteAdditive;
-        //effect.Apply(cmd);
-        //effect.Shader->SetWorldViewProjection(cmd, ViewProjection);
-        //auto sampler = Render::GetClampedTextureSampler();
-        //effect.Shader->SetSampler(cmd, sampler);
-
-        for (auto& p : Particles) {
-            if (!Particle::IsAlive(p)) continue;
-            auto& vclip = Resources::GetVideoClip(p.Clip);
-            auto elapsed = vclip.PlayTime - p.Life;
-
-            auto* up = p.Up == Vector3::Zero ? nullptr : &p.Up;
-            DrawVClip(cmd, vclip, p.Position, p.Radius, p.Color, elapsed, true, p.Rotation, up);
-
-            //auto frame = vclip.NumFrames - (int)(elapsed / vclip.FrameTime) % vclip.NumFrames - 1;
-            //auto tid = vclip.Frames[frame];
-            //auto billboard = Matrix::CreateRotationZ(p.Rotation) * Matrix::CreateBillboard(p.Position, Camera.Position, Camera.Up);
-
-            //// create quad and transform it
-            //auto& ti = Resources::GetTextureInfo(tid);
-            //auto ratio = (float)ti.Height / (float)ti.Width;
-            //const auto r = p.Radius;
-            //const auto h = r * ratio;
-            //const auto w = r;
-            //auto p0 = Vector3::Transform({ -w, h, 0 }, billboard); // bl
-            //auto p1 = Vector3::Transform({ w, h, 0 }, billboard); // br
-            //auto p2 = Vector3::Transform({ w, -h, 0 }, billboard); // tr
-            //auto p3 = Vector3::Transform({ -w, -h, 0 }, billboard); // tl
-
-            //ObjectVertex v0(p0, { 0, 0 }, p.Color);
-            //ObjectVertex v1(p1, { 1, 0 }, p.Color);
-            //ObjectVertex v2(p2, { 1, 1 }, p.Color);
-            //ObjectVertex v3(p3, { 0, 1 }, p.Color);
-
-            //auto& material = Materials->Get(tid);
-            //effect.Shader->SetDiffuse(cmd, material.Handles[0]);
-
-            //DrawCalls++;
-            //g_SpriteBatch->Begin(cmd);
-            //g_SpriteBatch->DrawQuad(v0, v1, v2, v3);
-            //g_SpriteBatch->End();
+        Particles.BuildBatches(Camera.Position, Camera.Up);
+
+        auto batches = Particles.GetBatches();
+        if (batches.empty()) return;
+
+        auto vertices = Particles.GetVertices();
+        auto& effect = Effects->SpriteAdditive;
+        effect.Apply(cmd);
+        effect.Shader->SetWorldViewProjection(cmd, ViewProjection);
+        effect.Shader->SetSampler(cmd, Render::GetClampedTextureSampler());
+
+        // One draw per texture
+        for (auto& batch : batches) {
+            auto& material = Materials->Get(batch.Texture);
+            effect.Shader->SetDiffuse(cmd, material.Handles[0]);
+
+            DrawCalls++;
+            g_SpriteBatch->Begin(cmd);
+            for (int i = batch.Start; i < batch.Start + batch.Count; i += 4) {
+                auto v = &vertices[i];
+                g_SpriteBatch->DrawQuad({ v[0].Position, v[0].UV, v[0].Color }, { v[1].Position, v[1].UV, v[1].Color },
+                                        { v[2].Position, v[2].UV, v[2].Color }, { v[3].Position, v[3].UV, v[3].Color });
+            }
+            g_SpriteBatch->End();
         }
     }
+
+    const ParticleSystem::Stats& GetParticleStats() {
+        return Particles.GetStats();
+    }
 }
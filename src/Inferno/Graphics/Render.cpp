@@ -26,6 +26,7 @@ namespace Inferno::Render {
     Color ClearColor = { 0.1f, 0.1f, 0.1f, 1.0f };
     BoundingFrustum CameraFrustum;
     bool LevelChanged = false;
+    List<Tag> ChangedLightSides; // Sides whose light changed. Applied to the level mesh in place unless it's being rebuilt.
 
     //const string TEST_MODEL = "robottesttube(orbot).OOF"; // mixed transparency test
     const string TEST_MODEL = "gyro.OOF";
@@ -125,7 +126,9 @@ namespace Inferno::Render {
     //};
 
     LevelMeshBuilder _levelMeshBuilder;
-    Ptr<PackedBuffer> _levelMeshBuffer;
+    List<Ptr<PackedBuffer>> _levelMeshBuffers; // One per frame in flight
+
+    const LevelMeshBuilder::Stats& GetLevelMeshStats() { return _levelMeshBuilder.GetStats(); }
 
     void DrawObject(ID3D12GraphicsCommandList* cmd, const Object& object, float alpha);
 
@@ -154,8 +157,7 @@ namespace Inferno::Render {
         ObjectShader::Constants constants = {};
         constants.Eye = Camera.Position;
 
-        auto& seg = Game::Level.GetSegment(object.Segment);
-        constants.Colors[0] = Settings::Editor.RenderMode == RenderMode::Shaded ? seg.VolumeLight : Color(1, 1, 1);
+        constants.Colors[0] = Settings::Editor.RenderMode == RenderMode::Shaded ? Game::Level.SampleVolumeLight(object.Segment, object.Position) : Color(1, 1, 1);
 
         //Matrix transform = object.GetTransform(t);
         Matrix transform = Matrix::Lerp(object.GetLastTransform(), object.GetTransform(), alpha);
@@ -238,8 +240,7 @@ namespace Inferno::Render {
         ObjectShader::Constants constants = {};
         constants.Eye = Camera.Position;
 
-        auto& seg = Game::Level.GetSegment(object.Segment);
-        constants.Colors[0] = Settings::Editor.RenderMode == RenderMode::Shaded ? seg.VolumeLight : Color(1, 1, 1);
+        constants.Colors[0] = Settings::Editor.RenderMode == RenderMode::Shaded ? Game::Level.SampleVolumeLight(object.Segment, object.Position) : Color(1, 1, 1);
 
         Matrix transform = object.GetTransform();
         transform.Forward(-transform.Forward()); // flip z axis to correct for LH models
@@ -367,15 +368,16 @@ namespace Inferno::Render {
     }
 
     // When up is provided, it constrains the sprite to that axis
-    void DrawSprite(const Object& object, ID3D12GraphicsCommandList* cmd, bool additive, const Vector3* up = nullptr, bool lit = false) {
+    void DrawSprite(const Object& object, ID3D12GraphicsCommandList* cmd, float alpha, bool additive, const Vector3* up = nullptr, bool lit = false) {
         auto& vclip = Resources::GetVideoClip(object.Render.VClip.ID);
         if (vclip.NumFrames == 0) {
             DrawObjectOutline(object);
             return;
         }
 
-        Color color = lit ? Game::Level.GetSegment(object.Segment).VolumeLight : Color(1, 1, 1);
-        DrawVClip(cmd, vclip, object.Position, object.Radius, color, (float)ElapsedTime, additive, object.Render.VClip.Rotation, up);
+        auto position = Vector3::Lerp(object.LastPosition, object.Position, alpha);
+        Color color = lit ? Game::Level.SampleVolumeLight(object.Segment, position) : Color(1, 1, 1);
+        DrawVClip(cmd, vclip, position, object.Radius, color, (float)ElapsedTime, additive, object.Render.VClip.Rotation, up);
     }
 
     void DrawLevelMesh(ID3D12GraphicsCommandList* cmdList, const Inferno::LevelMesh& mesh) {
@@ -476,7 +478,9 @@ namespace Inferno::Render {
 
         CreateWindowSizeDependentResources(width, height);
         Camera.SetViewport((float)width, (float)height);
-        _levelMeshBuffer = MakePtr<PackedBuffer>(1024 * 1024 * 10);
+        _levelMeshBuffers.clear();
+        for (uint i = 0; i < Adapter->GetBackBufferCount(); i++)
+            _levelMeshBuffers.push_back(MakePtr<PackedBuffer>(1024 * 1024 * 10));
 
         Editor::Events::LevelChanged += [] { LevelChanged = true; };
         Editor::Events::TexturesChanged += [] {
@@ -503,7 +507,7 @@ namespace Inferno::Render {
         g_ImGuiBatch.reset();
 
         ReleaseEditorResources();
-        _levelMeshBuffer.reset();
+        _levelMeshBuffers.clear();
         _meshBuffer.reset();
 
         Adapter.reset();
@@ -573,7 +577,7 @@ namespace Inferno::Render {
             NewTextureCache->MakeResident();
         }
 
-        _levelMeshBuilder.Update(level, *_levelMeshBuffer);
+        _levelMeshBuilder.Update(level, _levelMeshBuffers);
     }
 
     void DrawObject(ID3D12GraphicsCommandList* cmd, const Object& object, float alpha) {
@@ -589,7 +593,7 @@ namespace Inferno::Render {
             case ObjectType::Hostage:
             {
                 auto up = object.Rotation.Up();
-                DrawSprite(object, cmd, false, &up, Settings::Editor.RenderMode == RenderMode::Shaded);
+                DrawSprite(object, cmd, alpha, false, &up, Settings::Editor.RenderMode == RenderMode::Shaded);
                 break;
             }
 
@@ -610,7 +614,7 @@ namespace Inferno::Render {
                     DrawModel(cmd, object, object.Render.Model.ID, alpha, texOverride);
                 }
                 else {
-                    DrawSprite(object, cmd, true);
+                    DrawSprite(object, cmd, alpha, true);
                 }
                 break;
 
@@ -618,17 +622,17 @@ namespace Inferno::Render {
             {
                 if (object.Render.VClip.ID == VClips::Matcen) {
                     auto up = object.Rotation.Up();
-                    DrawSprite(object, cmd, true, &up);
+                    DrawSprite(object, cmd, alpha, true, &up);
                 }
                 else {
-                    DrawSprite(object, cmd, true);
+                    DrawSprite(object, cmd, alpha, true);
                 }
                 break;
             }
 
             case ObjectType::Powerup:
             {
-                DrawSprite(object, cmd, false);
+                DrawSprite(object, cmd, alpha, false);
                 break;
             }
 
@@ -741,14 +745,31 @@ namespace Inferno::Render {
         ctx.BeginEvent(L"Level");
 
         if (Settings::Editor.ShowFlickeringLights)
-            UpdateFlickeringLights(Game::Level, (float)ElapsedTime, FrameTime);
+            Game::FlickerSchedule.Update(Game::Level, ElapsedTime, ChangedLightSides);
 
         if (LevelChanged) {
-            Adapter->WaitForGpu();
-            _levelMeshBuilder.Update(Game::Level, *_levelMeshBuffer);
+            // Edits that only move or relight sides are patched, avoiding a stall on the GPU
+            if (!_levelMeshBuilder.UpdateChanged(Game::Level)) {
+                Adapter->WaitForGpu();
+                _levelMeshBuilder.Update(Game::Level, _levelMeshBuffers);
+            }
+
             LevelChanged = false;
+            ChangedLightSides.clear(); // The update already has the new light
+        }
+        else if (!ChangedLightSides.empty()) {
+            // Several lights can affect the same side
+            ranges::sort(ChangedLightSides);
+            auto duplicates = ranges::unique(ChangedLightSides);
+            ChangedLightSides.erase(duplicates.begin(), duplicates.end());
+
+            Metrics::LightVertexUpdates += _levelMeshBuilder.UpdateLights(Game::Level, ChangedLightSides);
+            ChangedLightSides.clear();
         }
 
+        // The previous frame that used this buffer has finished, so the patches can be written to it
+        _levelMeshBuilder.BeginFrame(Adapter->GetCurrentFrameIndex());
+
         ScopedTimer levelTimer(&Metrics::QueueLevel);
         if (Settings::Editor.RenderMode != RenderMode::None) {
             // Queue commands for level meshes
@@ -100,4 +100,7 @@ namespace Inferno::Render {
 
     inline Ptr<StaticTextureDef> StaticTextures;
     extern bool LevelChanged;
+
+    // Stats for the last update of the level mesh
+    const LevelMeshBuilder::Stats& GetLevelMeshStats();
 }
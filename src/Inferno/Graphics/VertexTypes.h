@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DirectX.h"
+
+// Vertex layouts and pipeline states, kept apart from the shaders so geometry code can use them without the renderer
+namespace Inferno {
+    using HlslBool = int32; // For alignment on GPU
+
+    constexpr D3D12_INPUT_LAYOUT_DESC CreateLayout(span<const D3D12_INPUT_ELEMENT_DESC> desc) {
+        return { desc.data(), (uint)desc.size() };
+    };
+
+    struct LevelVertex {
+        Vector3 Position;
+        Vector2 UV;
+        Vector4 Color;
+        Vector2 UV2; // for overlay texture
+        Vector3 Normal;
+
+        static inline const D3D12_INPUT_ELEMENT_DESC Description[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        };
+
+        static inline const D3D12_INPUT_LAYOUT_DESC Layout = CreateLayout(Description);
+
+    };
+
+    struct FlatVertex {
+        Vector3 Position;
+        Color Color;
+
+        static inline const D3D12_INPUT_ELEMENT_DESC Description[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+
+        static inline const D3D12_INPUT_LAYOUT_DESC Layout = CreateLayout(Description);
+    };
+
+    // this should match imgui shader
+    struct CanvasVertex {
+        Vector2 Position;
+        Vector2 UV;
+        uint32 Color;
+
+        static inline const D3D12_INPUT_ELEMENT_DESC Description[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT,   0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,   0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+
+        static inline const D3D12_INPUT_LAYOUT_DESC Layout = CreateLayout(Description);
+    };
+
+    struct ObjectVertex {
+        Vector3 Position;
+        Vector2 UV;
+        Color Color;
+        Vector3 Normal;
+
+        static inline const D3D12_INPUT_ELEMENT_DESC Description[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+
+        static inline const D3D12_INPUT_LAYOUT_DESC Layout = CreateLayout(Description);
+    };
+
+    enum class BlendMode { Opaque, Alpha, StraightAlpha, Additive };
+    enum class CullMode { None, CounterClockwise, Clockwise };
+    enum class DepthMode { Default, Read, None };
+}
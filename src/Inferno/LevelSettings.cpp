@@ -165,16 +165,86 @@ namespace Inferno {
         }
     }
 
+    // Probes are stored as a row of RGB values for each segment
+    void SaveLightProbes(ryml::NodeRef node, const Level& level) {
+        auto& grid = level.LightProbes;
+        node |= ryml::MAP;
+        node["Resolution"] << grid.Resolution;
+
+        auto segments = node["Segments"];
+        segments |= ryml::SEQ;
+
+        for (int id = 0; id < level.Segments.size(); id++) {
+            string row;
+            for (auto& probe : grid.GetSegment(SegID(id))) {
+                if (!row.empty()) row += ' ';
+                row += fmt::format("{:.4g},{:.4g},{:.4g}", probe.R(), probe.G(), probe.B());
+            }
+
+            segments.append_child() << row;
+        }
+    }
+
+    void ReadLightProbes(ryml::NodeRef node, Level& level) {
+        if (!node.valid() || node.is_seed()) return;
+
+        LightProbeGrid grid;
+        ReadValue(node["Resolution"], grid.Resolution);
+        if (grid.Resolution <= 0 || grid.Resolution > 4) return;
+
+        auto segments = node["Segments"];
+        if (segments.is_seed() || segments.num_children() != level.Segments.size()) {
+            SPDLOG_WARN("Light probes don't match the level segments. Relight the level to bake them.");
+            return;
+        }
+
+        auto perSegment = (size_t)grid.ProbesPerSegment();
+        grid.Probes.reserve(level.Segments.size() * perSegment);
+
+        for (const auto& child : segments.children()) {
+            string row;
+            ReadString(child, row);
+            auto probes = String::Split(row, ' ', true);
+            if (probes.size() != perSegment) {
+                SPDLOG_WARN("Light probes in the level metadata are incomplete. Relight the level to bake them.");
+                return;
+            }
+
+            for (auto& probe : probes) {
+                auto rgb = String::Split(probe, ',', true);
+                Color color(0, 0, 0, 1);
+                if (rgb.size() == 3) {
+                    ParseFloat(rgb[0], color.x);
+                    ParseFloat(rgb[1], color.y);
+                    ParseFloat(rgb[2], color.z);
+                }
+
+                grid.Probes.push_back(color);
+            }
+        }
+
+        level.LightProbes = std::move(grid);
+    }
+
     void LoadLevelMetadata(Level& level, const string& data) {
+        LoadLevelMetadata(level, data, Settings::Editor.Lighting);
+    }
+
+    void SaveLevelMetadata(const Level& level, std::ostream& stream) {
+        SaveLevelMetadata(level, stream, Settings::Editor.Lighting);
+    }
+
+    void LoadLevelMetadata(Level& level, const string& data, LightSettings& lightSettings) {
         try {
             ryml::Tree doc = ryml::parse(ryml::to_csubstr(data));
             ryml::NodeRef root = doc.rootref();
 
             if (root.is_map()) {
-                Settings::Editor.Lighting = LoadLightSettings(root["Lighting"]);
+                lightSettings = LoadLightSettings(root["Lighting"]);
                 ReadSegmentInfo(root["Segments"], level);
                 ReadSideInfo(root["Sides"], level);
                 ReadWallInfo(root["Walls"], level);
+                ReadLightProbes(root["LightProbes"], level);
             }
         }
         catch (const std::exception& e) {
@@ -182,16 +252,19 @@ namespace Inferno {
         }
     }
 
-    void SaveLevelMetadata(const Level& level, std::ostream& stream) {
+    void SaveLevelMetadata(const Level& level, std::ostream& stream, const LightSettings& lightSettings) {
         try {
             ryml::Tree doc(30, 128);
             doc.rootref() |= ryml::MAP;
 
             doc["Version"] << 1;
-            SaveLightSettings(doc["Lighting"], Settings::Editor.Lighting);
+            SaveLightSettings(doc["Lighting"], lightSettings);
             SaveSegmentInfo(doc["Segments"], level);
             SaveSideInfo(doc["Sides"], level);
             SaveWallInfo(doc["Walls"], level);
+
+            if (level.LightProbes.Resolution > 0)
+                SaveLightProbes(doc["LightProbes"], level);
             stream << doc;
         }
         catch (const std::exception& e) {
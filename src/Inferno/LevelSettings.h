@@ -7,4 +7,8 @@
 namespace Inferno {
     void LoadLevelMetadata(Level& level, const string& data);
     void SaveLevelMetadata(const Level&, std::ostream&);  
+
+    // Variants that read and write the light settings for a level instead of the global editor settings
+    void LoadLevelMetadata(Level& level, const string& data, LightSettings& lightSettings);
+    void SaveLevelMetadata(const Level&, std::ostream&, const LightSettings& lightSettings);
 }
@@ -1,22 +1,56 @@
 #include "pch.h"
 #include <iostream>
+#include <execution>
 #include "Physics.h"
 #include "Resources.h"
 #include "Game.h"
 #include "Graphics/Render.h"
 #include "Input.h"
 #include "Editor/Editor.Object.h"
+#include "Editor/Editor.Segment.h"
 #include "Graphics/Render.Debug.h"
 #include "SoundSystem.h"
 #include "Editor/Events.h"
 #include "Graphics/Render.Particles.h"
 #include "Game.Wall.h"
+#include "Game.CollisionMesh.h"
+#include "Game.Broadphase.h"
+#include "Game.Benchmark.h"
+#include "ScopedTimer.h"
 
 using namespace DirectX;
 
 namespace Inferno {
     constexpr auto PlayerTurnRollScale = FixToFloat(0x4ec4 / 2) * XM_2PI;
     constexpr auto PlayerTurnRollRate = FixToFloat(0x2000) * XM_2PI;
+    constexpr int MaxSweepIterations = 4; // Surfaces an object can slide along in one update
+    constexpr float SweepSkin = 0.01f; // Gap left between a moving object and the surface it hits
+    constexpr float SweepTolerance = 0.001f;
+    constexpr size_t ParallelThreshold = 32; // Fewer items than this are processed on the calling thread
+
+    // Calls fn for each item, spread across threads when there are enough items to cover the overhead
+    void ParallelForEach(auto& items, auto&& fn) {
+        if (items.size() >= ParallelThreshold)
+            std::for_each(std::execution::par, items.begin(), items.end(), fn);
+        else
+            std::for_each(items.begin(), items.end(), fn);
+    }
+
+    // Adds the duration of a level query to the debug counters. Queries run on several threads at once.
+    class QueryTimer {
+        std::chrono::steady_clock::time_point _begin = std::chrono::steady_clock::now();
+
+    public:
+        QueryTimer() { Debug::Queries++; }
+
+        ~QueryTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - _begin;
+            Debug::QueryTime += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        }
+
+        QueryTimer(const QueryTimer&) = delete;
+        QueryTimer& operator=(const QueryTimer&) = delete;
+    };
 
     // Rolls the object when turning
     void TurnRoll(Object& obj, float rollScale, float rollRate, float dt) {
@@ -85,9 +119,35 @@ namespace Inferno {
 
     // This should be done elsewhere but is useful for testing
     // todo: keyboard ramping
-    void HandleInput(Object& obj, float dt) {
-        auto& physics = obj.Movement.Physics;
+    // Debug lines are skipped when simulating without rendering
+    void DrawDebugLine(const Vector3& a, const Vector3& b, const Color& color) {
+        if (!Game::Headless) Render::Debug::DrawLine(a, b, color);
+    }
+
+    TickInput SampleInput() {
         using Keys = DirectX::Keyboard::Keys;
+        TickInput input;
+
+        auto bind = [&input](Keys key, InputButton button) {
+            if (Input::IsKeyDown(key)) input.Buttons |= button;
+        };
+
+        bind(Keys::Add, InputButton::Forward);
+        bind(Keys::Subtract, InputButton::Reverse);
+        bind(Keys::NumPad1, InputButton::SlideLeft);
+        bind(Keys::NumPad3, InputButton::SlideRight);
+        bind(Keys::NumPad4, InputButton::YawLeft);
+        bind(Keys::NumPad6, InputButton::YawRight);
+        bind(Keys::NumPad5, InputButton::PitchDown);
+        bind(Keys::NumPad8, InputButton::PitchUp);
+        bind(Keys::NumPad7, InputButton::RollLeft);
+        bind(Keys::NumPad9, InputButton::RollRight);
+        bind(Keys::Enter, InputButton::Fire);
+        return input;
+    }
+
+    void HandleInput(Object& obj, const TickInput& input, float dt) {
+        auto& physics = obj.Movement.Physics;
 
         //auto ht0 = GetHoldTime(true, 0, frameTime);
         //auto ht1 = GetHoldTime(true, 1, frameTime);
@@ -95,36 +155,36 @@ namespace Inferno {
         physics.Thrust = Vector3::Zero;
         physics.AngularThrust = Vector3::Zero;
 
-        if (Input::IsKeyDown(Keys::Add))
+        if (input.Has(InputButton::Forward))
             physics.Thrust += obj.Rotation.Forward() * dt;
 
-        if (Input::IsKeyDown(Keys::Subtract))
+        if (input.Has(InputButton::Reverse))
             physics.Thrust += obj.Rotation.Backward() * dt;
 
         // yaw
-        if (Input::IsKeyDown(Keys::NumPad4))
+        if (input.Has(InputButton::YawLeft))
             physics.AngularThrust.y = -dt;
-        if (Input::IsKeyDown(Keys::NumPad6))
+        if (input.Has(InputButton::YawRight))
             physics.AngularThrust.y = dt;
 
         // pitch
-        if (Input::IsKeyDown(Keys::NumPad5))
+        if (input.Has(InputButton::PitchDown))
             physics.AngularThrust.x = -dt;
-        if (Input::IsKeyDown(Keys::NumPad8))
+        if (input.Has(InputButton::PitchUp))
             physics.AngularThrust.x = dt;
 
 
         // roll
-        if (Input::IsKeyDown(Keys::NumPad7))
+        if (input.Has(InputButton::RollLeft))
             physics.AngularThrust.z = -dt;
-        if (Input::IsKeyDown(Keys::NumPad9))
+        if (input.Has(InputButton::RollRight))
             physics.AngularThrust.z = dt;
 
 
-        if (Input::IsKeyDown(Keys::NumPad1))
+        if (input.Has(InputButton::SlideLeft))
             physics.Thrust += obj.Rotation.Left() * dt;
 
-        if (Input::IsKeyDown(Keys::NumPad3))
+        if (input.Has(InputButton::SlideRight))
             physics.Thrust += obj.Rotation.Right() * dt;
     }
 
@@ -628,47 +688,87 @@ namespace Inferno {
         }
     };
 
+    // Returns the collision mesh for the level, building it if it was built for another level
+    const LevelCollisionMesh& GetCollisionMesh(Level& level) {
+        if (!Game::CollisionMesh.Matches(level))
+            Game::CollisionMesh.Build(level);
+
+        return Game::CollisionMesh;
+    }
+
+    // Finds the closest point on either triangle of a side within the sphere
+    HitInfo IntersectSideSphere(const SegmentCollision& mesh, SideID side, const BoundingSphere& sphere) {
+        HitInfo hit;
+
+        for (int tri = (int)side * 2; tri < (int)side * 2 + 2; tri++) {
+            if (!mesh.Valid[tri]) continue;
+
+            auto planeDist = mesh.DistanceFromPlane(tri, sphere.Center);
+            if (std::abs(planeDist) > sphere.Radius) continue;
+
+            // Use the projection when it lands inside the triangle, otherwise fall back to the edges
+            auto p = sphere.Center - mesh.Normal[tri] * planeDist;
+            if (!mesh.Contains(tri, p))
+                p = ClosestPointOnTriangle(mesh.P0[tri], mesh.P1[tri], mesh.P2[tri], sphere.Center);
+
+            auto dist = (p - sphere.Center).Length();
+            if (dist < hit.Distance) {
+                hit.Point = p;
+                hit.Distance = dist;
+            }
+        }
+
+        if (hit.Distance > sphere.Radius)
+            hit.Distance = FLT_MAX;
+        else
+            (hit.Point - sphere.Center).Normalize(hit.Normal);
+
+        return hit;
+    }
+
     // Finds the nearest sphere-level intersection
     bool IntersectLevel(Level& level, const BoundingSphere& sphere, SegID segId, ObjID oid, LevelHit& hit) {
-        auto& seg = level.GetSegment(segId);
-        hit.Visited.insert(segId);
+        QueryTimer timer;
 
+        auto& collision = GetCollisionMesh(level);
         auto& obj = level.Objects[(int)oid];
+        PortalSearch search(collision, segId);
 
-        // Did we hit any objects in this segment?
-        for (int i = 0; i < level.Objects.size(); i++) {
-            auto& other = level.Objects[i];
-            //if (!Object::IsAlive(obj) || obj.Segment != segId) continue;
-            //if (hit.Source && hit.Source->Parent == (ObjID)i) continue; // don't hit parent
-            //if (hit.Source == &obj) continue; // don't hit yourself!
-            //if (source.Parent == obj.Parent) continue; // Don't hit your siblings!
-
-            if (!Object::IsAlive(other) || other.Segment != segId) continue;
-            if (oid == (ObjID)i) continue; // don't hit yourself!
-            if (obj.Parent == other.Parent) continue; // Don't hit your siblings!
-            if (oid == other.Parent) continue; // Don't hit your children!
+        auto testObject = [&](ObjID otherId, Object& other) {
+            if (!Object::IsAlive(other)) return;
 
             BoundingSphere objSphere(other.Position, other.Radius);
             if (auto info = IntersectSphereSphere(sphere, objSphere)) {
                 hit.Update(info, &other);
             }
+        };
+
+        // Did we hit any objects? Candidates from the broadphase already passed the ownership checks.
+        bool useBroadphase = Game::Broadphase.Contains(oid);
+        if (useBroadphase) {
+            for (auto otherId : Game::Broadphase.GetCandidates(oid))
+                testObject(otherId, level.Objects[(int)otherId]);
         }
 
-        for (auto& side : SideIDs) {
-            auto face = Face::FromSide(level, segId, side);
+        while (!search.Empty()) {
+            auto id = search.Pop();
+            auto& mesh = collision.GetSegment(id);
 
-            if (auto h = IntersectFaceSphere(face, sphere)) {
-                if (h.Normal.Dot(face.AverageNormal()) > 0)
-                    continue; // passed through back of face
+            if (!useBroadphase) {
+                level.ForEachObjectInSegment(id, [&](ObjID otherId, Object& other) {
+                    if (CanCollide(oid, obj, otherId, other)) testObject(otherId, other);
+                });
+            }
 
-                if (seg.SideIsSolid(side, level)) {
-                    hit.Update(h, { segId, side }); // hit a solid wall
-                }
-                else {
-                    // intersected with a connected side, must check faces in it too
-                    auto conn = seg.GetConnection(side);
-                    if (conn > SegID::None && !hit.Visited.contains(conn))
-                        IntersectLevel(level, sphere, conn, oid, hit); // Recursive
+            for (auto& side : SideIDs) {
+                if (auto h = IntersectSideSphere(mesh, side, sphere)) {
+                    if (h.Normal.Dot(mesh.SideNormal[(int)side]) > 0)
+                        continue; // passed through back of face
+
+                    if (mesh.Solid[(int)side])
+                        hit.Update(h, { id, side }); // hit a solid wall
+                    else
+                        search.Push(mesh.Portal[(int)side]); // intersected with a connected side, must check faces in it too
                 }
             }
         }
@@ -679,26 +779,37 @@ namespace Inferno {
 
     // intersects a ray with the level, returning hit information
     bool IntersectLevel(Level& level, const Ray& ray, SegID start, float maxDist, LevelHit& hit) {
+        auto& collision = GetCollisionMesh(level);
         SegID segId = start;
 
         while (segId > SegID::None) {
-            auto& seg = level.GetSegment(segId);
+            auto& mesh = collision.GetSegment(segId);
 
             for (auto& side : SideIDs) {
-                auto face = Face::FromSide(level, seg, side);
+                float dist = FLT_MAX;
 
-                float dist{};
-                if (face.Intersects(ray, dist) && dist < hit.Distance) {
+                for (int tri = (int)side * 2; tri < (int)side * 2 + 2; tri++) {
+                    auto denom = mesh.Normal[tri].Dot(ray.direction);
+                    if (!mesh.Valid[tri] || denom >= 0) continue; // back faces can't be hit from inside
+
+                    auto t = -mesh.DistanceFromPlane(tri, ray.position) / denom;
+                    if (t >= 0 && mesh.Contains(tri, ray.position + ray.direction * t)) {
+                        dist = t;
+                        break;
+                    }
+                }
+
+                if (dist < hit.Distance) {
                     if (dist > maxDist) return {}; // hit is too far
 
-                    if (seg.SideIsSolid(side, level)) { // todo: this isn't accurate due to door flags
+                    if (mesh.Solid[(int)side]) { // todo: this isn't accurate due to door flags
                         hit.Tag = { segId, side };
                         hit.Distance = dist;
                         hit.Normal = {}; // todo: normal
                         return true;
                     }
                     else {
-                        segId = seg.GetConnection(side);
+                        segId = mesh.Portal[(int)side];
                         break; // go to next segment
                     }
                 }
@@ -711,60 +822,271 @@ namespace Inferno {
         return false;
     }
 
+    int RayBatch::Add(const Ray& ray, SegID start, float maxDist) {
+        _queries.push_back({ ray, start, maxDist });
+        return (int)_queries.size() - 1;
+    }
+
+    void RayBatch::Run(Level& level) {
+        _stats = { .Rays = (int)_queries.size() };
+        ScopedTimer timer(&_stats.Time);
+
+        _hits.assign(_queries.size(), {});
+        if (_queries.empty()) return;
+
+        GetCollisionMesh(level); // Build the mesh before queries run on other threads
+
+        // Rays starting in the same segment walk the same geometry, so keep them together
+        _order.resize(_queries.size());
+        for (int i = 0; i < _order.size(); i++)
+            _order[i] = i;
+
+        std::ranges::sort(_order, {}, [this](int i) { return _queries[i].Start; });
+
+        ParallelForEach(_order, [this, &level](int i) {
+            auto& query = _queries[i];
+            IntersectLevel(level, query.Ray, query.Start, query.MaxDistance, _hits[i]);
+        });
+    }
+
+    void RayBatch::Clear() {
+        _queries.clear();
+        _hits.clear();
+        _order.clear();
+    }
+
     // Intersects a capsule with the level
     bool IntersectLevel(Level& level, const BoundingCapsule& capsule, SegID segId, const Object& object, LevelHit& hit) {
-        auto& seg = level.GetSegment(segId);
-        hit.Visited.insert(segId);
+        QueryTimer timer;
 
-        // Did we hit any objects in this segment?
-        for (int i = 0; i < level.Objects.size(); i++) {
-            auto& obj = level.Objects[i];
-            if (!Object::IsAlive(obj) || obj.Segment != segId) continue;
-            if (object.Parent == (ObjID)i || &obj == &object) continue; // don't hit yourself!
-            if (object.Parent == obj.Parent) continue; // Don't hit your siblings!
+        auto& collision = GetCollisionMesh(level);
+        PortalSearch search(collision, segId);
 
-            BoundingSphere sphere(obj.Position, obj.Radius);
-            if (auto info = capsule.Intersects(sphere)) {
-                hit.Update(info, &obj);
+        while (!search.Empty()) {
+            auto id = search.Pop();
+            auto& mesh = collision.GetSegment(id);
+
+            // Did we hit any objects in this segment?
+            level.ForEachObjectInSegment(id, [&](ObjID otherId, Object& obj) {
+                if (!Object::IsAlive(obj)) return;
+                if (object.Parent == otherId || &obj == &object) return; // don't hit yourself!
+                if (object.Parent == obj.Parent) return; // Don't hit your siblings!
+
+                BoundingSphere sphere(obj.Position, obj.Radius);
+                if (auto info = capsule.Intersects(sphere)) {
+                    hit.Update(info, &obj);
+                }
+            });
+
+            //if (hit) return hit; // Objects will always be inside of a segment, no need to check walls if we hit something
+
+            for (int tri = 0; tri < SegmentCollision::Triangles; tri++) {
+                if (!mesh.Valid[tri]) continue;
+
+                // Skip triangles when both ends of the capsule are outside the radius on the same side of the plane
+                auto da = mesh.DistanceFromPlane(tri, capsule.A);
+                auto db = mesh.DistanceFromPlane(tri, capsule.B);
+                if ((da > capsule.Radius && db > capsule.Radius) || (da < -capsule.Radius && db < -capsule.Radius))
+                    continue;
+
+                auto side = SegmentCollision::GetSide(tri);
+                Vector3 refPoint, normal;
+                float dist{};
+                if (capsule.Intersects(mesh.P0[tri], mesh.P1[tri], mesh.P2[tri], mesh.Normal[tri], refPoint, normal, dist)) {
+                    if (mesh.Solid[(int)side]) {
+                        if (dist < hit.Distance) {
+                            hit.Normal = normal;
+                            hit.Point = refPoint;
+                            hit.Distance = dist;
+                            hit.Tag = { id, side };
+                        }
+                    }
+                    else {
+                        search.Push(mesh.Portal[(int)side]); // scan touching seg
+                    }
+                }
             }
         }
 
-        //if (hit) return hit; // Objects will always be inside of a segment, no need to check walls if we hit something
+        return hit;
+    }
 
-        for (auto& side : SideIDs) {
-            auto face = Face::FromSide(level, seg, side);
-            auto i = face.Side.GetRenderIndices();
+    // Returns the distance along the ray where it enters the sphere, 0 if it starts inside, or FLT_MAX on a miss
+    float SweepPointSphere(const Vector3& start, const Vector3& dir, const Vector3& center, float radius) {
+        auto m = start - center;
+        auto b = m.Dot(dir);
+        auto c = m.Dot(m) - radius * radius;
+        if (c <= 0) return 0; // starts inside
+        if (b > 0) return FLT_MAX; // moving away
+
+        auto disc = b * b - c;
+        if (disc < 0) return FLT_MAX;
+        return -b - std::sqrt(disc);
+    }
 
-            Vector3 refPoint, normal;
-            float dist{};
-            if (capsule.Intersects(face[i[0]], face[i[1]], face[i[2]], face.Side.Normals[0], refPoint, normal, dist)) {
-                if (seg.SideIsSolid(side, level) && dist < hit.Distance) {
-                    hit.Normal = normal;
-                    hit.Point = refPoint;
-                    hit.Distance = dist;
-                    hit.Tag = { segId, side };
-                }
-                else {
-                    // scan touching seg
-                    auto conn = seg.GetConnection(side);
-                    if (conn > SegID::None && !hit.Visited.contains(conn))
-                        IntersectLevel(level, capsule, conn, object, hit);
-                }
+    // Returns the distance along the ray where it enters the cylinder around the edge, or FLT_MAX on a miss.
+    // Contacts past the ends of the edge are left to the vertex tests.
+    float SweepPointEdge(const Vector3& start, const Vector3& dir, const Vector3& a, const Vector3& b, float radius) {
+        auto e = b - a;
+        auto m = start - a;
+        auto ee = e.Dot(e);
+        auto ed = e.Dot(dir);
+        auto em = e.Dot(m);
+
+        auto qa = ee - ed * ed;
+        if (qa < 0.0001f) return FLT_MAX; // parallel to the edge
+        auto qb = ee * m.Dot(dir) - em * ed;
+        auto qc = ee * (m.Dot(m) - radius * radius) - em * em;
+
+        auto disc = qb * qb - qa * qc;
+        if (disc < 0) return FLT_MAX;
+
+        auto t = (-qb - std::sqrt(disc)) / qa;
+        if (t < 0) return FLT_MAX;
+
+        auto s = (em + t * ed) / ee;
+        return s >= 0 && s <= 1 ? t : FLT_MAX;
+    }
+
+    // Finds the earliest contact of a sphere moving along dir with a triangle, checking the face, edges and vertices.
+    // Distance is 0 if the sphere starts touching the triangle. Normal points from the contact to the sphere center.
+    HitInfo SweepSphereTriangle(const SegmentCollision& mesh, int tri, const Vector3& start, const Vector3& dir, float maxDist, float radius) {
+        HitInfo hit;
+        if (!mesh.Valid[tri]) return hit;
+
+        // Both ends of the sweep outside the radius on the same side of the plane can't touch
+        auto d0 = mesh.DistanceFromPlane(tri, start);
+        auto d1 = mesh.DistanceFromPlane(tri, start + dir * maxDist);
+        if ((d0 > radius && d1 > radius) || (d0 < -radius && d1 < -radius))
+            return hit;
+
+        auto& n = mesh.Normal[tri];
+        auto& p0 = mesh.P0[tri];
+        auto& p1 = mesh.P1[tri];
+        auto& p2 = mesh.P2[tri];
+
+        auto setHit = [&](float t, const Vector3& point) {
+            auto center = start + dir * t;
+            hit.Distance = t;
+            hit.Point = point;
+            hit.Normal = center - point;
+            hit.Normal.Normalize();
+            if (!IsNormalized(hit.Normal)) hit.Normal = n;
+        };
+
+        // Already touching
+        auto projected = start - n * d0;
+        auto closest = mesh.Contains(tri, projected) ? projected : ClosestPointOnTriangle(p0, p1, p2, start);
+        if (Vector3::DistanceSquared(closest, start) < radius * radius) {
+            setHit(0, closest);
+            return hit;
+        }
+
+        // Face contact is always earlier than an edge or vertex contact
+        auto denom = n.Dot(dir);
+        if (denom < 0 && d0 >= radius) {
+            auto t = (d0 - radius) / -denom;
+            if (t > maxDist) return hit;
+
+            auto point = start + dir * t - n * radius;
+            if (mesh.Contains(tri, point)) {
+                setHit(t, point);
+                return hit;
             }
+        }
 
-            if (capsule.Intersects(face[i[3]], face[i[4]], face[i[5]], face.Side.Normals[1], refPoint, normal, dist)) {
-                if (seg.SideIsSolid(side, level) && dist < hit.Distance) {
-                    hit.Normal = normal;
-                    hit.Point = refPoint;
-                    hit.Distance = dist;
-                    hit.Tag = { segId, side };
-                }
-                else {
-                    // scan touching seg
-                    auto conn = seg.GetConnection(side);
-                    if (conn > SegID::None && !hit.Visited.contains(conn))
-                        IntersectLevel(level, capsule, conn, object, hit);
+        float best = FLT_MAX;
+        Vector3 bestPoint;
+
+        auto testEdge = [&](const Vector3& a, const Vector3& b) {
+            auto t = SweepPointEdge(start, dir, a, b, radius);
+            if (t < best) {
+                best = t;
+                bestPoint = ClosestPointOnLine(a, b, start + dir * t);
+            }
+        };
+
+        auto testVertex = [&](const Vector3& v) {
+            auto t = SweepPointSphere(start, dir, v, radius);
+            if (t < best) {
+                best = t;
+                bestPoint = v;
+            }
+        };
+
+        testEdge(p0, p1);
+        testEdge(p1, p2);
+        testEdge(p2, p0);
+        testVertex(p0);
+        testVertex(p1);
+        testVertex(p2);
+
+        if (best <= maxDist)
+            setHit(best, bestPoint);
+
+        return hit;
+    }
+
+    bool SweepLevel(Level& level, const Vector3& start, const Vector3& end, float radius, SegID segId, ObjID oid, LevelHit& hit) {
+        QueryTimer timer;
+
+        auto delta = end - start;
+        auto maxDist = delta.Length();
+        if (maxDist < 0.0001f) return false;
+        auto dir = delta / maxDist;
+
+        auto& collision = GetCollisionMesh(level);
+        auto source = level.TryGetObject(oid);
+        PortalSearch search(collision, segId);
+
+        auto testObject = [&](Object& other) {
+            if (!Object::IsAlive(other)) return;
+
+            auto t = SweepPointSphere(start, dir, other.Position, radius + other.Radius);
+            if (t > maxDist || t >= hit.Distance) return;
+
+            auto center = start + dir * t;
+            auto normal = center - other.Position;
+            normal.Normalize();
+            if (t == 0 && normal.Dot(dir) > -SweepTolerance) return; // already overlapping, but moving apart
+
+            hit.Update({ .Distance = t, .Point = other.Position + normal * other.Radius, .Normal = normal }, &other);
+        };
+
+        // Candidates from the broadphase already passed the ownership checks.
+        // Objects spawned during the tick aren't in it yet and check the segments they pass through instead.
+        bool useBroadphase = Game::Broadphase.Contains(oid);
+        if (useBroadphase) {
+            for (auto otherId : Game::Broadphase.GetCandidates(oid))
+                testObject(level.Objects[(int)otherId]);
+        }
+
+        while (!search.Empty()) {
+            auto id = search.Pop();
+            auto& mesh = collision.GetSegment(id);
+
+            if (!useBroadphase) {
+                level.ForEachObjectInSegment(id, [&](ObjID otherId, Object& other) {
+                    if (!source || CanCollide(oid, *source, otherId, other)) testObject(other);
+                });
+            }
+
+            for (int tri = 0; tri < SegmentCollision::Triangles; tri++) {
+                auto side = SegmentCollision::GetSide(tri);
+                auto h = SweepSphereTriangle(mesh, tri, start, dir, maxDist, radius);
+                if (!h) continue;
+
+                if (!mesh.Solid[(int)side]) {
+                    search.Push(mesh.Portal[(int)side]); // the sweep passes through this side
+                    continue;
                 }
+
+                if (h.Normal.Dot(mesh.SideNormal[(int)side]) < 0)
+                    continue; // touching the back of the side
+                if (h.Distance == 0 && h.Normal.Dot(dir) > -SweepTolerance)
+                    continue; // already touching, but moving away
+
+                hit.Update(h, { id, side });
             }
         }
 
@@ -873,9 +1195,98 @@ namespace Inferno {
     }
 
 
+    ObjID SpawnObject(Level& level, const Object& obj) {
+        auto id = level.TakeFreeObject();
+        if (id == ObjID::None)
+            return level.AddObject(obj); // insert a new object
+
+        // found a dead object to reuse!
+        level.UnlinkObject(id);
+        auto& o = level.Objects[(int)id];
+        o = obj;
+        o.LinkedSegment = SegID::None;
+        level.LinkObject(id);
+        return id;
+    }
+
+    void FirePlayerWeapon(Level& level, const Object& obj, int gun, int weaponId) {
+        auto point = Vector3::Transform(Resources::GameData.PlayerShip.GunPoints[gun], obj.GetTransform());
+        auto& weapon = Resources::GameData.Weapons[weaponId];
+        auto bullet = CreateWeaponProjectile(weaponId, point, obj.Rotation, obj.Segment, ObjID(0));
+
+        if (!Game::Headless) {
+            //auto pitch = -Random() * 0.2f;
+            Sound::Sound3D sound(point, obj.Segment);
+            sound.Resource = Resources::GetSoundResource(weapon.FlashSound);
+            sound.Source = ObjID(0);
+            sound.Volume = 0.35f;
+            Sound::Play(sound);
+
+            Render::LoadTextureDynamic(weapon.WeaponVClip);
+
+            Render::Particle p{};
+            p.Clip = weapon.FlashVClip;
+            p.Position = point;
+            p.Radius = weapon.FlashSize;
+            Render::AddParticle(p);
+        }
+
+        SpawnObject(level, bullet);
+    }
+
+    Object CreateWeaponProjectile(int weaponId, const Vector3& position, const Matrix3x3& rotation, SegID segment, ObjID parent) {
+        auto& weapon = Resources::GameData.Weapons[weaponId];
+
+        Object bullet{};
+        bullet.Movement.Type = MovementType::Physics;
+        bullet.Movement.Physics.Velocity = rotation.Forward() * weapon.Speed[0] * 1;
+        bullet.Movement.Physics.Flags = weapon.Bounce > 0 ? PhysicsFlag::Bounce : PhysicsFlag::None;
+        bullet.Movement.Physics.Drag = weapon.Drag;
+        bullet.Movement.Physics.Mass = weapon.Mass;
+        bullet.Position = bullet.LastPosition = position;
+        bullet.Rotation = bullet.LastRotation = rotation;
+        bullet.Segment = segment;
+
+        bullet.Render.Type = RenderType::WeaponVClip;
+        bullet.Render.VClip.ID = weapon.WeaponVClip;
+        bullet.Render.VClip.Rotation = Random() * DirectX::XM_2PI;
+        bullet.Lifespan = weapon.Lifetime;
+
+        bullet.Type = ObjectType::Weapon;
+        bullet.ID = (int8)weaponId;
+        bullet.Parent = parent;
+        return bullet;
+    }
+
+    void SpawnTestProjectiles(Level& level, ObjID source, int count, int weaponId) {
+        auto src = level.TryGetObject(source);
+        if (!src) return;
+
+        // Copy the source as spawning can reallocate the object list
+        auto position = src->Position;
+        auto segment = src->Segment;
+        Matrix transform(src->Rotation);
+
+        if (!Game::Headless)
+            Render::LoadTextureDynamic(Resources::GameData.Weapons[weaponId].WeaponVClip);
+
+        for (int i = 0; i < count; i++) {
+            auto spread = Matrix::CreateFromYawPitchRoll(Random() * DirectX::XM_2PI, (Random() - 0.5f) * DirectX::XM_PI, 0);
+            Matrix3x3 rotation(spread * transform);
+            SpawnObject(level, CreateWeaponProjectile(weaponId, position, rotation, segment, source));
+        }
+
+        SPDLOG_INFO("Spawned {} test projectiles. Level has {} objects.", count, level.Objects.size());
+    }
+
     void UpdateGame(Level& level, double /*t*/, float dt) {
-        for (auto& obj : level.Objects) {
+        for (int id = 0; id < level.Objects.size(); id++) {
+            auto& obj = level.Objects[id];
+            bool alive = Object::IsAlive(obj);
             obj.Lifespan -= dt;
+
+            if (alive && !Object::IsAlive(obj))
+                level.FreeObject(ObjID(id)); // despawned
         }
 
         UpdateDoors(level, dt);
@@ -913,14 +1324,173 @@ namespace Inferno {
         }
     }
 
-    void UpdatePhysics(Level& level, double t, float dt) {
+    namespace {
+        // Outcome of moving an object, computed in parallel and applied to the level afterwards
+        struct MoveResult {
+            Vector3 Position, Velocity;
+            SegID Segment = SegID::None;
+            LevelHit Hit; // First contact, which triggers doors, sounds and damage
+            Array<HitInfo, MaxSweepIterations> Contacts; // Every surface hit while sliding, for debugging
+            int ContactCount = 0;
+        };
+
+        List<ObjID> MovingObjects; // Live objects with physics movement
+        List<MoveResult> MoveResults; // Indexed by object
+
+        // Returns the segment containing the point, or the current segment if nothing contains it
+        SegID FindObjectSegment(Level& level, SegID current, const Vector3& point) {
+            if (Editor::PointInSegment(level, current, point)) return current;
+            auto id = Editor::FindContainingSegment(level, point);
+            return id == SegID::None ? current : id;
+        }
+
+        // Moves an object by its velocity, sliding along or bouncing off each surface that is hit.
+        // Only reads the level, so objects can be moved on several threads at once. Every object sees
+        // the others where they were at the start of the tick.
+        MoveResult MoveObject(Level& level, ObjID id, float dt) {
+            auto& obj = level.Objects[(int)id];
+            auto& pd = obj.Movement.Physics;
+
+            MoveResult result{ .Position = obj.Position, .Velocity = pd.Velocity, .Segment = obj.Segment };
+            result.Hit.Source = &obj;
+
+            auto addContact = [&result](const LevelHit& hit) {
+                result.Contacts[result.ContactCount++] = { .Distance = hit.Distance, .Point = hit.Point, .Normal = hit.Normal };
+            };
+
+            auto delta = pd.Velocity * dt;
+
+            if (delta.Length() < 0.001f) {
+                // no travel, but need to check for being inside of wall (maybe this isn't necessary)
+                result.Position += delta;
+                BoundingSphere sphere(result.Position, obj.Radius);
+
+                if (IntersectLevel(level, sphere, obj.Segment, id, result.Hit))
+                    addContact(result.Hit);
+            }
+            else {
+                auto& position = result.Position;
+                auto& velocity = result.Velocity;
+                auto& segment = result.Segment;
+
+                for (int i = 0; i < MaxSweepIterations; i++) {
+                    Debug::SweepIterations++;
+                    LevelHit sweep{ .Source = &obj };
+
+                    if (!SweepLevel(level, position, position + delta, obj.Radius, segment, id, sweep)) {
+                        position += delta;
+                        break;
+                    }
+
+                    auto length = delta.Length();
+                    auto dir = delta / length;
+                    auto travel = std::max(sweep.Distance - SweepSkin, 0.0f);
+                    position += dir * travel;
+                    addContact(sweep);
+
+                    if (!result.Hit) result.Hit = sweep;
+                    if (obj.Type == ObjectType::Weapon) break; // Weapons are destroyed on contact
+
+                    // Remove the part of the remaining movement and velocity going into the surface
+                    auto& normal = sweep.Normal;
+                    auto bounce = pd.HasFlag(PhysicsFlag::Bounce) ? 2.0f : 1.0f; // Subtract twice to bounce
+                    delta = dir * (length - travel);
+                    if (auto into = delta.Dot(normal); into < 0) delta -= normal * into * bounce;
+                    if (auto into = velocity.Dot(normal); into < 0) velocity -= normal * into * bounce;
+
+                    // The next sweep starts from the segment the object moved into
+                    segment = FindObjectSegment(level, segment, position);
+                    if (delta.LengthSquared() < SweepTolerance * SweepTolerance) break;
+                }
+            }
+
+            result.Segment = FindObjectSegment(level, result.Segment, result.Position);
+            return result;
+        }
+
+        // Opens doors, damages objects and plays the sounds and effects of a collision
+        void ApplyCollision(Level& level, ObjID id, const LevelHit& hit) {
+            auto& obj = level.Objects[(int)id];
+
+            if (obj.Type == ObjectType::Weapon) {
+                obj.Lifespan = -1;
+                level.FreeObject(id);
+            }
+
+            if (auto wall = level.TryGetWall(hit.Tag)) {
+                if (wall->Type == WallType::Door) {
+                    if (obj.Type == ObjectType::Weapon && wall->HasFlag(WallFlag::DoorLocked)) {
+                        // Can't open door
+                        Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
+                        sound.Resource = Resources::GetSoundResource(Sound::SOUND_WEAPON_HIT_DOOR);
+                        sound.Source = obj.Parent;
+                        Sound::Play(sound);
+                    }
+                    else if (wall->State != WallState::DoorOpening) {
+                        OpenDoor(level, hit.Tag);
+                    }
+                }
+            }
+            else if (obj.Type == ObjectType::Weapon) {
+                if (hit.HitObj && !Object::IsAlive(*hit.HitObj))
+                    return; // destroyed by an earlier collision this tick
+
+                auto& weapon = Resources::GameData.Weapons[obj.ID];
+                ApplyHit(hit, obj);
+
+                if (hit.HitObj && hit.HitObj->Type == ObjectType::Robot) {
+                    Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
+                    sound.Resource = Resources::GetSoundResource(weapon.RobotHitSound);
+                    sound.Source = obj.Parent;
+                    Sound::Play(sound);
+
+                    auto& ri = Resources::GetRobotInfo(hit.HitObj->ID);
+                    if (ri.ExplosionClip1 > VClipID::None) {
+                        Render::Particle p{};
+                        p.Position = hit.Point;
+                        p.Radius = weapon.ImpactSize; // (robot->size / 2 * 3)
+                        p.Clip = ri.ExplosionClip1;
+                        Render::AddParticle(p);
+                    }
+                }
+                else {
+                    Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
+                    sound.Resource = Resources::GetSoundResource(weapon.WallHitSound);
+                    sound.Source = obj.Parent;
+                    Sound::Play(sound);
+
+                    Render::Particle p{};
+                    p.Position = hit.Point;
+                    p.Radius = weapon.ImpactSize;
+                    p.Clip = weapon.WallHitVClip;
+                    Render::AddParticle(p);
+                }
+            }
+        }
+    }
+
+    void UpdatePhysics(Level& level, double t, float dt, const TickInput& input) {
+        // The timer adds to the value, so reset the counters first
+        Debug::UpdateTime = Debug::MoveTime = Debug::ApplyTime = 0;
+        Debug::QueryTime = 0;
+        Debug::Queries = Debug::SweepIterations = 0;
+        ScopedTimer timer(&Debug::UpdateTime);
         Debug::Steps = 0;
+
+        AllocationScope allocations;
+
         Debug::ClosestPoints.clear();
 
-        HandleInput(level.Objects[0], dt);
+        // Objects must be linked and unlinked where they are spawned, moved, removed or reordered
+        assert(level.CheckObjectLists());
+        Game::CollisionMesh.UpdateWalls(level); // Doors open and walls are destroyed between updates
+
+        HandleInput(level.Objects[0], input, dt);
 
         UpdateGame(level, t, dt);
 
+        MovingObjects.clear();
+
         for (int id = 0; id < level.Objects.size(); id++) {
             auto& obj = level.Objects[id];
             if (!Object::IsAlive(obj)) continue;
@@ -928,99 +1498,58 @@ namespace Inferno {
             obj.LastPosition = obj.Position;
             obj.LastRotation = obj.Rotation;
 
-            if (obj.Movement.Type == MovementType::Physics) {
+            if (obj.Movement.Type == MovementType::Physics)
+                MovingObjects.push_back(ObjID(id));
+        }
+
+        MoveResults.resize(level.Objects.size());
+        GetCollisionMesh(level); // Build the mesh before queries run on other threads
+
+        {
+            ScopedTimer moveTimer(&Debug::MoveTime);
+
+            ParallelForEach(MovingObjects, [&level, dt](ObjID id) {
+                auto& obj = level.Objects[(int)id];
                 FixedPhysics(obj, dt);
 
                 //if (obj.Movement.Physics.HasFlag(PhysicsFlag::Wiggle))
                 //    WiggleObject(obj, t, dt, Resources::GameData.PlayerShip.Wiggle); // rather hacky, assumes the ship is the only thing that wiggles
 
                 obj.Movement.Physics.InputVelocity = obj.Movement.Physics.Velocity;
-                obj.Position += obj.Movement.Physics.Velocity * dt;
-
-                auto delta = obj.Position - obj.LastPosition;
-                auto maxDistance = delta.Length();
-                LevelHit hit{ .Source = &obj };
+            });
 
-                if (maxDistance < 0.001f) {
-                    // no travel, but need to check for being inside of wall (maybe this isn't necessary)
-                    BoundingSphere sphere(obj.Position, obj.Radius);
+            // Velocities are known for the tick, so the bounds cover everywhere an object can move
+            Game::Broadphase.Update(level.Objects, dt);
 
-                    if (IntersectLevel(level, sphere, obj.Segment, (ObjID)id, hit)) {
-                        Debug::ClosestPoints.push_back(hit.Point);
-                        Render::Debug::DrawLine(hit.Point, hit.Point + hit.Normal, { 1, 0, 0 });
-                    }
-                }
-                else {
-                    Vector3 dir;
-                    delta.Normalize(dir);
-                    //auto expectedTravel = (obj.Position() - obj.PrevPosition()).Length();
-
-                    Ray ray(obj.LastPosition, dir);
+            ParallelForEach(MovingObjects, [&level, dt](ObjID id) {
+                MoveResults[(int)id] = MoveObject(level, id, dt);
+            });
+        }
 
-                    BoundingCapsule capsule{ .A = obj.LastPosition, .B = obj.Position, .Radius = obj.Radius };
+        ScopedTimer applyTimer(&Debug::ApplyTime);
 
-                    if (IntersectLevel(level, capsule, obj.Segment, obj, hit)) {
+        // Apply in object order so the outcome doesn't depend on which thread finished first
+        for (int id = 0; id < level.Objects.size(); id++) {
+            auto& obj = level.Objects[id];
+            if (!Object::IsAlive(obj)) continue;
 
-                        //Render::Debug::DrawPoint(hit.Point, { 1, 1, 0 });
-                        Debug::ClosestPoints.push_back(hit.Point);
-                        Render::Debug::DrawLine(hit.Point, hit.Point + hit.Normal, { 1, 0, 0 });
-                    }
+            if (obj.Movement.Type == MovementType::Physics) {
+                auto& result = MoveResults[id];
+                obj.Position = result.Position;
+                obj.Movement.Physics.Velocity = result.Velocity;
+
+                for (int i = 0; i < result.ContactCount; i++) {
+                    auto& contact = result.Contacts[i];
+                    //Render::Debug::DrawPoint(contact.Point, { 1, 1, 0 });
+                    Debug::ClosestPoints.push_back(contact.Point);
+                    DrawDebugLine(contact.Point, contact.Point + contact.Normal, { 1, 0, 0 });
                 }
 
-                if (hit) {
-                    if (obj.Type == ObjectType::Weapon) {
-                        obj.Lifespan = -1;
-                    }
+                if (result.Segment != obj.Segment)
+                    level.RelinkObject(ObjID(id), result.Segment);
 
-                    if (auto wall = level.TryGetWall(hit.Tag)) {
-                        if (wall->Type == WallType::Door) {
-                            if (obj.Type == ObjectType::Weapon && wall->HasFlag(WallFlag::DoorLocked)) {
-                                // Can't open door
-                                Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
-                                sound.Resource = Resources::GetSoundResource(Sound::SOUND_WEAPON_HIT_DOOR);
-                                sound.Source = obj.Parent;
-                                Sound::Play(sound);
-                            }
-                            else if (wall->State != WallState::DoorOpening) {
-                                OpenDoor(level, hit.Tag);
-                            }
-                        }
-                    }
-                    else {
-                        if (obj.Type == ObjectType::Weapon) {
-                            auto& weapon = Resources::GameData.Weapons[obj.ID];
-                            ApplyHit(hit, obj);
-
-                            if (hit.HitObj && hit.HitObj->Type == ObjectType::Robot) {
-                                Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
-                                sound.Resource = Resources::GetSoundResource(weapon.RobotHitSound);
-                                sound.Source = obj.Parent;
-                                Sound::Play(sound);
-
-                                auto& ri = Resources::GetRobotInfo(hit.HitObj->ID);
-                                if (ri.ExplosionClip1 > VClipID::None) {
-                                    Render::Particle p{};
-                                    p.Position = hit.Point;
-                                    p.Radius = weapon.ImpactSize; // (robot->size / 2 * 3)
-                                    p.Clip = ri.ExplosionClip1;
-                                    Render::AddParticle(p);
-                                }
-                            }
-                            else {
-                                Sound::Sound3D sound(hit.Point, hit.Tag.Segment);
-                                sound.Resource = Resources::GetSoundResource(weapon.WallHitSound);
-                                sound.Source = obj.Parent;
-                                Sound::Play(sound);
-
-                                Render::Particle p{};
-                                p.Position = hit.Point;
-                                p.Radius = weapon.ImpactSize;
-                                p.Clip = weapon.WallHitVClip;
-                                Render::AddParticle(p);
-                            }
-                        }
-                    }
-                }
+                if (result.Hit)
+                    ApplyCollision(level, ObjID(id), result.Hit);
 
                 //CollideTriangles(level, obj, dt, 0);
                 //CollideTriangles(level, obj, dt, 1); // Doing two passes makes the result more stable
@@ -1028,13 +1557,14 @@ namespace Inferno {
 
                 //auto frameVec = obj.Position() - obj.PrevTransform.Translation();
                 //obj.Movement.Physics.Velocity = frameVec / dt;
-                Editor::UpdateObjectSegment(level, obj);
             }
 
-            Render::Debug::DrawLine(obj.LastPosition, obj.Position, { 0, 1.0f, 0.2f });
+            DrawDebugLine(obj.LastPosition, obj.Position, { 0, 1.0f, 0.2f });
 
             Debug::ShipVelocity = obj.Movement.Physics.Velocity;
             Debug::ShipPosition = obj.Position;
         }
+
+        Debug::Allocations = allocations.Count().value_or(0);
     }
 }
\ No newline at end of file
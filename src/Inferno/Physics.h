@@ -3,7 +3,33 @@
 #include "Face.h"
 
 namespace Inferno {
-    void UpdatePhysics(Level& level, double t, float dt);
+    // Player controls for a single physics tick
+    enum class InputButton : uint16 {
+        None,
+        Forward = BIT(0),
+        Reverse = BIT(1),
+        SlideLeft = BIT(2),
+        SlideRight = BIT(3),
+        YawLeft = BIT(4),
+        YawRight = BIT(5),
+        PitchDown = BIT(6),
+        PitchUp = BIT(7),
+        RollLeft = BIT(8),
+        RollRight = BIT(9),
+        Fire = BIT(10)
+    };
+
+    struct TickInput {
+        InputButton Buttons = InputButton::None;
+
+        bool Has(InputButton button) const { return bool(Buttons & button); }
+        bool operator==(const TickInput&) const = default;
+    };
+
+    // Reads the controls from the keyboard
+    TickInput SampleInput();
+
+    void UpdatePhysics(Level& level, double t, float dt, const TickInput& input);
 
     namespace Debug {
         inline Vector3 ShipPosition, ShipVelocity, ShipAcceleration, ShipThrust;
@@ -11,6 +37,13 @@ namespace Inferno {
         inline float Steps = 0, R = 0, K = 0;
         inline Vector3 ClosestPoint;
         inline List<Vector3> ClosestPoints;
+        inline int64 UpdateTime = 0; // Microseconds for the last physics update
+        inline std::atomic<int> Queries = 0; // Sphere and capsule level queries during the last update
+        inline std::atomic<int64> QueryTime = 0; // Microseconds spent in level queries during the last update, summed across threads
+        inline std::atomic<int> SweepIterations = 0; // Swept collision passes during the last update
+        inline int64 MoveTime = 0; // Microseconds to integrate and move objects in parallel
+        inline int64 ApplyTime = 0; // Microseconds to apply collisions in object order
+        inline int64 Allocations = 0; // Heap allocations on the calling thread during the last update. Debug builds only.
     };
 
     struct HitInfo {
@@ -25,7 +58,6 @@ namespace Inferno {
         Object* HitObj = nullptr;
         float Distance = FLT_MAX;
         Vector3 Point, Normal;
-        Set<SegID> Visited; // visited segments
 
         void Update(const HitInfo& hit, Object* obj) {
             if (!obj || hit.Distance > Distance) return;
@@ -43,9 +75,61 @@ namespace Inferno {
             Tag = tag;
         }
 
-        operator bool() { return Distance != FLT_MAX; }
+        operator bool() const { return Distance != FLT_MAX; }
     };
 
     bool IntersectLevel(Level& level, const Ray& ray, SegID start, float maxDist, LevelHit& hit);
+
+    struct RayQuery {
+        Ray Ray;
+        SegID Start = SegID::None; // Segment containing the ray origin
+        float MaxDistance = 0;
+    };
+
+    // Intersects many rays with the level at once, such as for sound occlusion and line of sight checks.
+    // Callers add their rays during a tick and read the hits after a single Run().
+    class RayBatch {
+        List<RayQuery> _queries;
+        List<LevelHit> _hits; // Same order as the queries
+        List<int> _order; // Queries sorted by start segment
+
+    public:
+        struct Stats {
+            int Rays = 0;
+            int64 Time = 0; // Microseconds for the last run
+        };
+
+        // Adds a ray and returns the index of its hit
+        int Add(const Ray& ray, SegID start, float maxDist);
+
+        // Intersects every ray, grouped by start segment and spread across threads
+        void Run(Level& level);
+
+        void Clear();
+
+        const LevelHit& GetHit(int index) const { return _hits[index]; }
+        size_t Size() const { return _queries.size(); }
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        Stats _stats;
+    };
+
+    // Sweeps a sphere from start to end, following portals it passes through.
+    // Finds the earliest contact with level triangles, edges, vertices or objects.
+    // Hit distance is the travel along the sweep before contact and the normal points away from the surface.
+    bool SweepLevel(Level& level, const Vector3& start, const Vector3& end, float radius, SegID segId, ObjID oid, LevelHit& hit);
     HitInfo IntersectFaceSphere(const Face& face, const DirectX::BoundingSphere& sphere);
+
+    // Adds an object to the level and links it to its segment. Reuses dead objects when possible.
+    ObjID SpawnObject(Level& level, const Object& obj);
+
+    // Fires a weapon from one of the player ship's gun points
+    void FirePlayerWeapon(Level& level, const Object& obj, int gun, int weaponId);
+
+    // Creates a projectile travelling along the forward vector of the rotation
+    Object CreateWeaponProjectile(int weaponId, const Vector3& position, const Matrix3x3& rotation, SegID segment, ObjID parent);
+
+    // Stress test for collision queries. Fires projectiles in random directions from the source object.
+    void SpawnTestProjectiles(Level& level, ObjID source, int count, int weaponId);
 }
@@ -106,6 +106,11 @@ namespace Inferno {
         node["Multiplier"] << s.Multiplier;
         node["Radius"] << s.Radius;
         node["Reflectance"] << s.Reflectance;
+        node["BounceCutoff"] << s.BounceCutoff;
+        node["BounceEpsilon"] << s.BounceEpsilon;
+        node["UseCache"] << s.UseCache;
+        node["ProbeResolution"] << s.ProbeResolution;
+        node["ProbeTimeLimit"] << s.ProbeTimeLimit;
     }
 
     LightSettings LoadLightSettings(ryml::NodeRef node) {
@@ -123,6 +128,11 @@ namespace Inferno {
         ReadValue(node["Multiplier"], settings.Multiplier);
         ReadValue(node["Radius"], settings.Radius);
         ReadValue(node["Reflectance"], settings.Reflectance);
+        ReadValue(node["BounceCutoff"], settings.BounceCutoff);
+        ReadValue(node["BounceEpsilon"], settings.BounceEpsilon);
+        ReadValue(node["UseCache"], settings.UseCache);
+        ReadValue(node["ProbeResolution"], settings.ProbeResolution);
+        ReadValue(node["ProbeTimeLimit"], settings.ProbeTimeLimit);
         return settings;
     }
 
@@ -36,6 +36,11 @@ namespace Inferno {
         bool EnableColor = false;
         bool SkipFirstPass = false;
         float LightPlaneTolerance = -0.45f;
+        float BounceCutoff = 0.01f; // Stop bouncing a light when a pass adds less than this fraction of its direct light
+        float BounceEpsilon = 0.002f; // Stop all bounces when a pass adds less than this fraction of the total direct light
+        bool UseCache = true; // Reuse results from disk when the level and settings are unchanged
+        int ProbeResolution = 2; // Volumetric light probes along each axis of a segment. 0 disables probes.
+        float ProbeTimeLimit = 30; // Seconds. Segments not baked in time use their volume light. 0 is unlimited.
 
         // Retired settings
         bool CheckCoplanar = true;
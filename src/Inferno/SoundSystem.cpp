@@ -32,6 +32,8 @@ namespace Inferno::Sound {
         Ptr<SoundEffectInstance> Instance;
         AudioEmitter Emitter; // Stores position
         double StartTime = 0;
+        float Muffle = 1; // Volume scale from walls between the sound and the listener
+        int OcclusionRay = -1; // Index in the occlusion batch for the current tick
 
         void UpdateEmitter(const Vector3& listener, float /*dt*/) {
             auto obj = Game::Level.TryGetObject(Source);
@@ -43,29 +45,14 @@ namespace Inferno::Sound {
 
             if (obj) {
                 auto emitterPos = Emitter.Position / AUDIO_SCALE;
-                auto delta = listener - emitterPos;
-                Vector3 dir;
-                delta.Normalize(dir);
-                auto dist = delta.Length();
+                auto dist = (listener - emitterPos).Length();
                 auto ratio = std::min(dist / MAX_DISTANCE, 1.0f);
                 // 1 / (0.97 + 3x)^2 - 0.065 inverse square that crosses at 0,1 and 1,0
                 //auto volume = 1 / std::powf(0.97 + 3*ratio, 2) - 0.065f;
 
-                float muffleMult = 1;
-
-                if (dist < MAX_DISTANCE) { // only hit test if sound is actually within range
-                    Ray ray(emitterPos, dir);
-                    LevelHit hit;
-                    if (IntersectLevel(Game::Level, ray, Segment, dist, hit)) {
-                        auto hitDist = (listener - hit.Point).Length();
-                        // we hit a wall, muffle it based on the distance from the source
-                        // a sound coming immediately around the corner shouldn't get muffled much
-                        muffleMult = std::clamp(1 - hitDist / 60, 0.25f, 0.95f);
-                    };
-                }
-
+                // Muffling is updated by the game tick
                 auto volume = std::powf(1 - ratio, 3);
-                Instance->SetVolume(volume * muffleMult * MAX_SFX_VOLUME);
+                Instance->SetVolume(volume * Muffle * MAX_SFX_VOLUME);
             }
             else {
                 // object is missing, was likely destroyed. Should the sound stop?
@@ -85,6 +72,7 @@ namespace Inferno::Sound {
         std::thread WorkerThread;
         std::list<ObjectSound> ObjectSounds;
         std::mutex ResetMutex, ObjectSoundsMutex;
+        RayBatch OcclusionRays;
 
         AudioListener Listener;
 
@@ -111,6 +99,42 @@ namespace Inferno::Sound {
         };
     }
 
+    void UpdateOcclusion() {
+        if (!Alive || Game::Headless) return;
+
+        auto listener = Render::Camera.Position;
+        std::scoped_lock lock(ObjectSoundsMutex);
+        OcclusionRays.Clear();
+
+        for (auto& sound : ObjectSounds) {
+            sound.OcclusionRay = -1;
+            if (!Game::Level.TryGetObject(sound.Source)) continue;
+
+            auto emitterPos = sound.Emitter.Position / AUDIO_SCALE;
+            auto delta = listener - emitterPos;
+            auto dist = delta.Length();
+            if (dist >= MAX_DISTANCE) continue; // only hit test if sound is actually within range
+
+            Vector3 dir;
+            delta.Normalize(dir);
+            sound.OcclusionRay = OcclusionRays.Add(Ray(emitterPos, dir), sound.Segment, dist);
+        }
+
+        OcclusionRays.Run(Game::Level);
+
+        for (auto& sound : ObjectSounds) {
+            if (sound.OcclusionRay < 0) continue;
+
+            sound.Muffle = 1;
+            if (auto& hit = OcclusionRays.GetHit(sound.OcclusionRay)) {
+                auto hitDist = (listener - hit.Point).Length();
+                // we hit a wall, muffle it based on the distance from the source
+                // a sound coming immediately around the corner shouldn't get muffled much
+                sound.Muffle = std::clamp(1 - hitDist / 60, 0.25f, 0.95f);
+            }
+        }
+    }
+
     void SoundWorker(float volume, milliseconds pollRate) {
         SPDLOG_INFO("Starting audio mixer thread");
 
@@ -350,6 +374,7 @@ namespace Inferno::Sound {
     }
 
     void Play(const Sound3D& sound) {
+        if (Game::Headless) return;
         auto sfx = LoadSound(sound.Resource);
         if (!sfx) return;
 
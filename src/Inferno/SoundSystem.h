@@ -44,6 +44,9 @@ namespace Inferno::Sound {
     void Play(const SoundResource& resource, float volume = 1, float pan = 0, float pitch = 0);
     void Play(const Sound3D& sound);
 
+    // Tests for walls between each 3D sound and the listener in a single batch. Called once per game tick.
+    void UpdateOcclusion();
+
     // Resets any cached sounds after loading a level
     void Reset();
 
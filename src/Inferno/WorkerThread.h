@@ -2,6 +2,7 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <spdlog/spdlog.h>
 
 // A long running worker thread that waits for notifications to start processing
@@ -20,11 +21,16 @@ public:
 
     void Start() {
         _alive = true;
+        _hasWork = true; // Run once on start
         _worker = std::thread(&WorkerThread::Worker, this);
     }
 
     void Stop() {
-        _alive = false;
+        {
+            std::scoped_lock lock(_notifyLock);
+            _alive = false;
+        }
+
         _workAvailable.notify_all();
         if (_worker.joinable())
             _worker.join();
@@ -37,7 +43,12 @@ public:
 
     // Wake up the worker
     void Notify() {
-        _hasWork = true;
+        {
+            // Setting the flag under the lock means the worker can't miss it between checking and waiting
+            std::scoped_lock lock(_notifyLock);
+            _hasWork = true;
+        }
+
         _workAvailable.notify_one();
     }
 
@@ -48,20 +59,21 @@ protected:
 private:
     void Worker() {
         SPDLOG_INFO("Starting worker");
-        while (_alive) {
-            _hasWork = false;
+        while (true) {
+            {
+                // Sleep until work is requested. New work could be requested while work is being done.
+                std::unique_lock lock(_notifyLock);
+                _workAvailable.wait(lock, [this] { return _hasWork || !_alive; });
+                if (!_alive) break;
+                _hasWork = false;
+            }
+
             try {
                 Work();
             }
             catch (const std::exception& e) {
                 SPDLOG_ERROR(e.what());
             }
-
-            // New work could be requested while work is being done
-            if (!_hasWork) {
-                std::unique_lock lock(_notifyLock);
-                _workAvailable.wait(lock); // sleep until work requested
-            }
         }
         SPDLOG_INFO("Stopping worker");
     }
@@ -8,6 +8,9 @@
 #include "Mission.h"
 #include "HogFile.h"
 #include "Settings.h"
+#include "Game.h"
+#include "Game.Benchmark.h"
+#include <fstream>
 
 using namespace Inferno;
 
@@ -181,11 +184,67 @@ void TestSegID() {
     assert(id == SegID(6));
 }
 
-int main() {
+// Lights all levels in a mission without opening a window
+int LightMissionCommand(const filesystem::path& path) {
+    try {
+        Settings::Load();
+        FileSystem::Init();
+        Resources::Init();
+        return Editor::LightMission(path) == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        fmt::print("Error lighting mission: {}\n", e.what());
+        return 1;
+    }
+}
+
+// Simulates a level from a mission without opening a window and writes the subsystem timings as CSV
+int BenchmarkCommand(int argc, char* argv[]) {
+    try {
+        Settings::Load();
+        FileSystem::Init();
+        Resources::Init();
+
+        Game::Mission = HogFile::Read(argv[2]);
+        auto level = Resources::ReadLevel(argv[3]);
+        Resources::LoadLevel(level);
+
+        SimulationBenchmarkOptions options;
+        int* values[] = { &options.Ticks, &options.Robots, &options.Weapons, &options.Particles };
+        for (int i = 5; i < argc && size_t(i - 5) < std::size(values); i++)
+            *values[i - 5] = std::stoi(argv[i]);
+
+        if (argc > 9)
+            options.Seed = (uint)std::stoul(argv[9]);
+
+        auto result = RunSimulationBenchmark(level, options);
+
+        std::ofstream stream(argv[4]);
+        WriteSimulationBenchmarkCsv(result, stream);
+        if (!stream) throw Exception("Unable to write results");
+
+        fmt::print("Ran {} ticks with {} objects in {:.1f} ms\n", options.Ticks, result.Objects, result.TotalTime / 1000.0f);
+        return 0;
+    }
+    catch (const std::exception& e) {
+        fmt::print("Error running benchmark: {}\n", e.what());
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
     // https://github.com/gabime/spdlog/wiki/3.-Custom-formatting#pattern-flags
     spdlog::set_pattern("[%M:%S.%e] [%^%l%$] [TID:%t] [%s:%#] %v");
     std::srand((uint)std::time(nullptr)); // seed c-random
 
+    // Usage: inferno --light-mission <mission.hog>
+    if (argc >= 3 && string(argv[1]) == "--light-mission")
+        return LightMissionCommand(argv[2]);
+
+    // Usage: inferno --benchmark <mission.hog> <level> <output.csv> [ticks] [robots] [weapons] [particles] [seed]
+    if (argc >= 5 && string(argv[1]) == "--benchmark")
+        return BenchmarkCommand(argc, argv);
+
     try {
         Shell shell;
         //CoInitializeEx(nullptr, COINIT_MULTITHREADED);